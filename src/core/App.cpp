@@ -41,6 +41,11 @@ namespace core {
     }
 
     void App::update() {
+        // no scenario is loaded when an app runs a headless task and quits from setup()
+        if (!_scenario) {
+            return;
+        }
+        
         InputDispatcher::get()->update();
         
         // run physics step()
@@ -58,11 +63,15 @@ namespace core {
     }
 
     void App::draw() {
-        _scenario->dispatchDraw();
+        if (_scenario) {
+            _scenario->dispatchDraw();
+        }
     }
 
     void App::resize() {
-        _scenario->dispatchWindowResize(getWindowSize());
+        if (_scenario) {
+            _scenario->dispatchWindowResize(getWindowSize());
+        }
     }
 
     void App::step() {
@@ -0,0 +1,190 @@
+//
+//  ContourSimplification.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/23/18.
+//
+
+#include "core/util/ContourSimplification.hpp"
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#define CS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#include "core/util/ImageProcessing.hpp"
+
+namespace core {
+    namespace util {
+        namespace detail {
+            
+            namespace {
+                
+                // running maximum of 4 float distances and the index each was found at, reduced at the end
+                struct lane_max {
+                    float dist[4];
+                    int32_t index[4];
+                };
+                
+                // reduce `lanes and the remaining points (from, last] into the overall farthest point; ties go to the lowest index
+                size_t reduce(const lane_max &lanes, const line_segment<double, glm::highp> &line, const dvec2 *points, size_t from, size_t last, double &maxDist) {
+                    size_t maxDistIndex = 0;
+                    maxDist = 0;
+                    for (int l = 0; l < 4; l++) {
+                        const size_t index = static_cast<size_t>(lanes.index[l]);
+                        if (lanes.dist[l] > maxDist || (lanes.dist[l] == maxDist && maxDist > 0 && index < maxDistIndex)) {
+                            maxDist = lanes.dist[l];
+                            maxDistIndex = index;
+                        }
+                    }
+                    
+                    for (size_t i = from + 1; i <= last; i++) {
+                        float dist = line.distance(points[i]);
+                        if (dist > maxDist) {
+                            maxDist = dist;
+                            maxDistIndex = i;
+                        }
+                    }
+                    
+                    return maxDistIndex;
+                }
+                
+            }
+
+#if CS_X86_SIMD
+            
+            namespace sse2 {
+                
+                inline __m128d select(__m128d mask, __m128d a, __m128d b) {
+                    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+                }
+                
+                // squared distance of the 2 points (x,y) from the segment, chosen the same way as line_segment::distance
+                inline __m128d distance_squared(__m128d x, __m128d y, const line_segment<double, glm::highp> &line) {
+                    const __m128d ax = _mm_set1_pd(line.a.x), ay = _mm_set1_pd(line.a.y);
+                    const __m128d tx = _mm_sub_pd(x, ax), ty = _mm_sub_pd(y, ay);
+                    const __m128d projLength = _mm_add_pd(_mm_mul_pd(tx, _mm_set1_pd(line.dir.x)), _mm_mul_pd(ty, _mm_set1_pd(line.dir.y)));
+                    
+                    // past the start, past the end, and the projection onto the segment
+                    const __m128d toAx = _mm_sub_pd(ax, x), toAy = _mm_sub_pd(ay, y);
+                    const __m128d toBx = _mm_sub_pd(_mm_set1_pd(line.b.x), x), toBy = _mm_sub_pd(_mm_set1_pd(line.b.y), y);
+                    const __m128d toPx = _mm_sub_pd(_mm_add_pd(ax, _mm_mul_pd(projLength, _mm_set1_pd(line.dir.x))), x);
+                    const __m128d toPy = _mm_sub_pd(_mm_add_pd(ay, _mm_mul_pd(projLength, _mm_set1_pd(line.dir.y))), y);
+                    
+                    __m128d d2 = _mm_add_pd(_mm_mul_pd(toPx, toPx), _mm_mul_pd(toPy, toPy));
+                    d2 = select(_mm_cmpgt_pd(projLength, _mm_set1_pd(line.length)), _mm_add_pd(_mm_mul_pd(toBx, toBx), _mm_mul_pd(toBy, toBy)), d2);
+                    d2 = select(_mm_cmplt_pd(projLength, _mm_setzero_pd()), _mm_add_pd(_mm_mul_pd(toAx, toAx), _mm_mul_pd(toAy, toAy)), d2);
+                    return d2;
+                }
+                
+                size_t farthest_from_segment(const dvec2 *points, size_t first, size_t last, double &maxDist) {
+                    const line_segment<double, glm::highp> line(points[first], points[last]);
+                    const double *coords = reinterpret_cast<const double*>(points);
+                    
+                    __m128 laneDist = _mm_setzero_ps();
+                    __m128i laneIndex = _mm_setzero_si128();
+                    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+                    
+                    size_t i = first + 1;
+                    index = _mm_add_epi32(index, _mm_set1_epi32(static_cast<int32_t>(i)));
+                    for (; i + 3 <= last; i += 4) {
+                        const __m128d p0 = _mm_loadu_pd(coords + 2 * i), p1 = _mm_loadu_pd(coords + 2 * i + 2);
+                        const __m128d p2 = _mm_loadu_pd(coords + 2 * i + 4), p3 = _mm_loadu_pd(coords + 2 * i + 6);
+                        
+                        const __m128d d01 = _mm_sqrt_pd(distance_squared(_mm_unpacklo_pd(p0, p1), _mm_unpackhi_pd(p0, p1), line));
+                        const __m128d d23 = _mm_sqrt_pd(distance_squared(_mm_unpacklo_pd(p2, p3), _mm_unpackhi_pd(p2, p3), line));
+                        const __m128 dist = _mm_movelh_ps(_mm_cvtpd_ps(d01), _mm_cvtpd_ps(d23));
+                        
+                        const __m128 greater = _mm_cmpgt_ps(dist, laneDist);
+                        laneDist = _mm_or_ps(_mm_and_ps(greater, dist), _mm_andnot_ps(greater, laneDist));
+                        const __m128i greaterI = _mm_castps_si128(greater);
+                        laneIndex = _mm_or_si128(_mm_and_si128(greaterI, index), _mm_andnot_si128(greaterI, laneIndex));
+                        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+                    }
+                    
+                    lane_max lanes;
+                    _mm_storeu_ps(lanes.dist, laneDist);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.index), laneIndex);
+                    return reduce(lanes, line, points, i - 1, last, maxDist);
+                }
+                
+            }
+            
+            namespace avx2 {
+                
+                // compiled for AVX2 regardless of the target's baseline; only called after a cpuid check
+#define CS_AVX2 __attribute__((target("avx2")))
+                
+                CS_AVX2 inline __m256d distance_squared(__m256d x, __m256d y, const line_segment<double, glm::highp> &line) {
+                    const __m256d ax = _mm256_set1_pd(line.a.x), ay = _mm256_set1_pd(line.a.y);
+                    const __m256d tx = _mm256_sub_pd(x, ax), ty = _mm256_sub_pd(y, ay);
+                    const __m256d projLength = _mm256_add_pd(_mm256_mul_pd(tx, _mm256_set1_pd(line.dir.x)), _mm256_mul_pd(ty, _mm256_set1_pd(line.dir.y)));
+                    
+                    const __m256d toAx = _mm256_sub_pd(ax, x), toAy = _mm256_sub_pd(ay, y);
+                    const __m256d toBx = _mm256_sub_pd(_mm256_set1_pd(line.b.x), x), toBy = _mm256_sub_pd(_mm256_set1_pd(line.b.y), y);
+                    const __m256d toPx = _mm256_sub_pd(_mm256_add_pd(ax, _mm256_mul_pd(projLength, _mm256_set1_pd(line.dir.x))), x);
+                    const __m256d toPy = _mm256_sub_pd(_mm256_add_pd(ay, _mm256_mul_pd(projLength, _mm256_set1_pd(line.dir.y))), y);
+                    
+                    // mul and add are kept separate, rather than fused, so results match the scalar path exactly
+                    __m256d d2 = _mm256_add_pd(_mm256_mul_pd(toPx, toPx), _mm256_mul_pd(toPy, toPy));
+                    d2 = _mm256_blendv_pd(d2, _mm256_add_pd(_mm256_mul_pd(toBx, toBx), _mm256_mul_pd(toBy, toBy)), _mm256_cmp_pd(projLength, _mm256_set1_pd(line.length), _CMP_GT_OQ));
+                    d2 = _mm256_blendv_pd(d2, _mm256_add_pd(_mm256_mul_pd(toAx, toAx), _mm256_mul_pd(toAy, toAy)), _mm256_cmp_pd(projLength, _mm256_setzero_pd(), _CMP_LT_OQ));
+                    return d2;
+                }
+                
+                CS_AVX2 size_t farthest_from_segment(const dvec2 *points, size_t first, size_t last, double &maxDist) {
+                    const line_segment<double, glm::highp> line(points[first], points[last]);
+                    const double *coords = reinterpret_cast<const double*>(points);
+                    
+                    __m128 laneDist = _mm_setzero_ps();
+                    __m128i laneIndex = _mm_setzero_si128();
+                    
+                    size_t i = first + 1;
+                    __m128i index = _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int32_t>(i)));
+                    for (; i + 3 <= last; i += 4) {
+                        // [x0 y0 x1 y1] [x2 y2 x3 y3] -> [x0 x2 x1 x3] [y0 y2 y1 y3] -> [x0 x1 x2 x3] [y0 y1 y2 y3]
+                        const __m256d p01 = _mm256_loadu_pd(coords + 2 * i), p23 = _mm256_loadu_pd(coords + 2 * i + 4);
+                        const __m256d x = _mm256_permute4x64_pd(_mm256_unpacklo_pd(p01, p23), 0xD8);
+                        const __m256d y = _mm256_permute4x64_pd(_mm256_unpackhi_pd(p01, p23), 0xD8);
+                        
+                        const __m128 dist = _mm256_cvtpd_ps(_mm256_sqrt_pd(distance_squared(x, y, line)));
+                        
+                        const __m128 greater = _mm_cmpgt_ps(dist, laneDist);
+                        laneDist = _mm_blendv_ps(laneDist, dist, greater);
+                        laneIndex = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(laneIndex), _mm_castsi128_ps(index), greater));
+                        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+                    }
+                    
+                    lane_max lanes;
+                    _mm_storeu_ps(lanes.dist, laneDist);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.index), laneIndex);
+                    return reduce(lanes, line, points, i - 1, last, maxDist);
+                }
+
+#undef CS_AVX2
+                
+            }
+
+#endif
+            
+            size_t farthest_from_segment(const dvec2 *points, size_t first, size_t last, double &maxDist) {
+                // lane indices are 32 bit
+                if (last - first < 16 || last > static_cast<size_t>(INT32_MAX)) {
+                    return farthest_from_segment<double, glm::highp>(points, first, last, maxDist);
+                }
+                
+                switch (ip::get_simd_level()) {
+#if CS_X86_SIMD
+                    case ip::SIMD_AVX2:
+                        return avx2::farthest_from_segment(points, first, last, maxDist);
+                    case ip::SIMD_SSE2:
+                        return sse2::farthest_from_segment(points, first, last, maxDist);
+#endif
+                    default:
+                        return farthest_from_segment<double, glm::highp>(points, first, last, maxDist);
+                }
+            }
+            
+        }
+    }
+} // end namespace core::util::detail
@@ -10,6 +10,8 @@
 #define ContourSimplification_hpp
 
 #include <cinder/PolyLine.h>
+#include <algorithm>
+#include <functional>
 
 #include "core/MathHelpers.hpp"
 #include "core/util/LineSegment.hpp"
@@ -18,100 +20,292 @@ namespace core {
     namespace util {
         
         using std::vector;
-
+        
+        namespace detail {
+            
+            // inclusive range of point indices
+            typedef std::pair<size_t, size_t> index_range;
+            
+            /**
+             Find the point in (first,last] farthest from the segment from points[first] to points[last], as measured by
+             line_segment::distance rounded to float (as the original recursive simplify did), writing its distance to `maxDist.
+             Ties go to the lowest index; if no point is farther than 0 returns 0.
+             */
+            template<class T, glm::precision P>
+            size_t farthest_from_segment(const glm::tvec2<T, P> *points, size_t first, size_t last, T &maxDist) {
+                const line_segment<T, P> line(points[first], points[last]);
+                size_t maxDistIndex = 0;
+                maxDist = 0;
+                
+                for (size_t i = first + 1; i <= last; i++) {
+                    float dist = line.distance(points[i]);
+                    if (dist > maxDist) {
+                        maxDist = dist;
+                        maxDistIndex = i;
+                    }
+                }
+                
+                return maxDistIndex;
+            }
+            
+            /**
+             Double precision farthest_from_segment, evaluating 4 distances at a time with SSE2 or AVX2 according to
+             ip::get_simd_level. Returns exactly what the template does.
+             */
+            size_t farthest_from_segment(const dvec2 *points, size_t first, size_t last, double &maxDist);
+            
+            // per-thread scratch for the vector and PolyLine simplify variants, so repeated calls don't allocate
+            struct simplification_scratch {
+                vector<uint8_t> keep;
+                vector<index_range> stack;
+            };
+            
+            inline simplification_scratch &get_simplification_scratch() {
+                thread_local simplification_scratch scratch;
+                return scratch;
+            }
+            
+            template<class T>
+            struct visvalingam_scratch {
+                vector<size_t> prev, next;
+                vector<T> area;
+                vector<std::pair<T, size_t>> heap;
+            };
+            
+            template<class T>
+            visvalingam_scratch<T> &get_visvalingam_scratch() {
+                thread_local visvalingam_scratch<T> scratch;
+                return scratch;
+            }
+            
+            // copy the points of `in whose `keep entry is set to `out, which may be `in
+            template<class V>
+            void compact(const vector<V> &in, const uint8_t *keep, size_t kept, vector<V> &out) {
+                if (&in != &out) {
+                    out.resize(kept);
+                }
+                
+                size_t j = 0;
+                for (size_t i = 0, N = in.size(); i < N; i++) {
+                    if (keep[i]) {
+                        out[j++] = in[i];
+                    }
+                }
+                
+                out.resize(kept);
+            }
+            
+        }
+        
         /**
-         Ramer-Douglas-Peucker simplification
-         @param in the path to optimize
-         @param out the optimized path
+         Ramer-Douglas-Peucker simplification of points[0,count), writing keep[i] = 1 for each point retained and 0 for
+         each point dropped, and returning the number retained. Ranges are subdivided with an explicit stack of index ranges
+         rather than by recursing on copies, so no points are copied or allocated; `stack is scratch which may be reused
+         across calls. Retains exactly the points reference::simplify does.
+         @param points the path to optimize
+         @param count number of points in the path
          @param threshold the maximum allowed linear deviation from the optimized path to the original path
+         @param keep receives the keep mask, must have room for `count entries
+         @param stack scratch space for pending ranges
          */
-
         template<class T, glm::precision P>
-        void simplify(vector<glm::tvec2<T, P>> in, vector<glm::tvec2<T, P>> &out, T threshold) {
-
-            //
-            //	cometimes a "closed" contour has the last vertex == first
-            //
-
-            while (in.size() > 2 && distanceSquared(in.front(), in.back()) < 1e-4) {
-                in.pop_back();
+        size_t simplify_mask(const glm::tvec2<T, P> *points, size_t count, T threshold, uint8_t *keep, vector<detail::index_range> &stack) {
+            if (count == 0) {
+                return 0;
             }
-
+            
+            std::fill(keep, keep + count, 0);
+            keep[0] = 1;
+            size_t kept = 1;
+            
             //
-            //	Sanity check
+            //  Each range keeps its last point once it's been simplified to a line; its first point is kept by the
+            //  range preceding it, or is points[0]
             //
-
-            if (in.size() <= 2) {
-                out = in;
-                return;
-            }
-
-            //
-            //	Find the vertex farthest from the line defined by the start and and of the path
-            //
-
-            T maxDist = 0;
-            size_t maxDistIndex = 0;
-            line_segment<T, P> line(in.front(), in.back());
-
-            for (auto it(in.begin() + 1), end(in.end()); it != end; ++it) {
-                float dist = line.distance(*it);
-                if (dist > maxDist) {
-                    maxDist = dist;
-                    maxDistIndex = it - in.begin();
-                }
-            }
-
-            //
-            //	If the farthest vertex is greater than our threshold, we need to
-            //	partition and optimize left and right separately
-            //
-
-            if (maxDist > threshold) {
-
+            
+            stack.clear();
+            stack.emplace_back(0, count - 1);
+            while (!stack.empty()) {
+                const size_t first = stack.back().first;
+                size_t last = stack.back().second;
+                stack.pop_back();
+                
                 //
-                //	Partition 'in' into left and right subvectors, and optimize them
+                //	cometimes a "closed" contour has the last vertex == first
                 //
-
-                vector<glm::tvec2<T, P>> left(maxDistIndex + 1),
-                        right(in.size() - maxDistIndex),
-                        leftSimplified,
-                        rightSimplified;
-
-                std::copy(in.begin(), in.begin() + maxDistIndex + 1, left.begin());
-                std::copy(in.begin() + maxDistIndex, in.end(), right.begin());
-
-                simplify(left, leftSimplified, threshold);
-                simplify(right, rightSimplified, threshold);
-
+                
+                while (last - first + 1 > 2 && distanceSquared(points[first], points[last]) < 1e-4) {
+                    last--;
+                }
+                
                 //
-                //	Stitch optimized left and right into 'out'
+                //	If the farthest vertex is greater than our threshold, we need to
+                //	partition and optimize left and right separately
                 //
-
-                out.resize(leftSimplified.size() + rightSimplified.size() - 1);
-                std::copy(leftSimplified.begin(), leftSimplified.end(), out.begin());
-                std::copy(rightSimplified.begin() + 1, rightSimplified.end(), out.begin() + leftSimplified.size());
-            } else {
-                out.resize(2);
-                out.front() = line.a;
-                out.back() = line.b;
+                
+                if (last - first + 1 > 2) {
+                    T maxDist;
+                    const size_t maxDistIndex = detail::farthest_from_segment(points, first, last, maxDist);
+                    if (maxDist > threshold) {
+                        stack.emplace_back(maxDistIndex, last);
+                        stack.emplace_back(first, maxDistIndex);
+                        continue;
+                    }
+                }
+                
+                if (last > first) {
+                    keep[last] = 1;
+                    kept++;
+                }
             }
+            
+            return kept;
         }
-
+        
+        /**
+         Ramer-Douglas-Peucker simplification
+         @param in the path to optimize
+         @param out the optimized path, which may be `in
+         @param threshold the maximum allowed linear deviation from the optimized path to the original path
+         */
+        template<class T, glm::precision P>
+        void simplify(const vector<glm::tvec2<T, P>> &in, vector<glm::tvec2<T, P>> &out, T threshold) {
+            auto &scratch = detail::get_simplification_scratch();
+            scratch.keep.resize(in.size());
+            const size_t kept = simplify_mask(in.data(), in.size(), threshold, scratch.keep.data(), scratch.stack);
+            detail::compact(in, scratch.keep.data(), kept, out);
+        }
+        
         template<class T, class P>
         PolyLineT<T> simplify(const PolyLineT<T> &contour, P threshold) {
             vector<T> result;
             simplify(contour.getPoints(), result, threshold);
-
+            
             PolyLineT<T> pl(result);
             pl.setClosed(contour.isClosed());
             return pl;
         }
-
+        
+        /**
+         Visvalingam-Whyatt simplification of points[0,count): repeatedly drops the interior point forming the smallest
+         triangle with its neighbors until every remaining point's triangle has at least `minArea, writing the keep mask
+         to `keep and returning the number retained. Since points are dropped by area rather than by distance from a chord,
+         this follows the enclosed area of a contour more faithfully than simplify_mask, at some extra cost. A point's area
+         never drops below that of a point removed before it, so the result is the same as removing by effective area.
+         The endpoints are kept, and trailing points which duplicate the first are dropped as simplify_mask does.
+         */
+        template<class T, glm::precision P>
+        size_t visvalingam_mask(const glm::tvec2<T, P> *points, size_t count, T minArea, uint8_t *keep, detail::visvalingam_scratch<T> &scratch) {
+            if (count == 0) {
+                return 0;
+            }
+            
+            size_t last = count - 1;
+            while (last + 1 > 2 && distanceSquared(points[0], points[last]) < 1e-4) {
+                last--;
+            }
+            
+            std::fill(keep, keep + last + 1, 1);
+            std::fill(keep + last + 1, keep + count, 0);
+            
+            size_t kept = last + 1;
+            if (kept <= 2) {
+                return kept;
+            }
+            
+            auto triangleArea = [points](size_t a, size_t b, size_t c) -> T {
+                const glm::tvec2<T, P> ab = points[b] - points[a];
+                const glm::tvec2<T, P> ac = points[c] - points[a];
+                return std::abs(ab.x * ac.y - ab.y * ac.x) * T(0.5);
+            };
+            
+            auto &prev = scratch.prev;
+            auto &next = scratch.next;
+            auto &area = scratch.area;
+            auto &heap = scratch.heap;
+            
+            prev.resize(kept);
+            next.resize(kept);
+            area.resize(kept);
+            heap.clear();
+            
+            for (size_t i = 1; i < last; i++) {
+                prev[i] = i - 1;
+                next[i] = i + 1;
+                area[i] = triangleArea(i - 1, i, i + 1);
+                heap.emplace_back(area[i], i);
+            }
+            
+            // min-heap on (area, index); entries whose area is out of date are skipped as they surface
+            const std::greater<std::pair<T, size_t>> minFirst;
+            std::make_heap(heap.begin(), heap.end(), minFirst);
+            
+            while (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end(), minFirst);
+                const T a = heap.back().first;
+                const size_t i = heap.back().second;
+                heap.pop_back();
+                
+                if (!keep[i] || a != area[i]) {
+                    continue;
+                }
+                
+                if (a >= minArea) {
+                    break;
+                }
+                
+                keep[i] = 0;
+                kept--;
+                
+                const size_t p = prev[i];
+                const size_t n = next[i];
+                next[p] = n;
+                prev[n] = p;
+                
+                if (p > 0) {
+                    area[p] = std::max(triangleArea(prev[p], p, n), a);
+                    heap.emplace_back(area[p], p);
+                    std::push_heap(heap.begin(), heap.end(), minFirst);
+                }
+                
+                if (n < last) {
+                    area[n] = std::max(triangleArea(p, n, next[n]), a);
+                    heap.emplace_back(area[n], n);
+                    std::push_heap(heap.begin(), heap.end(), minFirst);
+                }
+            }
+            
+            return kept;
+        }
+        
+        /**
+         Visvalingam-Whyatt simplification
+         @param in the path to optimize
+         @param out the optimized path, which may be `in
+         @param minArea the minimum area of the triangle each retained point forms with its retained neighbors
+         */
+        template<class T, glm::precision P>
+        void simplify_visvalingam(const vector<glm::tvec2<T, P>> &in, vector<glm::tvec2<T, P>> &out, T minArea) {
+            auto &scratch = detail::get_simplification_scratch();
+            scratch.keep.resize(in.size());
+            const size_t kept = visvalingam_mask(in.data(), in.size(), minArea, scratch.keep.data(), detail::get_visvalingam_scratch<T>());
+            detail::compact(in, scratch.keep.data(), kept, out);
+        }
+        
+        template<class T, class P>
+        PolyLineT<T> simplify_visvalingam(const PolyLineT<T> &contour, P minArea) {
+            vector<T> result;
+            simplify_visvalingam(contour.getPoints(), result, minArea);
+            
+            PolyLineT<T> pl(result);
+            pl.setClosed(contour.isClosed());
+            return pl;
+        }
+        
         /**
          @brief Remove vertices which are closer than @a threshold to the previous vertex
          */
-
+        
         template<class T, glm::precision P>
         void dedup(const vector<glm::tvec2<T, P>> &in, vector<glm::tvec2<T, P>> &out, T threshold) {
             T threshold2 = threshold * threshold;
@@ -122,7 +316,7 @@ namespace core {
                 }
             }
         }
-
+        
         /**
          Ramer-Douglas-Peucker simplification with deduplication - this is probably unnecessary.
          @param in the path to optimize
@@ -135,6 +329,86 @@ namespace core {
             simplify(in, collector, threshold);
             dedup(collector, out, 1);
         }
+        
+        namespace reference {
+            
+            /**
+             The original recursive Ramer-Douglas-Peucker simplification, which copies each partition before recursing
+             into it. Kept to verify simplify_mask against.
+             */
+            template<class T, glm::precision P>
+            void simplify(vector<glm::tvec2<T, P>> in, vector<glm::tvec2<T, P>> &out, T threshold) {
+                
+                //
+                //	cometimes a "closed" contour has the last vertex == first
+                //
+                
+                while (in.size() > 2 && distanceSquared(in.front(), in.back()) < 1e-4) {
+                    in.pop_back();
+                }
+                
+                //
+                //	Sanity check
+                //
+                
+                if (in.size() <= 2) {
+                    out = in;
+                    return;
+                }
+                
+                //
+                //	Find the vertex farthest from the line defined by the start and and of the path
+                //
+                
+                T maxDist = 0;
+                size_t maxDistIndex = 0;
+                line_segment<T, P> line(in.front(), in.back());
+                
+                for (auto it(in.begin() + 1), end(in.end()); it != end; ++it) {
+                    float dist = line.distance(*it);
+                    if (dist > maxDist) {
+                        maxDist = dist;
+                        maxDistIndex = it - in.begin();
+                    }
+                }
+                
+                //
+                //	If the farthest vertex is greater than our threshold, we need to
+                //	partition and optimize left and right separately
+                //
+                
+                if (maxDist > threshold) {
+                    
+                    //
+                    //	Partition 'in' into left and right subvectors, and optimize them
+                    //
+                    
+                    vector<glm::tvec2<T, P>> left(maxDistIndex + 1),
+                    right(in.size() - maxDistIndex),
+                    leftSimplified,
+                    rightSimplified;
+                    
+                    std::copy(in.begin(), in.begin() + maxDistIndex + 1, left.begin());
+                    std::copy(in.begin() + maxDistIndex, in.end(), right.begin());
+                    
+                    simplify(left, leftSimplified, threshold);
+                    simplify(right, rightSimplified, threshold);
+                    
+                    //
+                    //	Stitch optimized left and right into 'out'
+                    //
+                    
+                    out.resize(leftSimplified.size() + rightSimplified.size() - 1);
+                    std::copy(leftSimplified.begin(), leftSimplified.end(), out.begin());
+                    std::copy(rightSimplified.begin() + 1, rightSimplified.end(), out.begin() + leftSimplified.size());
+                } else {
+                    out.resize(2);
+                    out.front() = line.a;
+                    out.back() = line.b;
+                }
+            }
+            
+        }
     }
 }
 
@@ -0,0 +1,338 @@
+//
+//  GradientNoise.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/20/18.
+//
+
+#include "core/util/GradientNoise.hpp"
+
+#include <cinder/Rand.h>
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#define GN_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#include "core/util/ImageProcessing.hpp"
+
+namespace core {
+    namespace util {
+        
+        namespace {
+            
+            /*
+             The scalar functions are the definition of the noise, transcribed from ci::Perlin. The SIMD versions perform
+             the same float operations in the same order per lane, so they produce identical output; they differ only in
+             how the permutation table lookups are made.
+             */
+            
+            namespace scalar {
+                
+                inline float fade(float t) {
+                    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+                }
+                
+                inline float lerp(float t, float a, float b) {
+                    return a + t * (b - a);
+                }
+                
+                inline float grad(int32_t hash, float x) {
+                    const int32_t h = hash & 15;
+                    const float u = h < 8 ? x : 0;
+                    const float v = h < 4 ? 0 : h == 12 || h == 14 ? x : 0;
+                    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+                }
+                
+                inline float grad(int32_t hash, float x, float y) {
+                    const int32_t h = hash & 15;
+                    const float u = h < 8 ? x : y;
+                    const float v = h < 4 ? y : h == 12 || h == 14 ? x : 0;
+                    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+                }
+                
+                inline float noise(const int32_t *perms, float x) {
+                    const float fx = floorf(x);
+                    const int32_t X = static_cast<int32_t>(fx) & 255;
+                    x -= fx;
+                    const float u = fade(x);
+                    const int32_t A = perms[X], AA = perms[A], B = perms[X + 1], BA = perms[B];
+                    return lerp(u, grad(perms[AA], x), grad(perms[BA], x - 1));
+                }
+                
+                inline float noise(const int32_t *perms, float x, float y) {
+                    const float fx = floorf(x), fy = floorf(y);
+                    const int32_t X = static_cast<int32_t>(fx) & 255, Y = static_cast<int32_t>(fy) & 255;
+                    x -= fx;
+                    y -= fy;
+                    const float u = fade(x), v = fade(y);
+                    const int32_t A = perms[X] + Y, AA = perms[A], AB = perms[A + 1];
+                    const int32_t B = perms[X + 1] + Y, BA = perms[B], BB = perms[B + 1];
+                    return lerp(v, lerp(u, grad(perms[AA], x, y), grad(perms[BA], x - 1, y)),
+                                lerp(u, grad(perms[AB], x, y - 1), grad(perms[BB], x - 1, y - 1)));
+                }
+                
+                inline float fBm(const int32_t *perms, uint8_t octaves, float x) {
+                    float result = 0;
+                    float amp = 0.5f;
+                    for (uint8_t i = 0; i < octaves; i++) {
+                        result += noise(perms, x) * amp;
+                        x *= 2.0f;
+                        amp *= 0.5f;
+                    }
+                    return result;
+                }
+                
+                inline float fBm(const int32_t *perms, uint8_t octaves, float x, float y) {
+                    float result = 0;
+                    float amp = 0.5f;
+                    for (uint8_t i = 0; i < octaves; i++) {
+                        result += noise(perms, x, y) * amp;
+                        x *= 2.0f;
+                        y *= 2.0f;
+                        amp *= 0.5f;
+                    }
+                    return result;
+                }
+                
+                void fBm(const int32_t *perms, uint8_t octaves, const float *x, const float *y, float *out, size_t count) {
+                    for (size_t i = 0; i < count; i++) {
+                        out[i] = fBm(perms, octaves, x[i], y[i]);
+                    }
+                }
+                
+            }
+
+#if GN_X86_SIMD
+            
+            namespace sse2 {
+                
+                inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+                    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+                }
+                
+                inline __m128 fade(__m128 t) {
+                    const __m128 poly = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+                    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), poly);
+                }
+                
+                inline __m128 lerp(__m128 t, __m128 a, __m128 b) {
+                    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+                }
+                
+                inline __m128 grad(__m128i hash, __m128 x, __m128 y) {
+                    const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+                    const __m128 lt8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+                    const __m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+                    // h == 12 || h == 14 iff (h | 2) == 14
+                    const __m128 is12or14 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(14)));
+                    const __m128 u = select(lt8, x, y);
+                    const __m128 v = select(lt4, y, _mm_and_ps(is12or14, x));
+                    // negate by flipping the sign bit, which is exactly what scalar negation does
+                    const __m128 uSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+                    const __m128 vSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+                    return _mm_add_ps(_mm_xor_ps(u, uSign), _mm_xor_ps(v, vSign));
+                }
+                
+                // floorf, for |x| < 2^31; SSE2 has no floor instruction so truncate and step down where that rounded up
+                inline __m128 floor(__m128 x, __m128i &ix) {
+                    const __m128i t = _mm_cvttps_epi32(x);
+                    const __m128 ft = _mm_cvtepi32_ps(t);
+                    const __m128 roundedUp = _mm_cmpgt_ps(ft, x);
+                    ix = _mm_add_epi32(t, _mm_castps_si128(roundedUp));
+                    const __m128 f = _mm_sub_ps(ft, _mm_and_ps(roundedUp, _mm_set1_ps(1.0f)));
+                    // floorf(-0) is -0
+                    return select(_mm_cmpeq_ps(x, _mm_setzero_ps()), x, f);
+                }
+                
+                inline __m128 noise(const int32_t *perms, __m128 x, __m128 y) {
+                    __m128i ix, iy;
+                    const __m128 fx = floor(x, ix), fy = floor(y, iy);
+                    x = _mm_sub_ps(x, fx);
+                    y = _mm_sub_ps(y, fy);
+                    
+                    alignas(16) int32_t X[4], Y[4], hAA[4], hBA[4], hAB[4], hBB[4];
+                    _mm_store_si128(reinterpret_cast<__m128i *>(X), _mm_and_si128(ix, _mm_set1_epi32(255)));
+                    _mm_store_si128(reinterpret_cast<__m128i *>(Y), _mm_and_si128(iy, _mm_set1_epi32(255)));
+                    for (int l = 0; l < 4; l++) {
+                        const int32_t A = perms[X[l]] + Y[l], B = perms[X[l] + 1] + Y[l];
+                        hAA[l] = perms[perms[A]];
+                        hAB[l] = perms[perms[A + 1]];
+                        hBA[l] = perms[perms[B]];
+                        hBB[l] = perms[perms[B + 1]];
+                    }
+                    
+                    const __m128 u = fade(x), v = fade(y);
+                    const __m128 x1 = _mm_sub_ps(x, _mm_set1_ps(1.0f)), y1 = _mm_sub_ps(y, _mm_set1_ps(1.0f));
+                    const __m128 gAA = grad(_mm_load_si128(reinterpret_cast<const __m128i *>(hAA)), x, y);
+                    const __m128 gBA = grad(_mm_load_si128(reinterpret_cast<const __m128i *>(hBA)), x1, y);
+                    const __m128 gAB = grad(_mm_load_si128(reinterpret_cast<const __m128i *>(hAB)), x, y1);
+                    const __m128 gBB = grad(_mm_load_si128(reinterpret_cast<const __m128i *>(hBB)), x1, y1);
+                    return lerp(v, lerp(u, gAA, gBA), lerp(u, gAB, gBB));
+                }
+                
+                void fBm(const int32_t *perms, uint8_t octaves, const float *xs, const float *ys, float *out, size_t count) {
+                    size_t i = 0;
+                    for (; i + 4 <= count; i += 4) {
+                        __m128 x = _mm_loadu_ps(xs + i), y = _mm_loadu_ps(ys + i);
+                        __m128 result = _mm_setzero_ps();
+                        float amp = 0.5f;
+                        for (uint8_t o = 0; o < octaves; o++) {
+                            result = _mm_add_ps(result, _mm_mul_ps(noise(perms, x, y), _mm_set1_ps(amp)));
+                            x = _mm_mul_ps(x, _mm_set1_ps(2.0f));
+                            y = _mm_mul_ps(y, _mm_set1_ps(2.0f));
+                            amp *= 0.5f;
+                        }
+                        _mm_storeu_ps(out + i, result);
+                    }
+                    scalar::fBm(perms, octaves, xs + i, ys + i, out + i, count - i);
+                }
+                
+            }
+            
+            namespace avx2 {
+                
+                // compiled for AVX2 regardless of the target's baseline; only called after a cpuid check
+#define GN_AVX2 __attribute__((target("avx2")))
+                
+                GN_AVX2 inline __m256 select(__m256 mask, __m256 a, __m256 b) {
+                    return _mm256_blendv_ps(b, a, mask);
+                }
+                
+                GN_AVX2 inline __m256 fade(__m256 t) {
+                    const __m256 poly = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+                    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), poly);
+                }
+                
+                GN_AVX2 inline __m256 lerp(__m256 t, __m256 a, __m256 b) {
+                    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+                }
+                
+                GN_AVX2 inline __m256 grad(__m256i hash, __m256 x, __m256 y) {
+                    const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+                    const __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+                    const __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+                    const __m256 is12or14 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_or_si256(h, _mm256_set1_epi32(2)), _mm256_set1_epi32(14)));
+                    const __m256 u = select(lt8, x, y);
+                    const __m256 v = select(lt4, y, _mm256_and_ps(is12or14, x));
+                    const __m256 uSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+                    const __m256 vSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+                    return _mm256_add_ps(_mm256_xor_ps(u, uSign), _mm256_xor_ps(v, vSign));
+                }
+                
+                GN_AVX2 inline __m256i lookup(const int32_t *perms, __m256i index) {
+                    return _mm256_i32gather_epi32(perms, index, 4);
+                }
+                
+                GN_AVX2 inline __m256 noise(const int32_t *perms, __m256 x, __m256 y) {
+                    const __m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y);
+                    const __m256i mask = _mm256_set1_epi32(255), one = _mm256_set1_epi32(1);
+                    const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask), Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+                    x = _mm256_sub_ps(x, fx);
+                    y = _mm256_sub_ps(y, fy);
+                    
+                    const __m256i A = _mm256_add_epi32(lookup(perms, X), Y), B = _mm256_add_epi32(lookup(perms, _mm256_add_epi32(X, one)), Y);
+                    const __m256i hAA = lookup(perms, lookup(perms, A)), hAB = lookup(perms, lookup(perms, _mm256_add_epi32(A, one)));
+                    const __m256i hBA = lookup(perms, lookup(perms, B)), hBB = lookup(perms, lookup(perms, _mm256_add_epi32(B, one)));
+                    
+                    const __m256 u = fade(x), v = fade(y);
+                    const __m256 x1 = _mm256_sub_ps(x, _mm256_set1_ps(1.0f)), y1 = _mm256_sub_ps(y, _mm256_set1_ps(1.0f));
+                    return lerp(v, lerp(u, grad(hAA, x, y), grad(hBA, x1, y)),
+                                lerp(u, grad(hAB, x, y1), grad(hBB, x1, y1)));
+                }
+                
+                GN_AVX2 void fBm(const int32_t *perms, uint8_t octaves, const float *xs, const float *ys, float *out, size_t count) {
+                    size_t i = 0;
+                    for (; i + 8 <= count; i += 8) {
+                        __m256 x = _mm256_loadu_ps(xs + i), y = _mm256_loadu_ps(ys + i);
+                        __m256 result = _mm256_setzero_ps();
+                        float amp = 0.5f;
+                        for (uint8_t o = 0; o < octaves; o++) {
+                            result = _mm256_add_ps(result, _mm256_mul_ps(noise(perms, x, y), _mm256_set1_ps(amp)));
+                            x = _mm256_mul_ps(x, _mm256_set1_ps(2.0f));
+                            y = _mm256_mul_ps(y, _mm256_set1_ps(2.0f));
+                            amp *= 0.5f;
+                        }
+                        _mm256_storeu_ps(out + i, result);
+                    }
+                    sse2::fBm(perms, octaves, xs + i, ys + i, out + i, count - i);
+                }
+
+#undef GN_AVX2
+                
+            }
+
+#endif
+            
+            void fBm_batch(const int32_t *perms, uint8_t octaves, const float *x, const float *y, float *out, size_t count) {
+                switch (ip::get_simd_level()) {
+#if GN_X86_SIMD
+                    case ip::SIMD_AVX2:
+                        avx2::fBm(perms, octaves, x, y, out, count);
+                        return;
+                    case ip::SIMD_SSE2:
+                        sse2::fBm(perms, octaves, x, y, out, count);
+                        return;
+#endif
+                    default:
+                        scalar::fBm(perms, octaves, x, y, out, count);
+                        return;
+                }
+            }
+            
+        }
+        
+        /*
+         uint8_t _octaves;
+         int32_t _seed;
+         int32_t _perms[512];
+         */
+        
+        GradientNoise::GradientNoise(uint8_t octaves, int32_t seed) :
+        _octaves(octaves),
+        _seed(seed) {
+            // built the same way as ci::Perlin's table, which is what makes the output match it
+            ci::Rand rand(static_cast<uint32_t>(seed));
+            for (size_t t = 0; t < 256; ++t) {
+                _perms[t] = _perms[t + 256] = rand.nextUint() & 255;
+            }
+        }
+        
+        float GradientNoise::noise(float x) const {
+            return scalar::noise(_perms, x);
+        }
+        
+        float GradientNoise::noise(float x, float y) const {
+            return scalar::noise(_perms, x, y);
+        }
+        
+        float GradientNoise::fBm(float x) const {
+            return scalar::fBm(_perms, _octaves, x);
+        }
+        
+        float GradientNoise::fBm(float x, float y) const {
+            return scalar::fBm(_perms, _octaves, x, y);
+        }
+        
+        void GradientNoise::fBm(const float *x, float *out, size_t count) const {
+            // 1D noise is only needed a few samples at a time (e.g. animation wobble), so this isn't vectorized
+            for (size_t i = 0; i < count; i++) {
+                out[i] = scalar::fBm(_perms, _octaves, x[i]);
+            }
+        }
+        
+        void GradientNoise::fBm(const float *x, const float *y, float *out, size_t count) const {
+            fBm_batch(_perms, _octaves, x, y, out, count);
+        }
+        
+        void GradientNoise::fBm(const float *x, float y, float *out, size_t count) const {
+            const size_t chunk = 64;
+            float ys[chunk];
+            std::fill(ys, ys + chunk, y);
+            for (size_t i = 0; i < count; i += chunk) {
+                fBm_batch(_perms, _octaves, x + i, ys, out + i, min(chunk, count - i));
+            }
+        }
+        
+    }
+} // end namespace core::util
@@ -5,10 +5,19 @@
 //  Created by Shamyl Zakariya on 11/30/17.
 //
 
+#include <atomic>
+#include <cstring>
+#include <functional>
 #include <queue>
-#include <thread>
+#include <unordered_map>
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#define IP_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 #include "core/util/ImageProcessing.hpp"
+#include "core/util/ThreadPool.hpp"
 
 namespace core {
     namespace util {
@@ -45,19 +54,393 @@ namespace core {
                     }
                 }
                 
-                size_t _threads = 0;
-                size_t get_num_threads() {
-                    if (_threads == 0) {
-                        _threads = std::thread::hardware_concurrency();
-                        CI_LOG_D("_threads: " << _threads);
+                // rows are processed in chunks of about this many pixels, so a chunk's source and destination rows stay in cache
+                const int CHUNK_PIXELS = 64 * 1024;
+                
+                /*
+                 Split the rows of a `width x `height channel into chunks of roughly CHUNK_PIXELS, but no fewer than `minRows rows,
+                 and run `fn on each chunk's area across the shared ThreadPool
+                 */
+                void for_each_row_chunk(int width, int height, int minRows, const function<void(Area)> &fn) {
+                    const int rows = max(CHUNK_PIXELS / max(width, 1), max(minRows, 1));
+                    const size_t chunks = static_cast<size_t>((max(height, 0) + rows - 1) / rows);
+                    ThreadPool::shared().parallelFor(chunks, [&](size_t idx) {
+                        const int y1 = static_cast<int>(idx) * rows;
+                        fn(Area(0, y1, width, min(y1 + rows, height)));
+                    });
+                }
+                
+                // true if pixels in each row are contiguous, which the row kernels require
+                bool is_packed(const Channel8u &channel) {
+                    return channel.getIncrement() == 1;
+                }
+                
+                // this thread's scratch channel for the intermediate pass of a separable filter whose caller didn't provide one,
+                // sized to `src; it's only reallocated when the size changes
+                Channel8u &thread_scratch(const Channel8u &src) {
+                    thread_local Channel8u scratch;
+                    if (scratch.getSize() != src.getSize()) {
+                        scratch = Channel8u(src.getWidth(), src.getHeight());
                     }
-                    return _threads;
+                    return scratch;
                 }
-
-                Area get_thread_working_area(int channelWidth, int channelHeight, size_t threadIdx) {
-                    size_t count = get_num_threads();
-                    return Area(0, static_cast<int>(threadIdx * channelHeight / count), channelWidth, static_cast<int>((threadIdx+1) * channelHeight / count));
+                
+                // copy row `y of `channel to `out, unless `out already is that row
+                void read_row(const Channel8u &channel, int y, uint8_t *out) {
+                    const uint8_t *in = channel.getData(ivec2(0, y));
+                    if (in == out) {
+                        return;
+                    }
+                    
+                    const int width = channel.getWidth(), increment = channel.getIncrement();
+                    if (increment == 1) {
+                        memcpy(out, in, width);
+                    } else {
+                        for (int x = 0; x < width; x++) {
+                            out[x] = in[x * increment];
+                        }
+                    }
+                }
+                
+                void write_row(Channel8u &channel, int y, const uint8_t *in) {
+                    uint8_t *out = channel.getData(ivec2(0, y));
+                    const int width = channel.getWidth(), increment = channel.getIncrement();
+                    for (int x = 0; x < width; x++) {
+                        out[x * increment] = in[x];
+                    }
+                }
+                
+                void run_ops(const vector<row_op> &ops, uint8_t *row, int y, int width) {
+                    for (const auto &op : ops) {
+                        op(row, y, width);
+                    }
+                }
+                
+                // evaluate noise.fBm(frequency * x, frequency * y) across row `y in batches, calling fn(pixels, values, count) for each batch
+                template<class FN>
+                void for_each_noise_batch(const GradientNoise &noise, double frequency, uint8_t *row, int y, int width, const FN &fn) {
+                    const int batch = 64;
+                    float xs[batch], values[batch];
+                    const float fy = static_cast<float>(frequency * y);
+                    for (int x0 = 0; x0 < width; x0 += batch) {
+                        const int count = min(batch, width - x0);
+                        for (int i = 0; i < count; i++) {
+                            xs[i] = static_cast<float>(frequency * (x0 + i));
+                        }
+                        noise.fBm(xs, fy, values, count);
+                        fn(row + x0, values, count);
+                    }
+                }
+            }
+            
+#pragma mark - Row Kernels
+            
+            namespace {
+                
+                /*
+                 Row kernels process `count contiguous pixels. Each has a scalar, SSE2 and AVX2 implementation which must
+                 produce identical output; the SIMD versions finish any remainder with the scalar version.
+                 */
+                
+                struct row_kernels {
+                    void (*threshold)(const uint8_t *src, uint8_t *dst, size_t count, uint8_t threshV, uint8_t maxV, uint8_t minV);
+                    void (*remap)(const uint8_t *src, uint8_t *dst, size_t count, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue);
+                    void (*fill)(uint8_t *dst, size_t count, uint8_t value);
+                    void (*max)(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count);
+                    void (*min)(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count);
+                    
+                    // sums += add - sub, for running sums down columns
+                    void (*accumulate)(uint32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count);
+                    
+                    // dst = (sums + offset) * scale, truncated; the running sum average used by box blur
+                    void (*divide)(const uint32_t *sums, float offset, float scale, uint8_t *dst, size_t count);
+                };
+                
+                namespace scalar {
+                    
+                    void threshold(const uint8_t *src, uint8_t *dst, size_t count, uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                        for (size_t i = 0; i < count; i++) {
+                            dst[i] = src[i] >= threshV ? maxV : minV;
+                        }
+                    }
+                    
+                    void remap(const uint8_t *src, uint8_t *dst, size_t count, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                        for (size_t i = 0; i < count; i++) {
+                            dst[i] = src[i] == targetValue ? newTargetValue : defaultValue;
+                        }
+                    }
+                    
+                    void fill(uint8_t *dst, size_t count, uint8_t value) {
+                        memset(dst, value, count);
+                    }
+                    
+                    void max(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        for (size_t i = 0; i < count; i++) {
+                            dst[i] = std::max(a[i], b[i]);
+                        }
+                    }
+                    
+                    void min(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        for (size_t i = 0; i < count; i++) {
+                            dst[i] = std::min(a[i], b[i]);
+                        }
+                    }
+                    
+                    void accumulate(uint32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count) {
+                        for (size_t i = 0; i < count; i++) {
+                            sums[i] += add[i] - sub[i];
+                        }
+                    }
+                    
+                    void divide(const uint32_t *sums, float offset, float scale, uint8_t *dst, size_t count) {
+                        for (size_t i = 0; i < count; i++) {
+                            dst[i] = static_cast<uint8_t>((static_cast<float>(sums[i]) + offset) * scale);
+                        }
+                    }
+                    
+                    const row_kernels kernels = { &threshold, &remap, &fill, &max, &min, &accumulate, &divide };
+                    
+                }
+                
+#if IP_X86_SIMD
+                
+                namespace sse2 {
+                    
+                    // select a where mask is set, b elsewhere
+                    inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+                        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+                    }
+                    
+                    void threshold(const uint8_t *src, uint8_t *dst, size_t count, uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                        const __m128i t = _mm_set1_epi8(static_cast<char>(threshV)), hi = _mm_set1_epi8(static_cast<char>(maxV)), lo = _mm_set1_epi8(static_cast<char>(minV));
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                            // unsigned v >= t iff max(v,t) == v
+                            const __m128i mask = _mm_cmpeq_epi8(_mm_max_epu8(v, t), v);
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), select(mask, hi, lo));
+                        }
+                        scalar::threshold(src + i, dst + i, count - i, threshV, maxV, minV);
+                    }
+                    
+                    void remap(const uint8_t *src, uint8_t *dst, size_t count, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                        const __m128i t = _mm_set1_epi8(static_cast<char>(targetValue)), hi = _mm_set1_epi8(static_cast<char>(newTargetValue)), lo = _mm_set1_epi8(static_cast<char>(defaultValue));
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), select(_mm_cmpeq_epi8(v, t), hi, lo));
+                        }
+                        scalar::remap(src + i, dst + i, count - i, targetValue, newTargetValue, defaultValue);
+                    }
+                    
+                    void fill(uint8_t *dst, size_t count, uint8_t value) {
+                        const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+                        }
+                        scalar::fill(dst + i, count - i, value);
+                    }
+                    
+                    void max(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_max_epu8(va, vb));
+                        }
+                        scalar::max(a + i, b + i, dst + i, count - i);
+                    }
+                    
+                    void min(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_min_epu8(va, vb));
+                        }
+                        scalar::min(a + i, b + i, dst + i, count - i);
+                    }
+                    
+                    void accumulate(uint32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count) {
+                        const __m128i zero = _mm_setzero_si128();
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i));
+                            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i));
+                            
+                            // widen to 16 bits, take the difference, and widen again with sign extension
+                            const __m128i d[2] = {
+                                _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                                _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero))
+                            };
+                            
+                            for (int j = 0; j < 2; j++) {
+                                __m128i *s = reinterpret_cast<__m128i *>(sums + i + j * 8);
+                                const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(d[j], d[j]), 16);
+                                const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(d[j], d[j]), 16);
+                                _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), lo));
+                                _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), hi));
+                            }
+                        }
+                        scalar::accumulate(sums + i, add + i, sub + i, count - i);
+                    }
+                    
+                    void divide(const uint32_t *sums, float offset, float scale, uint8_t *dst, size_t count) {
+                        const __m128 o = _mm_set1_ps(offset), m = _mm_set1_ps(scale);
+                        size_t i = 0;
+                        for (; i + 16 <= count; i += 16) {
+                            __m128i q[4];
+                            for (int j = 0; j < 4; j++) {
+                                const __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + i + j * 4)));
+                                q[j] = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(v, o), m));
+                            }
+                            const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+                        }
+                        scalar::divide(sums + i, offset, scale, dst + i, count - i);
+                    }
+                    
+                    const row_kernels kernels = { &threshold, &remap, &fill, &max, &min, &accumulate, &divide };
+                    
+                }
+                
+                namespace avx2 {
+                    
+                    // compiled for AVX2 regardless of the target's baseline; only called after a cpuid check
+#define IP_AVX2 __attribute__((target("avx2")))
+                    
+                    IP_AVX2 inline __m256i select(__m256i mask, __m256i a, __m256i b) {
+                        return _mm256_blendv_epi8(b, a, mask);
+                    }
+                    
+                    IP_AVX2 void threshold(const uint8_t *src, uint8_t *dst, size_t count, uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                        const __m256i t = _mm256_set1_epi8(static_cast<char>(threshV)), hi = _mm256_set1_epi8(static_cast<char>(maxV)), lo = _mm256_set1_epi8(static_cast<char>(minV));
+                        size_t i = 0;
+                        for (; i + 32 <= count; i += 32) {
+                            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+                            const __m256i mask = _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v);
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), select(mask, hi, lo));
+                        }
+                        sse2::threshold(src + i, dst + i, count - i, threshV, maxV, minV);
+                    }
+                    
+                    IP_AVX2 void remap(const uint8_t *src, uint8_t *dst, size_t count, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                        const __m256i t = _mm256_set1_epi8(static_cast<char>(targetValue)), hi = _mm256_set1_epi8(static_cast<char>(newTargetValue)), lo = _mm256_set1_epi8(static_cast<char>(defaultValue));
+                        size_t i = 0;
+                        for (; i + 32 <= count; i += 32) {
+                            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), select(_mm256_cmpeq_epi8(v, t), hi, lo));
+                        }
+                        sse2::remap(src + i, dst + i, count - i, targetValue, newTargetValue, defaultValue);
+                    }
+                    
+                    IP_AVX2 void fill(uint8_t *dst, size_t count, uint8_t value) {
+                        const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+                        size_t i = 0;
+                        for (; i + 32 <= count; i += 32) {
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), v);
+                        }
+                        sse2::fill(dst + i, count - i, value);
+                    }
+                    
+                    IP_AVX2 void max(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        size_t i = 0;
+                        for (; i + 32 <= count; i += 32) {
+                            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+                            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_max_epu8(va, vb));
+                        }
+                        sse2::max(a + i, b + i, dst + i, count - i);
+                    }
+                    
+                    IP_AVX2 void min(const uint8_t *a, const uint8_t *b, uint8_t *dst, size_t count) {
+                        size_t i = 0;
+                        for (; i + 32 <= count; i += 32) {
+                            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+                            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_min_epu8(va, vb));
+                        }
+                        sse2::min(a + i, b + i, dst + i, count - i);
+                    }
+                    
+                    IP_AVX2 void accumulate(uint32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count) {
+                        size_t i = 0;
+                        for (; i + 8 <= count; i += 8) {
+                            const __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(add + i)));
+                            const __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(sub + i)));
+                            __m256i *s = reinterpret_cast<__m256i *>(sums + i);
+                            _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(a, b)));
+                        }
+                        sse2::accumulate(sums + i, add + i, sub + i, count - i);
+                    }
+                    
+                    IP_AVX2 void divide(const uint32_t *sums, float offset, float scale, uint8_t *dst, size_t count) {
+                        const __m256 o = _mm256_set1_ps(offset), m = _mm256_set1_ps(scale);
+                        size_t i = 0;
+                        for (; i + 8 <= count; i += 8) {
+                            const __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(sums + i)));
+                            const __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(v, o), m));
+                            const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+                            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(words, words));
+                        }
+                        sse2::divide(sums + i, offset, scale, dst + i, count - i);
+                    }
+                    
+#undef IP_AVX2
+                    
+                    const row_kernels kernels = { &threshold, &remap, &fill, &max, &min, &accumulate, &divide };
+                    
+                }
+                
+#endif
+                
+                SimdLevel detect_simd_level() {
+#if IP_X86_SIMD
+                    if (__builtin_cpu_supports("avx2")) {
+                        return SIMD_AVX2;
+                    }
+                    if (__builtin_cpu_supports("sse2")) {
+                        return SIMD_SSE2;
+                    }
+#endif
+                    return SIMD_NONE;
+                }
+                
+                std::atomic<int> _simdLevel(-1);
+                
+                const row_kernels &get_row_kernels() {
+                    switch (get_simd_level()) {
+#if IP_X86_SIMD
+                        case SIMD_AVX2:
+                            return avx2::kernels;
+                        case SIMD_SSE2:
+                            return sse2::kernels;
+#endif
+                        default:
+                            return scalar::kernels;
+                    }
+                }
+                
+            }
+            
+            SimdLevel get_supported_simd_level() {
+                static const SimdLevel supported = detect_simd_level();
+                return supported;
+            }
+            
+            void set_simd_level(SimdLevel level) {
+                _simdLevel = min(level, get_supported_simd_level());
+                CI_LOG_D("simd level: " << _simdLevel);
+            }
+            
+            SimdLevel get_simd_level() {
+                int level = _simdLevel;
+                if (level < 0) {
+                    level = get_supported_simd_level();
+                    _simdLevel = level;
                 }
+                return static_cast<SimdLevel>(level);
             }
             
             namespace {
@@ -90,26 +473,134 @@ namespace core {
 
             }
 
+#pragma mark - van Herk/Gil-Werman
+            
+            namespace {
+                
+                /*
+                 Dilate and erode are separable max/min filters over a square (2r+1)^2 window. The van Herk/Gil-Werman
+                 algorithm computes a running max/min over a window of w = 2r+1 in three comparisons per pixel regardless
+                 of radius: the padded input is cut into blocks of w, prefix maxima `g are computed forward within each block
+                 and suffix maxima `h backwards, and the window starting at i is max(h[i], g[i + w - 1]). Pixels outside
+                 the channel are padded with the op's identity (0 for max, 255 for min), which matches the original
+                 kernels skipping them.
+                 */
+                
+                template<class OP>
+                void van_herk_horizontal(const Channel8u &src, Channel8u &dst, Area area, int radius, uint8_t identity, OP op) {
+                    const int width = src.getWidth();
+                    const int w = 2 * radius + 1;
+                    const int n = width + 2 * radius;
+                    vector<uint8_t> padded(n, identity), g(n), h(n);
+                    
+                    for (int y = area.y1; y < area.y2; y++) {
+                        memcpy(padded.data() + radius, src.getData(ivec2(0, y)), width);
+                        
+                        for (int i = 0; i < n; i++) {
+                            g[i] = (i % w == 0) ? padded[i] : op(g[i - 1], padded[i]);
+                        }
+                        
+                        for (int i = n - 1; i >= 0; i--) {
+                            h[i] = (i == n - 1 || i % w == w - 1) ? padded[i] : op(h[i + 1], padded[i]);
+                        }
+                        
+                        uint8_t *out = dst.getData(ivec2(0, y));
+                        for (int x = 0; x < width; x++) {
+                            out[x] = op(h[x], g[x + w - 1]);
+                        }
+                    }
+                }
+                
+                /*
+                 The vertical pass runs the same algorithm with whole rows as elements, so every step is a row kernel.
+                 Blocks are streamed so only one block of suffix rows and one block of prefix rows are kept.
+                 */
+                void van_herk_vertical(const Channel8u &src, Channel8u &dst, Area area, int radius, uint8_t identity,
+                                       void (*op)(const uint8_t *, const uint8_t *, uint8_t *, size_t)) {
+                    const int width = src.getWidth(), height = src.getHeight();
+                    const int w = 2 * radius + 1;
+                    const int rows = area.y2 - area.y1;
+                    const int n = rows + 2 * radius;
+                    
+                    vector<uint8_t> identityRow(width, identity), g(w * width), h(w * width);
+                    auto padded = [&](int i) -> const uint8_t * {
+                        const int y = area.y1 - radius + i;
+                        return (y < 0 || y >= height) ? identityRow.data() : src.getData(ivec2(0, y));
+                    };
+                    auto gRow = [&](int j) {
+                        return g.data() + j * width;
+                    };
+                    auto hRow = [&](int j) {
+                        return h.data() + j * width;
+                    };
+                    
+                    for (int blockStart = 0; blockStart < rows; blockStart += w) {
+                        
+                        // suffix of this block; a block containing an output row is always complete
+                        memcpy(hRow(w - 1), padded(blockStart + w - 1), width);
+                        for (int j = w - 2; j >= 0; j--) {
+                            op(hRow(j + 1), padded(blockStart + j), hRow(j), width);
+                        }
+                        
+                        // prefix of the next block, as far as the padded input goes
+                        const int nextStart = blockStart + w, nextCount = min(w, n - nextStart);
+                        if (nextCount > 0) {
+                            memcpy(gRow(0), padded(nextStart), width);
+                            for (int j = 1; j < nextCount; j++) {
+                                op(gRow(j - 1), padded(nextStart + j), gRow(j), width);
+                            }
+                        }
+                        
+                        for (int j = 0, end = min(w, rows - blockStart); j < end; j++) {
+                            uint8_t *out = dst.getData(ivec2(0, area.y1 + blockStart + j));
+                            if (j == 0) {
+                                memcpy(out, hRow(0), width);
+                            } else {
+                                op(hRow(j), gRow(j - 1), out, width);
+                            }
+                        }
+                    }
+                }
+                
+                template<class OP>
+                void van_herk(const Channel8u &src, Channel8u &dst, int radius, uint8_t identity, OP op,
+                              void (*rowOp)(const uint8_t *, const uint8_t *, uint8_t *, size_t)) {
+                    Channel8u &horizontalPass = thread_scratch(src);
+                    
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                        van_herk_horizontal(src, horizontalPass, area, radius, identity, op);
+                    });
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 4 * (2 * radius + 1), [&](Area area) {
+                        van_herk_vertical(horizontalPass, dst, area, radius, identity, rowOp);
+                    });
+                }
+                
+                struct max_op {
+                    uint8_t operator()(uint8_t a, uint8_t b) const {
+                        return a > b ? a : b;
+                    }
+                };
+                
+                struct min_op {
+                    uint8_t operator()(uint8_t a, uint8_t b) const {
+                        return a < b ? a : b;
+                    }
+                };
+                
+            }
+            
             void dilate(const Channel8u &src, Channel8u &dst, int radius) {
-
+                
                 if (dst.getSize() != src.getSize()) {
                     dst = Channel8u(src.getWidth(), src.getHeight());
                 }
                 
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&dilate_area, std::ref(src), std::ref(dst), workingArea, radius));
-                    }
-                    
-                    for(auto &t : threads) { t.join(); }
-                    
-                } else {
-                    dilate_area(src, dst, src.getBounds(), radius);
+                if (radius < 0 || !is_packed(src) || !is_packed(dst)) {
+                    reference::dilate(src, dst, radius);
+                    return;
                 }
-
+                
+                van_herk(src, dst, radius, 0, max_op(), get_row_kernels().max);
             }
             
             namespace {
@@ -144,26 +635,19 @@ namespace core {
             }
 
             void erode(const Channel8u &src, Channel8u &dst, int radius) {
-
+                
                 if (dst.getSize() != src.getSize()) {
                     dst = Channel8u(src.getWidth(), src.getHeight());
                 }
-
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&erode_area, std::ref(src), std::ref(dst), workingArea, radius));
-                    }
-                    
-                    for(auto &t : threads) { t.join(); }
-                    
-                } else {
-                    erode_area(src, dst, src.getBounds(), radius);
+                
+                if (radius < 0 || !is_packed(src) || !is_packed(dst)) {
+                    reference::erode(src, dst, radius);
+                    return;
                 }
+                
+                van_herk(src, dst, radius, 255, min_op(), get_row_kernels().min);
             }
-
+            
             void floodfill(const Channel8u &src, Channel8u &dst, ivec2 start, uint8_t targetValue, uint8_t newValue, bool copy) {
                 // https://en.wikipedia.org/wiki/Flood_fill
 
@@ -190,36 +674,69 @@ namespace core {
                     return srcData[py * rowBytes + px * increment];
                 };
 
-                if (get(start.x, start.y) != targetValue) {
+                //
+                //  Scanline fill: fill a whole span, then push one seed per run of fillable pixels in the rows above and
+                //  below it. Filled pixels are recognized by reading back dst when filling in place; otherwise we track them.
+                //
+                
+                if (targetValue == newValue) {
                     return;
                 }
-
-                std::queue<ivec2> Q;
-                Q.push(start);
-
-                while (!Q.empty()) {
-                    ivec2 coord = Q.front();
-                    Q.pop();
-
+                
+                const bool inPlace = srcData == dstData;
+                vector<bool> visited(inPlace ? 0 : src.getWidth() * src.getHeight());
+                
+                auto fillable = [&](int px, int py) -> bool {
+                    return get(px, py) == targetValue && (inPlace || !visited[py * src.getWidth() + px]);
+                };
+                
+                if (!fillable(start.x, start.y)) {
+                    return;
+                }
+                
+                vector<ivec2> seeds = { start };
+                while (!seeds.empty()) {
+                    const ivec2 coord = seeds.back();
+                    seeds.pop_back();
+                    
+                    const int32_t cy = coord.y;
+                    if (!fillable(coord.x, cy)) {
+                        continue;
+                    }
+                    
                     int32_t west = coord.x;
                     int32_t east = coord.x;
-                    int32_t cy = coord.y;
-
-                    while (west > 0 && get(west - 1, cy) == targetValue) {
+                    
+                    while (west > 0 && fillable(west - 1, cy)) {
                         west--;
                     }
-
-                    while (east < lastX && get(east + 1, cy) == targetValue) {
+                    
+                    while (east < lastX && fillable(east + 1, cy)) {
                         east++;
                     }
-
+                    
                     for (int32_t cx = west; cx <= east; cx++) {
                         set(cx, cy);
-                        if (cy > 0 && get(cx, cy - 1) == targetValue) {
-                            Q.push(ivec2(cx, cy - 1));
+                        if (!inPlace) {
+                            visited[cy * src.getWidth() + cx] = true;
+                        }
+                    }
+                    
+                    for (int32_t ny : { cy - 1, cy + 1 }) {
+                        if (ny < 0 || ny > lastY) {
+                            continue;
                         }
-                        if (cy < lastY && get(cx, cy + 1) == targetValue) {
-                            Q.push(ivec2(cx, cy + 1));
+                        
+                        bool inRun = false;
+                        for (int32_t cx = west; cx <= east; cx++) {
+                            if (fillable(cx, ny)) {
+                                if (!inRun) {
+                                    seeds.push_back(ivec2(cx, ny));
+                                    inRun = true;
+                                }
+                            } else {
+                                inRun = false;
+                            }
                         }
                     }
                 }
@@ -227,55 +744,270 @@ namespace core {
             
             namespace {
                 
-                void remap_area(const Channel8u &src, Channel8u &dst, Area area, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
-                    Channel8u::ConstIter srcIt = src.getIter(area);
-                    Channel8u::Iter dstIt = dst.getIter(area);
-                    
-                    while (srcIt.line() && dstIt.line()) {
-                        while (srcIt.pixel() && dstIt.pixel()) {
-                            dstIt.v() = (srcIt.v() == targetValue ? newTargetValue : defaultValue);
-                        }
+                /*
+                 Union-find over pixel indices: parents[i] is 1 + the index of pixel i's parent, or 0 for background. Unions
+                 always make the lower index the root, so a component's root is its first pixel in raster order.
+                 */
+                
+                inline uint32_t find_root(vector<uint32_t> &parents, uint32_t i) {
+                    while (parents[i] != i + 1) {
+                        // path halving
+                        parents[i] = parents[parents[i] - 1];
+                        i = parents[i] - 1;
                     }
+                    return i;
                 }
                 
-            }
-
-            void remap(const Channel8u &src, Channel8u &dst, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
-
-                if (dst.getSize() != src.getSize()) {
-                    dst = Channel8u(src.getWidth(), src.getHeight());
+                // find without compressing, for use while other threads read `parents
+                inline uint32_t find_root_const(const vector<uint32_t> &parents, uint32_t i) {
+                    while (parents[i] != i + 1) {
+                        i = parents[i] - 1;
+                    }
+                    return i;
                 }
                 
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&remap_area, std::ref(src), std::ref(dst), workingArea, targetValue, newTargetValue, defaultValue));
+                inline void unite(vector<uint32_t> &parents, uint32_t a, uint32_t b) {
+                    a = find_root(parents, a);
+                    b = find_root(parents, b);
+                    if (a < b) {
+                        parents[b] = a + 1;
+                    } else if (b < a) {
+                        parents[a] = b + 1;
                     }
-
-                    for(auto &t : threads) { t.join(); }
-
-                } else {
-                    remap_area(src, dst, src.getBounds(), targetValue, newTargetValue, defaultValue);
                 }
+                
             }
             
-            namespace {
+            component_labels label_components(const Channel8u &src, uint8_t minValue, uint8_t maxValue) {
+                const int width = src.getWidth(), height = src.getHeight();
+                component_labels result;
+                result.size = ivec2(width, height);
+                result.labels.assign(static_cast<size_t>(width) * height, 0);
+                if (width == 0 || height == 0) {
+                    return result;
+                }
                 
-                void blur_horizontal(const Channel8u &src, Channel8u &horizontalPass, Area area, const kernel &krnl) {
-                    Channel8u::ConstIter srcIt = src.getIter(area);
-                    Channel8u::Iter dstIt = horizontalPass.getIter(area);
-                    const kernel::const_iterator kend = krnl.end();
-
-                    while (srcIt.line() && dstIt.line()) {
-                        while (srcIt.pixel() && dstIt.pixel()) {
-                            
-                            double accum = 0;
-                            for (kernel::const_iterator k(krnl.begin()); k != kend; ++k) {
-                                accum += srcIt.vClamped(k->first, 0) * k->second;
-                            }
-                            
+                //
+                //  The image is split into one band of rows per thread. Each band is labeled independently with its own
+                //  unions, which only touch pixels in that band, then the bands are joined serially along their borders.
+                //
+                
+                ThreadPool &pool = ThreadPool::shared();
+                const int bandCount = static_cast<int>(min<size_t>(pool.getThreadCount(), height));
+                auto bandArea = [=](int band) {
+                    return Area(0, band * height / bandCount, width, (band + 1) * height / bandCount);
+                };
+                
+                vector<uint32_t> parents(result.labels.size(), 0);
+                auto index = [width](int x, int y) {
+                    return static_cast<uint32_t>(y * width + x);
+                };
+                
+                pool.parallelFor(bandCount, [&](size_t band) {
+                    const Area area = bandArea(static_cast<int>(band));
+                    for (int y = area.y1; y < area.y2; y++) {
+                        const uint8_t *row = src.getData(ivec2(0, y));
+                        const int32_t increment = src.getIncrement();
+                        for (int x = 0; x < width; x++) {
+                            const uint8_t v = row[x * increment];
+                            if (v < minValue || v > maxValue) {
+                                continue;
+                            }
+                            
+                            const uint32_t i = index(x, y);
+                            parents[i] = i + 1;
+                            if (x > 0 && parents[i - 1]) {
+                                unite(parents, i, i - 1);
+                            }
+                            if (y > area.y1 && parents[i - width]) {
+                                unite(parents, i, i - width);
+                            }
+                        }
+                    }
+                });
+                
+                for (int band = 1; band < bandCount; band++) {
+                    const int y = bandArea(band).y1;
+                    for (int x = 0; x < width; x++) {
+                        const uint32_t i = index(x, y);
+                        if (parents[i] && parents[i - width]) {
+                            unite(parents, i, i - width);
+                        }
+                    }
+                }
+                
+                //
+                //  Number the roots in raster order: count each band's roots, then assign labels from the prefix sums
+                //
+                
+                vector<uint32_t> bandFirstLabel(bandCount + 1, 1);
+                pool.parallelFor(bandCount, [&](size_t band) {
+                    const Area area = bandArea(static_cast<int>(band));
+                    uint32_t roots = 0;
+                    for (uint32_t i = index(0, area.y1), end = index(0, area.y2); i < end; i++) {
+                        roots += parents[i] == i + 1 ? 1 : 0;
+                    }
+                    bandFirstLabel[band + 1] = roots;
+                });
+                
+                for (int band = 0; band < bandCount; band++) {
+                    bandFirstLabel[band + 1] += bandFirstLabel[band];
+                }
+                
+                const size_t componentCount = bandFirstLabel[bandCount] - 1;
+                
+                pool.parallelFor(bandCount, [&](size_t band) {
+                    const Area area = bandArea(static_cast<int>(band));
+                    uint32_t label = bandFirstLabel[band];
+                    for (uint32_t i = index(0, area.y1), end = index(0, area.y2); i < end; i++) {
+                        if (parents[i] == i + 1) {
+                            result.labels[i] = label++;
+                        }
+                    }
+                });
+                
+                //
+                //  Label every pixel with its root's label and gather per-band stats for each run of same-labeled pixels,
+                //  keyed by label so a band only stores the components it touches. Positions are summed as integers,
+                //  so the merged stats don't depend on the band count.
+                //
+                
+                struct accumulator {
+                    uint64_t area, sumX, sumY;
+                    int x1, y1, x2, y2;
+                };
+                
+                const accumulator empty = { 0, 0, 0, width, height, 0, 0 };
+                vector<unordered_map<uint32_t, accumulator>> bandStats(bandCount);
+                pool.parallelFor(bandCount, [&](size_t band) {
+                    const Area area = bandArea(static_cast<int>(band));
+                    auto &stats = bandStats[band];
+                    for (int y = area.y1; y < area.y2; y++) {
+                        uint32_t *labels = &result.labels[index(0, y)];
+                        for (int x = 0; x < width; x++) {
+                            const uint32_t i = index(x, y);
+                            if (parents[i]) {
+                                // roots were labeled above; every other pixel takes its root's label
+                                const uint32_t root = find_root_const(parents, i);
+                                if (root != i) {
+                                    labels[x] = result.labels[root];
+                                }
+                            }
+                        }
+                        
+                        for (int x = 0; x < width;) {
+                            const uint32_t label = labels[x];
+                            const int runStart = x;
+                            while (x < width && labels[x] == label) {
+                                x++;
+                            }
+                            if (label == 0) {
+                                continue;
+                            }
+                            
+                            auto it = stats.find(label);
+                            if (it == stats.end()) {
+                                it = stats.emplace(label, empty).first;
+                            }
+                            
+                            // the run covers [runStart, x)
+                            const uint64_t runLength = x - runStart;
+                            accumulator &a = it->second;
+                            a.area += runLength;
+                            a.sumX += (runStart + x - 1) * runLength / 2;
+                            a.sumY += y * runLength;
+                            a.x1 = min(a.x1, runStart);
+                            a.y1 = min(a.y1, y);
+                            a.x2 = max(a.x2, x);
+                            a.y2 = max(a.y2, y + 1);
+                        }
+                    }
+                });
+                
+                vector<accumulator> totals(componentCount, empty);
+                for (const auto &stats : bandStats) {
+                    for (const auto &labelStats : stats) {
+                        const accumulator &a = labelStats.second;
+                        accumulator &total = totals[labelStats.first - 1];
+                        total.area += a.area;
+                        total.sumX += a.sumX;
+                        total.sumY += a.sumY;
+                        total.x1 = min(total.x1, a.x1);
+                        total.y1 = min(total.y1, a.y1);
+                        total.x2 = max(total.x2, a.x2);
+                        total.y2 = max(total.y2, a.y2);
+                    }
+                }
+                
+                result.components.resize(componentCount);
+                for (size_t c = 0; c < componentCount; c++) {
+                    const accumulator &total = totals[c];
+                    component_stats &component = result.components[c];
+                    component.area = total.area;
+                    component.bounds = Area(total.x1, total.y1, total.x2, total.y2);
+                    component.centroid = dvec2(static_cast<double>(total.sumX) / total.area, static_cast<double>(total.sumY) / total.area);
+                }
+                
+                return result;
+            }
+            
+            namespace {
+                
+                void remap_area(const Channel8u &src, Channel8u &dst, Area area, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                    Channel8u::ConstIter srcIt = src.getIter(area);
+                    Channel8u::Iter dstIt = dst.getIter(area);
+                    
+                    while (srcIt.line() && dstIt.line()) {
+                        while (srcIt.pixel() && dstIt.pixel()) {
+                            dstIt.v() = (srcIt.v() == targetValue ? newTargetValue : defaultValue);
+                        }
+                    }
+                }
+                
+            }
+
+            namespace {
+                
+                void remap_rows(const Channel8u &src, Channel8u &dst, Area area, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                    const auto kernel = get_row_kernels().remap;
+                    for (int y = area.y1; y < area.y2; y++) {
+                        kernel(src.getData(ivec2(area.x1, y)), dst.getData(ivec2(area.x1, y)), area.getWidth(), targetValue, newTargetValue, defaultValue);
+                    }
+                }
+                
+            }
+            
+            void remap(const Channel8u &src, Channel8u &dst, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+
+                if (dst.getSize() != src.getSize()) {
+                    dst = Channel8u(src.getWidth(), src.getHeight());
+                }
+                
+                if (!is_packed(src) || !is_packed(dst)) {
+                    reference::remap(src, dst, targetValue, newTargetValue, defaultValue);
+                    return;
+                }
+                
+                for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                    remap_rows(src, dst, area, targetValue, newTargetValue, defaultValue);
+                });
+            }
+            
+            namespace {
+                
+                void blur_horizontal(const Channel8u &src, Channel8u &horizontalPass, Area area, const kernel &krnl) {
+                    Channel8u::ConstIter srcIt = src.getIter(area);
+                    Channel8u::Iter dstIt = horizontalPass.getIter(area);
+                    const kernel::const_iterator kend = krnl.end();
+
+                    while (srcIt.line() && dstIt.line()) {
+                        while (srcIt.pixel() && dstIt.pixel()) {
+                            
+                            double accum = 0;
+                            for (kernel::const_iterator k(krnl.begin()); k != kend; ++k) {
+                                accum += srcIt.vClamped(k->first, 0) * k->second;
+                            }
+                            
                             uint8_t v = clamp<uint8_t>(static_cast<uint8_t>(lrint(accum)), 0, 255);
                             dstIt.v() = v;
                         }
@@ -308,41 +1040,224 @@ namespace core {
                 
             }
             
-            void blur(const Channel8u &src, Channel8u &dst, int radius) {
-                //
-                //    Create the kernel and the buffers
-                //
+            namespace {
                 
-                kernel krnl;
-                create_kernel(radius, krnl);
+                /*
+                 Box blur keeps a running sum over a window of 2r+1 pixels, clamping at the edges as the kernel blur does,
+                 so each pass costs the same regardless of radius. The average is rounded half up; (sum + r + 0.5) / w
+                 is never within float error of an integer for w < 4096, so truncating it is exact.
+                 */
                 
-                Channel8u horizontalPass(src.getWidth(), src.getHeight());
-                if (dst.getSize() != src.getSize()) {
-                    dst = Channel8u(src.getWidth(), src.getHeight());
+                const int MAX_BOX_RADIUS = 2047;
+                
+                void box_blur_horizontal(const Channel8u &src, Channel8u &dst, Area area, int radius, const vector<row_op> &ops) {
+                    const int width = src.getWidth(), last = width - 1;
+                    const float offset = radius + 0.5f, scale = 1.0f / (2 * radius + 1);
+                    vector<uint8_t> buffer(ops.empty() ? 0 : width);
+                    
+                    for (int y = area.y1; y < area.y2; y++) {
+                        const uint8_t *in = src.getData(ivec2(0, y));
+                        uint8_t *out = dst.getData(ivec2(0, y));
+                        
+                        if (!ops.empty()) {
+                            memcpy(buffer.data(), in, width);
+                            run_ops(ops, buffer.data(), y, width);
+                            in = buffer.data();
+                        }
+                        
+                        uint32_t sum = 0;
+                        for (int k = -radius; k <= radius; k++) {
+                            sum += in[clamp(k, 0, last)];
+                        }
+                        
+                        for (int x = 0; x < width; x++) {
+                            out[x] = static_cast<uint8_t>((static_cast<float>(sum) + offset) * scale);
+                            sum += in[min(x + radius + 1, last)] - in[max(x - radius, 0)];
+                        }
+                    }
                 }
                 
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&blur_horizontal, std::ref(src), std::ref(horizontalPass), workingArea, std::ref(krnl)));
+                void box_blur_vertical(const Channel8u &src, Channel8u &dst, Area area, int radius, const vector<row_op> &ops) {
+                    const row_kernels &kernels = get_row_kernels();
+                    const int width = src.getWidth(), last = src.getHeight() - 1;
+                    const float offset = radius + 0.5f, scale = 1.0f / (2 * radius + 1);
+                    
+                    auto row = [&](int y) {
+                        return src.getData(ivec2(0, clamp(y, 0, last)));
+                    };
+                    
+                    // column sums for the window around the first row, then slide the window down
+                    vector<uint32_t> sums(width, 0);
+                    const vector<uint8_t> zeros(width, 0);
+                    for (int k = -radius; k <= radius; k++) {
+                        kernels.accumulate(sums.data(), row(area.y1 + k), zeros.data(), width);
                     }
                     
-                    for(auto &t : threads) { t.join(); }
-                    threads.clear();
-
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&blur_vertical, std::ref(horizontalPass), std::ref(dst), workingArea, std::ref(krnl)));
+                    for (int y = area.y1; y < area.y2; y++) {
+                        uint8_t *out = dst.getData(ivec2(0, y));
+                        kernels.divide(sums.data(), offset, scale, out, width);
+                        kernels.accumulate(sums.data(), row(y + radius + 1), row(y - radius), width);
+                        run_ops(ops, out, y, width);
+                    }
+                }
+                
+                void box_blur(const Channel8u &src, Channel8u &dst, int radius, Channel8u &horizontalPass,
+                              const vector<row_op> &srcOps, const vector<row_op> &dstOps) {
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                        box_blur_horizontal(src, horizontalPass, area, radius, srcOps);
+                    });
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 4 * (2 * radius + 1), [&](Area area) {
+                        box_blur_vertical(horizontalPass, dst, area, radius, dstOps);
+                    });
+                }
+                
+                /*
+                 Radii of `n stacked box blurs approximating a gaussian of `sigma
+                 http://blog.ivank.net/fastest-gaussian-blur.html
+                 */
+                vector<int> gaussian_box_radii(double sigma, int n) {
+                    const double idealWidth = sqrt((12 * sigma * sigma / n) + 1);
+                    int lower = static_cast<int>(floor(idealWidth));
+                    if (lower % 2 == 0) {
+                        lower--;
+                    }
+                    const int upper = lower + 2;
+                    
+                    const double idealCount = (12 * sigma * sigma - n * lower * lower - 4 * n * lower - 3 * n) / (-4 * lower - 4);
+                    const int count = static_cast<int>(lrint(idealCount));
+                    
+                    vector<int> radii;
+                    for (int i = 0; i < n; i++) {
+                        radii.push_back(((i < count ? lower : upper) - 1) / 2);
+                    }
+                    
+                    return radii;
+                }
+                
+                /*
+                 Row-at-a-time versions of blur_horizontal and blur_vertical. Each pixel still accumulates its taps in kernel
+                 order in double precision, so the result is bit-identical, but the loops over a row vectorize and edge
+                 clamping is done once per row by padding rather than once per tap.
+                 */
+                
+                void kernel_blur_horizontal(const Channel8u &src, Channel8u &dst, Area area, const kernel &krnl, const vector<row_op> &ops) {
+                    const int width = src.getWidth(), radius = static_cast<int>(krnl.size() / 2);
+                    if (width == 0) {
+                        return;
+                    }
+                    
+                    vector<uint8_t> padded(width + 2 * radius);
+                    vector<double> accum(width);
+                    uint8_t *row = padded.data() + radius;
+                    
+                    for (int y = area.y1; y < area.y2; y++) {
+                        read_row(src, y, row);
+                        run_ops(ops, row, y, width);
+                        std::fill(padded.begin(), padded.begin() + radius, row[0]);
+                        std::fill(padded.begin() + radius + width, padded.end(), row[width - 1]);
+                        
+                        std::fill(accum.begin(), accum.end(), 0.0);
+                        for (const auto &k : krnl) {
+                            const uint8_t *in = row + k.first;
+                            const double weight = k.second;
+                            for (int x = 0; x < width; x++) {
+                                accum[x] += in[x] * weight;
+                            }
+                        }
+                        
+                        uint8_t *out = dst.getData(ivec2(0, y));
+                        for (int x = 0; x < width; x++) {
+                            out[x] = static_cast<uint8_t>(lrint(accum[x]));
+                        }
                     }
+                }
+                
+                void kernel_blur_vertical(const Channel8u &src, Channel8u &dst, Area area, const kernel &krnl, const vector<row_op> &ops) {
+                    const int width = src.getWidth(), last = src.getHeight() - 1;
+                    vector<double> accum(width);
                     
-                    for(auto &t : threads) { t.join(); }
+                    for (int y = area.y1; y < area.y2; y++) {
+                        std::fill(accum.begin(), accum.end(), 0.0);
+                        for (const auto &k : krnl) {
+                            const uint8_t *in = src.getData(ivec2(0, clamp(y + k.first, 0, last)));
+                            const double weight = k.second;
+                            for (int x = 0; x < width; x++) {
+                                accum[x] += in[x] * weight;
+                            }
+                        }
+                        
+                        uint8_t *out = dst.getData(ivec2(0, y));
+                        for (int x = 0; x < width; x++) {
+                            out[x] = static_cast<uint8_t>(lrint(accum[x]));
+                        }
+                        run_ops(ops, out, y, width);
+                    }
+                }
+                
+                void kernel_blur(const Channel8u &src, Channel8u &dst, int radius, Channel8u &horizontalPass,
+                                 const vector<row_op> &srcOps, const vector<row_op> &dstOps) {
+                    kernel krnl;
+                    create_kernel(radius, krnl);
                     
-                } else {
-                    const auto bounds(src.getBounds());
-                    blur_horizontal(src, horizontalPass, bounds, krnl);
-                    blur_vertical(horizontalPass, dst, bounds, krnl);
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                        kernel_blur_horizontal(src, horizontalPass, area, krnl, srcOps);
+                    });
+                    for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                        kernel_blur_vertical(horizontalPass, dst, area, krnl, dstOps);
+                    });
+                }
+                
+            }
+            
+            void blur(const Channel8u &src, Channel8u &dst, int radius) {
+                blur(src, dst, radius, KERNEL_BLUR, thread_scratch(src));
+            }
+            
+            void blur(const Channel8u &src, Channel8u &dst, int radius, BlurMode mode, Channel8u &scratch) {
+                blur(src, dst, radius, mode, scratch, {}, {});
+            }
+            
+            void blur(const Channel8u &src, Channel8u &dst, int radius, BlurMode mode, Channel8u &scratch,
+                      const vector<row_op> &srcOps, const vector<row_op> &dstOps) {
+                if (dst.getSize() != src.getSize()) {
+                    dst = Channel8u(src.getWidth(), src.getHeight());
+                }
+                
+                if (scratch.getSize() != src.getSize()) {
+                    scratch = Channel8u(src.getWidth(), src.getHeight());
+                }
+                
+                switch (mode) {
+                    case KERNEL_BLUR:
+                        if (is_packed(dst) && is_packed(scratch)) {
+                            kernel_blur(src, dst, radius, scratch, srcOps, dstOps);
+                        } else {
+                            CI_ASSERT_MSG(srcOps.empty() && dstOps.empty(), "Blur with row_ops requires packed channels");
+                            reference::blur(src, dst, radius);
+                        }
+                        break;
+                        
+                    case BOX_BLUR:
+                        CI_ASSERT_MSG(is_packed(src) && is_packed(dst) && is_packed(scratch), "Box blur requires packed channels");
+                        box_blur(src, dst, clamp(radius, 0, MAX_BOX_RADIUS), scratch, srcOps, dstOps);
+                        break;
+                        
+                    case GAUSSIAN_BLUR: {
+                        CI_ASSERT_MSG(is_packed(src) && is_packed(dst) && is_packed(scratch), "Gaussian blur requires packed channels");
+                        
+                        // gaussian_box_radii rounds a zero sigma up to a box of radius 1, which would still blur
+                        if (radius <= 0) {
+                            box_blur(src, dst, 0, scratch, srcOps, dstOps);
+                            break;
+                        }
+                        
+                        const vector<int> radii = gaussian_box_radii(radius / 2.0, 3);
+                        const vector<row_op> none;
+                        for (size_t i = 0, N = radii.size(); i < N; i++) {
+                            box_blur(i == 0 ? src : dst, dst, min(radii[i], MAX_BOX_RADIUS), scratch, i == 0 ? srcOps : none, i == N - 1 ? dstOps : none);
+                        }
+                        break;
+                    }
                 }
             }
             
@@ -362,84 +1277,243 @@ namespace core {
 
             }
 
+            namespace {
+                
+                void threshold_rows(const Channel8u &src, Channel8u &dst, Area area, uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                    const auto kernel = get_row_kernels().threshold;
+                    for (int y = area.y1; y < area.y2; y++) {
+                        kernel(src.getData(ivec2(area.x1, y)), dst.getData(ivec2(area.x1, y)), area.getWidth(), threshV, maxV, minV);
+                    }
+                }
+                
+            }
+
             void threshold(const Channel8u &src, Channel8u &dst, uint8_t threshV, uint8_t maxV, uint8_t minV) {
 
                 if (dst.getSize() != src.getSize()) {
                     dst = Channel8u(src.getWidth(), src.getHeight());
                 }
                 
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&threshold_area, std::ref(src), std::ref(dst), workingArea, threshV, maxV, minV));
-                    }
-                    
-                    for(auto &t : threads) { t.join(); }
-                    
-                } else {
-                    threshold_area(src, dst, src.getBounds(), threshV, maxV, minV);
+                if (!is_packed(src) || !is_packed(dst)) {
+                    reference::threshold(src, dst, threshV, maxV, minV);
+                    return;
                 }
+                
+                for_each_row_chunk(src.getWidth(), src.getHeight(), 1, [&](Area area) {
+                    threshold_rows(src, dst, area, threshV, maxV, minV);
+                });
 
             }
             
-            namespace {
-                void vignette_area(const Channel8u &src, Channel8u &dst, Area area, double innerRadius, double outerRadius, uint8_t vignetteColor) {
-                    const int size = min(src.getWidth(), src.getHeight());
+            void vignette(const Channel8u &src, Channel8u &dst, double innerRadius, double outerRadius, uint8_t vignetteColor) {
+                apply(src, dst, { row_ops::vignette(src.getSize(), innerRadius, outerRadius, vignetteColor) });
+            }
+            
+            namespace row_ops {
+                
+                row_op remap(uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                    return [=](uint8_t *row, int y, int width) {
+                        get_row_kernels().remap(row, row, width, targetValue, newTargetValue, defaultValue);
+                    };
+                }
+                
+                row_op threshold(uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                    return [=](uint8_t *row, int y, int width) {
+                        get_row_kernels().threshold(row, row, width, threshV, maxV, minV);
+                    };
+                }
+                
+                row_op vignette(ivec2 channelSize, double innerRadius, double outerRadius, uint8_t vignetteColor) {
+                    const int size = min(channelSize.x, channelSize.y);
                     const vec2 center(size/2, size/2);
                     const float outerVignetteRadius = size * 0.5f * outerRadius;
                     const float innerVignetteRadius = size * 0.5f * innerRadius;
                     const float innerVignetteRadius2 = innerVignetteRadius * innerVignetteRadius;
                     const float vignetteThickness = outerVignetteRadius - innerVignetteRadius;
                     
-                    Channel8u::ConstIter srcIt = src.getIter(area);
-                    Channel8u::Iter dstIt = dst.getIter(area);
-                    while (srcIt.line() && dstIt.line()) {
-                        while (srcIt.pixel() && dstIt.pixel()) {
-                            float radius2 = lengthSquared(vec2(srcIt.getPos()) - center);
+                    return [=](uint8_t *row, int y, int width) {
+                        for (int x = 0; x < width; x++) {
+                            float radius2 = lengthSquared(vec2(ivec2(x, y)) - center);
                             if (radius2 > innerVignetteRadius2) {
                                 float radius = sqrt(radius2);
                                 float vignette = 1 - min<float>(((radius - innerVignetteRadius) / vignetteThickness), 1);
-                                float val = static_cast<float>(srcIt.v()) / 255.f;
-                                dstIt.v() = static_cast<uint8_t>(vignette * val * 255);
+                                float val = static_cast<float>(row[x]) / 255.f;
+                                row[x] = static_cast<uint8_t>(vignette * val * 255);
                             }
                         }
-                    }
+                    };
+                }
+                
+                row_op perlin(Perlin &noise, double frequency) {
+                    return [&noise, frequency](uint8_t *row, int y, int width) {
+                        for (int x = 0; x < width; x++) {
+                            const float v = noise.fBm(frequency * x, frequency * y);
+                            row[x] = static_cast<uint8_t>(255.f * (v * 0.5f + 0.5f));
+                        }
+                    };
                 }
+                
+                row_op perlin_add(Perlin &noise, double frequency, double scale) {
+                    return [&noise, frequency, scale](uint8_t *row, int y, int width) {
+                        const float r255 = 1.0f / 255.0f;
+                        for (int x = 0; x < width; x++) {
+                            const float pn = scale * noise.fBm(frequency * x, frequency * y);
+                            const float dest = row[x] * r255; // renormalize contents to [0,1]
+                            const float result = saturate<float>(dest + pn);
+                            row[x] = static_cast<uint8_t>(255.f * result);
+                        }
+                    };
+                }
+                
+                row_op perlin_abs_thresh(Perlin &noise, double frequency, uint8_t threshold) {
+                    return [&noise, frequency, threshold](uint8_t *row, int y, int width) {
+                        for (int x = 0; x < width; x++) {
+                            float v = noise.fBm(frequency * x, frequency * y);
+                            v = abs(v);
+                            uint8_t pv = static_cast<uint8_t>(255.f * abs(v));
+                            row[x] = pv >= threshold ? 255 : 0;
+                        }
+                    };
+                }
+                
+                row_op perlin(const GradientNoise &noise, double frequency) {
+                    return [&noise, frequency](uint8_t *row, int y, int width) {
+                        for_each_noise_batch(noise, frequency, row, y, width, [](uint8_t *pixels, const float *values, int count) {
+                            for (int i = 0; i < count; i++) {
+                                pixels[i] = static_cast<uint8_t>(255.f * (values[i] * 0.5f + 0.5f));
+                            }
+                        });
+                    };
+                }
+                
+                row_op perlin_add(const GradientNoise &noise, double frequency, double scale) {
+                    return [&noise, frequency, scale](uint8_t *row, int y, int width) {
+                        const float r255 = 1.0f / 255.0f;
+                        for_each_noise_batch(noise, frequency, row, y, width, [=](uint8_t *pixels, const float *values, int count) {
+                            for (int i = 0; i < count; i++) {
+                                const float pn = scale * values[i];
+                                const float dest = pixels[i] * r255; // renormalize contents to [0,1]
+                                const float result = saturate<float>(dest + pn);
+                                pixels[i] = static_cast<uint8_t>(255.f * result);
+                            }
+                        });
+                    };
+                }
+                
+                row_op perlin_abs_thresh(const GradientNoise &noise, double frequency, uint8_t threshold) {
+                    return [&noise, frequency, threshold](uint8_t *row, int y, int width) {
+                        for_each_noise_batch(noise, frequency, row, y, width, [=](uint8_t *pixels, const float *values, int count) {
+                            for (int i = 0; i < count; i++) {
+                                uint8_t pv = static_cast<uint8_t>(255.f * abs(values[i]));
+                                pixels[i] = pv >= threshold ? 255 : 0;
+                            }
+                        });
+                    };
+                }
+                
             }
             
-            void vignette(const Channel8u &src, Channel8u &dst, double innerRadius, double outerRadius, uint8_t vignetteColor) {
+            void apply(const Channel8u &src, Channel8u &dst, const vector<row_op> &ops) {
                 if (dst.getSize() != src.getSize()) {
                     dst = Channel8u(src.getWidth(), src.getHeight());
                 }
                 
-                const size_t threadCount = get_num_threads();
-                if (threadCount > 1) {
-                    vector<std::thread> threads;
-                    for (size_t idx = 0; idx < threadCount; idx++) {
-                        Area workingArea = get_thread_working_area(src.getWidth(), src.getHeight(), idx);
-                        threads.emplace_back(std::thread(&vignette_area, std::ref(src), std::ref(dst), workingArea, innerRadius, outerRadius, vignetteColor));
+                // rows are transformed in place in dst when it's packed, otherwise in a buffer which is then written back
+                const int width = src.getWidth();
+                for_each_row_chunk(width, src.getHeight(), 1, [&](Area area) {
+                    vector<uint8_t> buffer(is_packed(dst) ? 0 : width);
+                    for (int y = area.y1; y < area.y2; y++) {
+                        uint8_t *row = is_packed(dst) ? dst.getData(ivec2(0, y)) : buffer.data();
+                        read_row(src, y, row);
+                        run_ops(ops, row, y, width);
+                        if (!is_packed(dst)) {
+                            write_row(dst, y, row);
+                        }
+                    }
+                });
+            }
+            
+            namespace in_place {
+                
+                void fill(Channel8u &channel, uint8_t value) {
+                    fill(channel, channel.getBounds(), value);
+                }
+                
+                void fill(Channel8u &channel, Area rect, uint8_t value) {
+                    if (!is_packed(channel)) {
+                        reference::fill(channel, rect, value);
+                        return;
                     }
                     
-                    for(auto &t : threads) { t.join(); }
+                    rect.clipBy(channel.getBounds());
+                    if (rect.getWidth() <= 0) {
+                        return;
+                    }
                     
-                } else {
-                    vignette_area(src, dst, src.getBounds(), innerRadius, outerRadius, vignetteColor);
+                    const auto kernel = get_row_kernels().fill;
+                    for (int y = rect.y1; y < rect.y2; y++) {
+                        kernel(channel.getData(ivec2(rect.x1, y)), rect.getWidth(), value);
+                    }
+                }
+                
+                void perlin(Channel8u &channel, Perlin &noise, double frequency) {
+                    apply(channel, { row_ops::perlin(noise, frequency) });
                 }
+                
+                void perlin_add(Channel8u &channel, Perlin &noise, double frequency, double scale) {
+                    apply(channel, { row_ops::perlin_add(noise, frequency, scale) });
+                }
+                
+                void perlin_abs_thresh(Channel8u &channel, Perlin &noise, double frequency, uint8_t threshold) {
+                    apply(channel, { row_ops::perlin_abs_thresh(noise, frequency, threshold) });
+                }
+                
+                void perlin(Channel8u &channel, const GradientNoise &noise, double frequency) {
+                    apply(channel, { row_ops::perlin(noise, frequency) });
+                }
+                
+                void perlin_add(Channel8u &channel, const GradientNoise &noise, double frequency, double scale) {
+                    apply(channel, { row_ops::perlin_add(noise, frequency, scale) });
+                }
+                
+                void perlin_abs_thresh(Channel8u &channel, const GradientNoise &noise, double frequency, uint8_t threshold) {
+                    apply(channel, { row_ops::perlin_abs_thresh(noise, frequency, threshold) });
+                }
+                
             }
-
             
-            namespace in_place {
+            namespace reference {
                 
-                void fill(Channel8u &channel, uint8_t value) {
-                    Channel8u::Iter it = channel.getIter();
+                void dilate(const Channel8u &src, Channel8u &dst, int radius) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
+                    }
                     
-                    while(it.line()) {
-                        while (it.pixel()) {
-                            it.v() = value;
-                        }
+                    dilate_area(src, dst, src.getBounds(), radius);
+                }
+                
+                void erode(const Channel8u &src, Channel8u &dst, int radius) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
+                    }
+                    
+                    erode_area(src, dst, src.getBounds(), radius);
+                }
+                
+                void remap(const Channel8u &src, Channel8u &dst, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
+                    }
+                    
+                    remap_area(src, dst, src.getBounds(), targetValue, newTargetValue, defaultValue);
+                }
+                
+                void threshold(const Channel8u &src, Channel8u &dst, uint8_t threshV, uint8_t maxV, uint8_t minV) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
                     }
+                    
+                    threshold_area(src, dst, src.getBounds(), threshV, maxV, minV);
                 }
                 
                 void fill(Channel8u &channel, Area rect, uint8_t value) {
@@ -452,102 +1526,78 @@ namespace core {
                     }
                 }
                 
-                namespace {
-                    void perlin_area(Channel8u &channel, Area area, Perlin &noise, double frequency) {
-                        Channel8u::Iter iter = channel.getIter(area);
-                        
-                        while (iter.line()) {
-                            while (iter.pixel()) {
-                                const float v = noise.fBm(frequency * iter.x(), frequency * iter.y());
-                                iter.v() = static_cast<uint8_t>(255.f * (v * 0.5f + 0.5f));
-                            }
-                        }
+                void floodfill(const Channel8u &src, Channel8u &dst, ivec2 start, uint8_t targetValue, uint8_t newValue, bool copy) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
                     }
-                }
-                
-                void perlin(Channel8u &channel, Perlin &noise, double frequency) {
-                    const size_t threadCount = get_num_threads();
-                    if (threadCount > 1) {
-                        vector<std::thread> threads;
-                        for (size_t idx = 0; idx < threadCount; idx++) {
-                            Area workingArea = get_thread_working_area(channel.getWidth(), channel.getHeight(), idx);
-                            threads.emplace_back(std::thread(&perlin_area, std::ref(channel), workingArea, std::ref(noise), frequency));
-                        }
-                        
-                        for(auto &t : threads) { t.join(); }
-                        
-                    } else {
-                        perlin_area(channel, channel.getBounds(), noise, frequency);
+
+                    if (copy) {
+                        dst.copyFrom(src, Area(0, 0, src.getWidth(), src.getHeight()));
                     }
-                }
-                
-                namespace {
-                    void perlin_add_area(Channel8u &channel, Area area, Perlin &noise, double frequency, double scale) {
-                        Channel8u::Iter iter = channel.getIter(area);
-                        
-                        const float r255 = 1.0f / 255.0f;
-                        while (iter.line()) {
-                            while (iter.pixel()) {
-                                const float pn = scale * noise.fBm(frequency * iter.x(), frequency * iter.y());
-                                const float dest = iter.v() * r255; // renormalize contents to [0,1]
-                                const float result = saturate<float>(dest + pn);
-                                iter.v() = static_cast<uint8_t>(255.f * result);
-                            }
-                        }
 
+                    const uint8_t *srcData = src.getData();
+                    uint8_t *dstData = dst.getData();
+                    int32_t rowBytes = src.getRowBytes();
+                    int32_t increment = src.getIncrement();
+                    int32_t lastX = src.getWidth() - 1;
+                    int32_t lastY = src.getHeight() - 1;
+
+                    auto set = [&](int px, int py) {
+                        dstData[py * rowBytes + px * increment] = newValue;
+                    };
+
+                    auto get = [&](int px, int py) -> uint8_t {
+                        return srcData[py * rowBytes + px * increment];
+                    };
+
+                    if (get(start.x, start.y) != targetValue) {
+                        return;
                     }
-                }
-                
-                void perlin_add(Channel8u &channel, Perlin &noise, double frequency, double scale) {
-                    const size_t threadCount = get_num_threads();
-                    if (threadCount > 1) {
-                        vector<std::thread> threads;
-                        for (size_t idx = 0; idx < threadCount; idx++) {
-                            Area workingArea = get_thread_working_area(channel.getWidth(), channel.getHeight(), idx);
-                            threads.emplace_back(std::thread(&perlin_add_area, std::ref(channel), workingArea, std::ref(noise), frequency, scale));
+
+                    std::queue<ivec2> Q;
+                    Q.push(start);
+
+                    while (!Q.empty()) {
+                        ivec2 coord = Q.front();
+                        Q.pop();
+
+                        int32_t west = coord.x;
+                        int32_t east = coord.x;
+                        int32_t cy = coord.y;
+
+                        while (west > 0 && get(west - 1, cy) == targetValue) {
+                            west--;
                         }
-                        
-                        for(auto &t : threads) { t.join(); }
-                        
-                    } else {
-                        perlin_add_area(channel, channel.getBounds(), noise, frequency, scale);
-                    }
-                }
 
-                
-                namespace {
-                    void perlin_abs_thresh_area(Channel8u &channel, Area area, Perlin &noise, double frequency, uint8_t threshold) {
-                        Channel8u::Iter iter = channel.getIter(area);
-                        
-                        while (iter.line()) {
-                            while (iter.pixel()) {
-                                float v = noise.fBm(frequency * iter.x(), frequency * iter.y());
-                                v = abs(v);
-                                uint8_t pv = static_cast<uint8_t>(255.f * abs(v));
-                                iter.v() = pv >= threshold ? 255 : 0;
+                        while (east < lastX && get(east + 1, cy) == targetValue) {
+                            east++;
+                        }
+
+                        for (int32_t cx = west; cx <= east; cx++) {
+                            set(cx, cy);
+                            if (cy > 0 && get(cx, cy - 1) == targetValue) {
+                                Q.push(ivec2(cx, cy - 1));
+                            }
+                            if (cy < lastY && get(cx, cy + 1) == targetValue) {
+                                Q.push(ivec2(cx, cy + 1));
                             }
                         }
                     }
                 }
                 
-                void perlin_abs_thresh(Channel8u &channel, Perlin &noise, double frequency, uint8_t threshold) {
-                    const size_t threadCount = get_num_threads();
-                    if (threadCount > 1) {
-                        vector<std::thread> threads;
-                        for (size_t idx = 0; idx < threadCount; idx++) {
-                            Area workingArea = get_thread_working_area(channel.getWidth(), channel.getHeight(), idx);
-                            threads.emplace_back(std::thread(&perlin_abs_thresh_area, std::ref(channel), workingArea, std::ref(noise), frequency, threshold));
-                        }
-                        
-                        for(auto &t : threads) { t.join(); }
-                        
-                    } else {
-                        perlin_abs_thresh_area(channel, channel.getBounds(), noise, frequency, threshold);
+                void blur(const Channel8u &src, Channel8u &dst, int radius) {
+                    if (dst.getSize() != src.getSize()) {
+                        dst = Channel8u(src.getWidth(), src.getHeight());
                     }
+                    
+                    kernel krnl;
+                    create_kernel(radius, krnl);
+                    
+                    Channel8u &horizontalPass = thread_scratch(src);
+                    blur_horizontal(src, horizontalPass, src.getBounds(), krnl);
+                    blur_vertical(horizontalPass, dst, src.getBounds(), krnl);
                 }
-
-
-
+                
             }
 
         }
@@ -8,11 +8,15 @@
 #ifndef ImageProcessing_hpp
 #define ImageProcessing_hpp
 
+#include <functional>
+#include <vector>
+
 #include <cinder/Channel.h>
 #include <cinder/Perlin.h>
 
 #include "core/Common.hpp"
 #include "core/MathHelpers.hpp"
+#include "core/util/GradientNoise.hpp"
 
 namespace core {
     namespace util {
@@ -27,11 +31,52 @@ namespace core {
             // acting on copy of `src, floodfill into `dst
             void floodfill(const Channel8u &src, Channel8u &dst, ivec2 start, uint8_t targetValue, uint8_t newValue, bool copy);
 
+            // statistics of one connected component found by label_components
+            struct component_stats {
+                // number of pixels in the component
+                size_t area;
+                // bounds of the component's pixels, where x2 and y2 are exclusive
+                Area bounds;
+                // mean position of the component's pixels
+                dvec2 centroid;
+            };
+            
+            struct component_labels {
+                ivec2 size;
+                // a label per pixel in row-major order; 0 for background, otherwise 1 + the index of the pixel's component in `components
+                std::vector<uint32_t> labels;
+                // the components, ordered by their first pixel in raster order
+                std::vector<component_stats> components;
+                
+                uint32_t getLabel(int x, int y) const {
+                    return labels[y * size.x + x];
+                }
+            };
+            
+            /**
+             Label the 4-connected components (the same connectivity floodfill uses) of pixels in `src whose values are in
+             [minValue, maxValue], gathering the area, bounds and centroid of each. This is a two-pass union-find labeling which
+             runs over bands of rows in parallel; the result is identical for any thread count.
+             */
+            component_labels label_components(const Channel8u &src, uint8_t minValue, uint8_t maxValue = 255);
+
             // remap values in `src which are of value `targetValue to `newTargetValue; all other values are converted to `defaultValue
             void remap(const Channel8u &src, Channel8u &dst, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue);
 
+            enum BlurMode {
+                // the original weighted kernel; cost grows with radius
+                KERNEL_BLUR,
+                // running-sum box filter; cost is independent of radius
+                BOX_BLUR,
+                // three stacked box filters approximating a gaussian with sigma = radius / 2; cost is independent of radius
+                GAUSSIAN_BLUR
+            };
+            
             // perform blur of size `radius of `src into `dst
             void blur(const Channel8u &src, Channel8u &dst, int radius);
+            
+            // perform blur of size `radius of `src into `dst using `mode; `scratch holds the intermediate pass and is only reallocated if its size differs from `src
+            void blur(const Channel8u &src, Channel8u &dst, int radius, BlurMode mode, Channel8u &scratch);
 
             // for every value in src, maxV if pixelV >= threshV else minV
             void threshold(const Channel8u &src, Channel8u &dst, uint8_t threshV = 128, uint8_t maxV = 255, uint8_t minV = 0);
@@ -39,6 +84,85 @@ namespace core {
             // apply vignette effect to src, into dst, where pixels have vignetteColor applied as pixel radius from center approaches outerRadius
             void vignette(const Channel8u &src, Channel8u &dst, double innerRadius, double outerRadius, uint8_t vignetteColor = 0);
             
+            /**
+             A point-wise stage which transforms the `width pixels of row `y in place. Stages are run with apply(), or fused into
+             a blur's passes, so that a chain of them touches each row once while it's in cache rather than once per stage.
+             */
+            typedef std::function<void(uint8_t *row, int y, int width)> row_op;
+            
+            namespace row_ops {
+                
+                // the per-row stages behind the functions of the same name; each produces output identical to them
+                
+                row_op remap(uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue);
+                
+                row_op threshold(uint8_t threshV = 128, uint8_t maxV = 255, uint8_t minV = 0);
+                
+                // vignette for a channel of `size
+                row_op vignette(ivec2 size, double innerRadius, double outerRadius, uint8_t vignetteColor = 0);
+                
+                // `noise is captured by reference, and must outlive the row_op
+                row_op perlin(Perlin &noise, double frequency);
+                
+                row_op perlin_add(Perlin &noise, double frequency, double scale);
+                
+                row_op perlin_abs_thresh(Perlin &noise, double frequency, uint8_t threshold);
+                
+                // as above, but evaluating the noise a batch of pixels at a time; output is identical to ci::Perlin with the same octaves and seed
+                
+                row_op perlin(const GradientNoise &noise, double frequency);
+                
+                row_op perlin_add(const GradientNoise &noise, double frequency, double scale);
+                
+                row_op perlin_abs_thresh(const GradientNoise &noise, double frequency, uint8_t threshold);
+                
+            }
+            
+            // run `ops in order on each row of `src, writing the result to `dst (which may be `src)
+            void apply(const Channel8u &src, Channel8u &dst, const std::vector<row_op> &ops);
+            
+            /**
+             Perform blur of size `radius of `src into `dst using `mode, applying `srcOps to each row of `src as the blur reads it
+             and `dstOps to each row of `dst once it has been blurred. Since the horizontal pass lands in `scratch, `dst may be `src.
+             */
+            void blur(const Channel8u &src, Channel8u &dst, int radius, BlurMode mode, Channel8u &scratch,
+                      const std::vector<row_op> &srcOps, const std::vector<row_op> &dstOps);
+            
+            // instruction sets which the row kernels behind dilate, erode, remap, threshold and fill, and GradientNoise, can dispatch to
+            enum SimdLevel {
+                SIMD_NONE,
+                SIMD_SSE2,
+                SIMD_AVX2
+            };
+            
+            // the best instruction set this cpu supports, detected on first use
+            SimdLevel get_supported_simd_level();
+            
+            // restrict the instruction set used, e.g. to verify each path against the others; clamped to the supported level
+            void set_simd_level(SimdLevel level);
+            
+            SimdLevel get_simd_level();
+            
+            namespace reference {
+                
+                // the original per-pixel implementations, kept to verify the optimized versions against bit-for-bit
+                
+                void dilate(const Channel8u &src, Channel8u &dst, int radius);
+                
+                void erode(const Channel8u &src, Channel8u &dst, int radius);
+                
+                void remap(const Channel8u &src, Channel8u &dst, uint8_t targetValue, uint8_t newTargetValue, uint8_t defaultValue);
+                
+                void threshold(const Channel8u &src, Channel8u &dst, uint8_t threshV = 128, uint8_t maxV = 255, uint8_t minV = 0);
+                
+                void fill(Channel8u &channel, Area rect, uint8_t value);
+                
+                void floodfill(const Channel8u &src, Channel8u &dst, ivec2 start, uint8_t targetValue, uint8_t newValue, bool copy);
+                
+                void blur(const Channel8u &src, Channel8u &dst, int radius);
+                
+            }
+            
             
             // perform a dilation pass such that each pixel in result image is the max of the pixels in the kernel
             inline Channel8u dilate(const Channel8u &src, int size) {
@@ -68,6 +192,13 @@ namespace core {
                 return dst;
             }
 
+            // perform blur of size `radius using `mode
+            inline Channel8u blur(const Channel8u &src, int radius, BlurMode mode) {
+                Channel8u dst, scratch;
+                ::core::util::ip::blur(src, dst, radius, mode, scratch);
+                return dst;
+            }
+
             // for every value in src, maxV if pixelV >= threshV else minV
             inline Channel8u threshold(const Channel8u &src, uint8_t threshV = 128, uint8_t maxV = 255, uint8_t minV = 0) {
                 Channel8u dst;
@@ -102,6 +233,19 @@ namespace core {
                 // fill all pixels of channel with noise at a given frequency, where the noise is absoluted and thresholded
                 void perlin_abs_thresh(Channel8u &channel, Perlin &noise, double frequency, uint8_t threshold);
                 
+                // GradientNoise versions of the above, which evaluate a batch of pixels per call
+                
+                void perlin(Channel8u &channel, const GradientNoise &noise, double frequency);
+                
+                void perlin_add(Channel8u &channel, const GradientNoise &noise, double frequency, double scale);
+                
+                void perlin_abs_thresh(Channel8u &channel, const GradientNoise &noise, double frequency, uint8_t threshold);
+                
+                // run `ops in order on each row of `channel
+                inline void apply(Channel8u &channel, const std::vector<row_op> &ops) {
+                    ::core::util::ip::apply(channel, channel, ops);
+                }
+                
                 // flood fill into channel starting at `start, where pixels of `targetValue are changed to `newValue - modifies `channel
                 inline void floodfill(Channel8u &channel, ivec2 start, uint8_t targetValue, uint8_t newValue) {
                     ::core::util::ip::floodfill(channel, channel, start, targetValue, newValue, false);
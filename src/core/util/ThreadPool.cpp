@@ -0,0 +1,216 @@
+//
+//  ThreadPool.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/18/18.
+//
+
+#include "core/util/ThreadPool.hpp"
+
+#include <cinder/Log.h>
+
+namespace core {
+    namespace util {
+        
+        namespace {
+            
+            size_t _sharedThreadCount = 0;
+            std::atomic<bool> _sharedCreated(false);
+            std::atomic<ThreadPool*> _sharedOverride(nullptr);
+            
+            // the pool and queue index of the current thread, if it's a pool worker
+            thread_local ThreadPool *_currentPool = nullptr;
+            thread_local size_t _currentQueue = 0;
+            
+        }
+        
+        ThreadPool &ThreadPool::shared() {
+            if (ThreadPool *pool = _sharedOverride) {
+                return *pool;
+            }
+            
+            static ThreadPool pool((_sharedCreated = true, _sharedThreadCount));
+            return pool;
+        }
+        
+        void ThreadPool::setSharedThreadCount(size_t threadCount) {
+            if (_sharedCreated) {
+                CI_LOG_E("Shared ThreadPool already created; setSharedThreadCount(" << threadCount << ") has no effect");
+                return;
+            }
+            _sharedThreadCount = threadCount;
+        }
+        
+        ThreadPool::ScopedSharedOverride::ScopedSharedOverride(ThreadPool &pool) :
+        _previous(_sharedOverride.exchange(&pool)) {
+        }
+        
+        ThreadPool::ScopedSharedOverride::~ScopedSharedOverride() {
+            _sharedOverride = _previous;
+        }
+        
+        /*
+         vector<unique_ptr<worker_queue>> _queues;
+         vector<std::thread> _workers;
+         
+         std::mutex _wakeMutex;
+         std::condition_variable _wake;
+         std::atomic<ptrdiff_t> _queued;
+         std::atomic<size_t> _nextQueue;
+         bool _stopping;
+         */
+        
+        ThreadPool::ThreadPool(size_t threadCount) :
+        _queued(0),
+        _nextQueue(0),
+        _stopping(false) {
+            if (threadCount == 0) {
+                threadCount = max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+            
+            for (size_t i = 0; i + 1 < threadCount; i++) {
+                _queues.emplace_back(new worker_queue());
+            }
+            
+            for (size_t i = 0; i + 1 < threadCount; i++) {
+                _workers.emplace_back(&ThreadPool::workerMain, this, i);
+            }
+        }
+        
+        ThreadPool::~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+                _stopping = true;
+            }
+            _wake.notify_all();
+            
+            // workers drain every queue before they exit, so nothing enqueued is dropped
+            for (auto &worker : _workers) {
+                worker.join();
+            }
+        }
+        
+        void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &fn) {
+            if (count == 0) {
+                return;
+            }
+            
+            if (_workers.empty() || count == 1) {
+                for (size_t i = 0; i < count; i++) {
+                    fn(i);
+                }
+                return;
+            }
+            
+            //
+            //  Workers and the caller claim indices from the batch until none are left. The caller only ever runs
+            //  its own batch's indices, never another task in the pool, so a parallelFor on the main thread can't
+            //  pick up something long running like an async cut. Every claimed index is being run by some thread,
+            //  so once the caller runs out it blocks until they finish.
+            //
+            
+            auto b = make_shared<batch>(fn, count);
+            auto runIndices = [b]() {
+                size_t completed = 0;
+                for (size_t i = b->next++; i < b->count; i = b->next++) {
+                    b->fn(i);
+                    completed++;
+                }
+                
+                if (completed > 0 && (b->completed += completed) == b->count) {
+                    std::lock_guard<std::mutex> lock(b->mutex);
+                    b->done.notify_all();
+                }
+            };
+            
+            // one helper per worker at most; a helper which arrives after the batch is claimed returns right away
+            const size_t helpers = min(count - 1, _workers.size());
+            const size_t home = _currentPool == this ? _currentQueue : _nextQueue++ % _queues.size();
+            for (size_t i = 0; i < helpers; i++) {
+                worker_queue &queue = *_queues[(home + i) % _queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.emplace_back(runIndices);
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+                _queued += helpers;
+            }
+            _wake.notify_all();
+            
+            runIndices();
+            
+            std::unique_lock<std::mutex> lock(b->mutex);
+            b->done.wait(lock, [&b]() {
+                return b->completed == b->count;
+            });
+        }
+        
+        void ThreadPool::enqueue(const std::function<void()> &fn) {
+            if (_workers.empty()) {
+                fn();
+                return;
+            }
+            
+            const size_t home = _currentPool == this ? _currentQueue : _nextQueue++ % _queues.size();
+            {
+                worker_queue &queue = *_queues[home];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.emplace_back(fn);
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+                _queued++;
+            }
+            _wake.notify_all();
+        }
+        
+        void ThreadPool::workerMain(size_t index) {
+            _currentPool = this;
+            _currentQueue = index;
+            
+            while (true) {
+                if (runTask(index)) {
+                    continue;
+                }
+                
+                std::unique_lock<std::mutex> lock(_wakeMutex);
+                _wake.wait(lock, [this]() {
+                    return _stopping || _queued > 0;
+                });
+                
+                if (_stopping && _queued == 0) {
+                    return;
+                }
+            }
+        }
+        
+        bool ThreadPool::runTask(size_t home) {
+            task t;
+            
+            for (size_t k = 0, N = _queues.size(); k < N && !t; k++) {
+                worker_queue &queue = *_queues[(home + k) % N];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty()) {
+                    if (k == 0) {
+                        t = std::move(queue.tasks.back());
+                        queue.tasks.pop_back();
+                    } else {
+                        t = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                    }
+                }
+            }
+            
+            if (!t) {
+                return false;
+            }
+            
+            _queued--;
+            t();
+            return true;
+        }
+        
+    }
+} // end namespace core::util
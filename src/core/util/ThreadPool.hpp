@@ -0,0 +1,140 @@
+//
+//  ThreadPool.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/18/18.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/Common.hpp"
+
+namespace core {
+    namespace util {
+        
+        /**
+         ThreadPool is a persistent set of worker threads with a work-stealing scheduler. Each worker has its own
+         task queue; it pops its newest task first and, when its queue is empty, steals the oldest task from another
+         worker. The thread calling parallelFor runs its own batch's calls alongside the workers, and only those, so
+         parallelFor may be called from inside a task without deadlocking. Destroying the pool runs every queued task first.
+         
+         Most code should use ThreadPool::shared(), so image processing, terrain and particles share one set of threads.
+         */
+        class ThreadPool {
+        public:
+            
+            /**
+             Get the shared pool, created on first use with the count set by setSharedThreadCount (hardware concurrency by default)
+             */
+            static ThreadPool &shared();
+            
+            /**
+             Set the number of threads the shared pool will have. Must be called before the first call to shared().
+             */
+            static void setSharedThreadCount(size_t threadCount);
+            
+            /**
+             While alive, routes shared() to another pool, so work which uses the shared pool can be run at a chosen thread
+             count; e.g. to check that its output doesn't depend on it. Only create or destroy one while nothing is running
+             on the shared pool.
+             */
+            class ScopedSharedOverride {
+            public:
+                
+                explicit ScopedSharedOverride(ThreadPool &pool);
+                
+                ~ScopedSharedOverride();
+                
+                ScopedSharedOverride(const ScopedSharedOverride &) = delete;
+                ScopedSharedOverride &operator=(const ScopedSharedOverride &) = delete;
+                
+            private:
+                
+                ThreadPool *_previous;
+            };
+            
+            /**
+             Create a pool which runs work on `threadCount threads, including the thread calling parallelFor.
+             Passing 0 uses hardware concurrency; passing 1 creates no workers and runs everything on the caller.
+             */
+            explicit ThreadPool(size_t threadCount = 0);
+            
+            ~ThreadPool();
+            
+            ThreadPool(const ThreadPool &) = delete;
+            ThreadPool &operator=(const ThreadPool &) = delete;
+            
+            // number of threads which run work, including the caller of parallelFor
+            size_t getThreadCount() const {
+                return _workers.size() + 1;
+            }
+            
+            /**
+             Call fn(i) for every i in [0,count) across the pool, returning once all calls have completed.
+             Calls may run in any order and on any thread; fn must not throw.
+             */
+            void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+            
+            /**
+             Queue fn to run once on a worker and return without waiting for it; the caller must arrange to learn when it
+             has run. A pool with no workers runs fn on the caller before returning. fn must not throw.
+             */
+            void enqueue(const std::function<void()> &fn);
+        
+        private:
+            
+            typedef std::function<void()> task;
+            
+            // a parallelFor call; indices are claimed from `next, and `done is signalled when `completed reaches `count
+            struct batch {
+                const std::function<void(size_t)> &fn;
+                const size_t count;
+                std::atomic<size_t> next, completed;
+                std::mutex mutex;
+                std::condition_variable done;
+                
+                batch(const std::function<void(size_t)> &fn, size_t count):
+                fn(fn),
+                count(count),
+                next(0),
+                completed(0)
+                {}
+            };
+            
+            struct worker_queue {
+                std::mutex mutex;
+                std::deque<task> tasks;
+            };
+            
+            void workerMain(size_t index);
+            
+            // run one task, preferring the newest in queue `home and otherwise stealing the oldest from another; returns false if every queue was empty
+            bool runTask(size_t home);
+        
+        private:
+            
+            vector<unique_ptr<worker_queue>> _queues;
+            vector<std::thread> _workers;
+            
+            std::mutex _wakeMutex;
+            std::condition_variable _wake;
+            std::atomic<ptrdiff_t> _queued;
+            std::atomic<size_t> _nextQueue;
+            bool _stopping;
+            
+        };
+        
+    }
+} // end namespace core::util
+
+#endif /* ThreadPool_hpp */
@@ -208,6 +208,27 @@ namespace marching_squares {
 #pragma mark Public API
 
 
+    /**
+     March just the cells from firstCell to lastCell (inclusive) of a 2D voxel space. Cell (x,y) spans voxels (x,y) to (x+1,y+1),
+     so marching cells min()-1 through max() covers the whole space including its border. Disjoint cell ranges can be marched
+     concurrently, and together emit the same segments as marching the whole space.
+     */
+    template<class VOXELSTORE, class SEGCALLBACK>
+    void march(const VOXELSTORE &voxels, SEGCALLBACK &sc, ivec2 firstCell, ivec2 lastCell, double isolevel = 0.5) {
+        segment segments[2];
+        grid_cell cell;
+
+        for (int y = firstCell.y; y <= lastCell.y; y++) {
+            for (int x = firstCell.x; x <= lastCell.x; x++) {
+                if (GetGridCell(x, y, voxels, cell)) {
+                    for (int s = 0, nSegments = Polygonise(cell, isolevel, segments); s < nSegments; s++) {
+                        sc(x, y, segments[s]);
+                    }
+                }
+            }
+        }
+    }
+
     /**
      March a 2D voxel space, invoking the segment callback on each generated segment
 
@@ -226,19 +247,7 @@ namespace marching_squares {
 
     template<class VOXELSTORE, class SEGCALLBACK>
     void march(const VOXELSTORE &voxels, SEGCALLBACK &sc, double isolevel = 0.5) {
-        segment segments[2];
-        grid_cell cell;
-        ivec2 min = voxels.min(), max = voxels.max();
-
-        for (int y = min.y - 1; y <= max.y; y++) {
-            for (int x = min.x - 1; x <= max.x; x++) {
-                if (GetGridCell(x, y, voxels, cell)) {
-                    for (int s = 0, nSegments = Polygonise(cell, isolevel, segments); s < nSegments; s++) {
-                        sc(x, y, segments[s]);
-                    }
-                }
-            }
-        }
+        march(voxels, sc, voxels.min() - ivec2(1), voxels.max(), isolevel);
     }
 
 }
@@ -6,6 +6,8 @@
 //
 
 #include <queue>
+#include <numeric>
+#include <unordered_map>
 
 #include "elements/Terrain/TerrainDetail.hpp"
 #include "core/util/ContourSimplification.hpp"
@@ -150,6 +152,21 @@ namespace elements {
                 return bb;
             }
             
+            vector<dpolygon2> polygon_union(const vector<dpolygon2> &polygons) {
+                typedef boost::geometry::model::multi_polygon<dpolygon2> dmultipolygon2;
+                
+                dmultipolygon2 result;
+                for (auto polygon : polygons) {
+                    boost::geometry::correct(polygon);
+                    
+                    dmultipolygon2 merged;
+                    boost::geometry::union_(result, polygon, merged);
+                    result = std::move(merged);
+                }
+                
+                return vector<dpolygon2>(result.begin(), result.end());
+            }
+            
 #pragma mark - Conversion to/from Boost::Geometry, PolyLine2d & Shape
             
             typedef dpolygon2::inner_container_type::const_iterator RingIterator;
@@ -324,76 +341,282 @@ namespace elements {
             
 #pragma mark - Contour Soup
             
+            namespace {
+                
+                /**
+                 For each contour, find the other contours containing its first vertex according to PolyLine2d::contains, which is
+                 the test build_contour_tree has always nested by. Rather than testing every pair, the first vertices are swept in x
+                 order across the contours' bounds sorted by left edge, and only contours whose bounds hold a vertex are tested.
+                 Returns, for each contour, the ascending indices of the contours whose first vertex it contains.
+                 */
+                vector<vector<size_t>> find_containees(const vector <PolyLine2d> &contours) {
+                    const size_t count = contours.size();
+                    
+                    struct bounds {
+                        double left, right, bottom, top;
+                    };
+                    
+                    // padded so the float conversion PolyLine2d::contains makes can't move a vertex out of bounds
+                    vector<bounds> contourBounds(count);
+                    for (size_t i = 0; i < count; i++) {
+                        bounds b = { numeric_limits<double>::max(), -numeric_limits<double>::max(), numeric_limits<double>::max(), -numeric_limits<double>::max() };
+                        for (const auto &p : contours[i].getPoints()) {
+                            b.left = min(b.left, p.x);
+                            b.right = max(b.right, p.x);
+                            b.bottom = min(b.bottom, p.y);
+                            b.top = max(b.top, p.y);
+                        }
+                        
+                        const double pad = 1e-6 * (1 + max(max(abs(b.left), abs(b.right)), max(abs(b.bottom), abs(b.top))));
+                        b.left -= pad;
+                        b.right += pad;
+                        b.bottom -= pad;
+                        b.top += pad;
+                        contourBounds[i] = b;
+                    }
+                    
+                    vector<size_t> byLeft, queries;
+                    for (size_t i = 0; i < count; i++) {
+                        // contains is always false for contours of 2 or fewer vertices
+                        if (contours[i].getPoints().size() > 2) {
+                            byLeft.push_back(i);
+                        }
+                        if (!contours[i].getPoints().empty()) {
+                            queries.push_back(i);
+                        }
+                    }
+                    
+                    sort(byLeft.begin(), byLeft.end(), [&contourBounds](size_t a, size_t b) {
+                        return contourBounds[a].left < contourBounds[b].left;
+                    });
+                    
+                    sort(queries.begin(), queries.end(), [&contours](size_t a, size_t b) {
+                        return contours[a].getPoints().front().x < contours[b].getPoints().front().x;
+                    });
+                    
+                    vector<vector<size_t>> containees(count);
+                    vector<size_t> active;
+                    auto nextLeft = byLeft.begin();
+                    
+                    for (size_t c : queries) {
+                        const dvec2 vertex = contours[c].getPoints().front();
+                        
+                        while (nextLeft != byLeft.end() && contourBounds[*nextLeft].left <= vertex.x) {
+                            active.push_back(*nextLeft);
+                            ++nextLeft;
+                        }
+                        
+                        // drop contours the sweep has passed, and test the rest
+                        size_t kept = 0;
+                        for (size_t d : active) {
+                            const bounds &b = contourBounds[d];
+                            if (b.right < vertex.x) {
+                                continue;
+                            }
+                            
+                            active[kept++] = d;
+                            if (d != c && vertex.y >= b.bottom && vertex.y <= b.top && contours[d].contains(vertex)) {
+                                containees[d].push_back(c);
+                            }
+                        }
+                        active.resize(kept);
+                    }
+                    
+                    for (auto &c : containees) {
+                        sort(c.begin(), c.end());
+                    }
+                    
+                    return containees;
+                }
+                
+                /**
+                 Builds the same tree as reference::build_contour_tree from the containment relation found by find_containees.
+                 Each level repeatedly takes the first remaining contour not contained by any other remaining contour of that
+                 level as a root, and every remaining contour it contains as that root's inner contours, which form the next level.
+                 Rather than rescanning, each contour keeps a count of its containers remaining in its level.
+                 */
+                class contour_tree_builder {
+                public:
+                    
+                    contour_tree_builder(const vector <PolyLine2d> &contours) :
+                    _contours(contours),
+                    _containees(find_containees(contours)),
+                    _containerCounts(contours.size(), 0),
+                    _levels(contours.size(), 0),
+                    _nextLevel(1) {
+                    }
+                    
+                    // `level is a list of contour indices in ascending order, as the soup was ordered
+                    vector <contour_tree_node_ref> build(const vector<size_t> &level) {
+                        const size_t id = _nextLevel++;
+                        for (size_t c : level) {
+                            _levels[c] = id;
+                            _containerCounts[c] = 0;
+                        }
+                        
+                        for (size_t d : level) {
+                            for (size_t c : _containees[d]) {
+                                if (_levels[c] == id) {
+                                    _containerCounts[c]++;
+                                }
+                            }
+                        }
+                        
+                        // contours with no remaining container, lowest index first; entries for contours which have since been taken are skipped
+                        priority_queue<size_t, vector<size_t>, greater<size_t>> uncontained;
+                        for (size_t c : level) {
+                            if (_containerCounts[c] == 0) {
+                                uncontained.push(c);
+                            }
+                        }
+                        
+                        vector <contour_tree_node_ref> rootNodes;
+                        size_t remaining = level.size();
+                        auto firstRemaining = level.begin();
+                        
+                        while (remaining > 0) {
+                            while (!uncontained.empty() && _levels[uncontained.top()] != id) {
+                                uncontained.pop();
+                            }
+                            
+                            size_t root;
+                            if (!uncontained.empty()) {
+                                root = uncontained.top();
+                                uncontained.pop();
+                            } else {
+                                // every remaining contour is inside another, which only happens when contours overlap; where the
+                                // original search would never terminate, take the first remaining contour as the root
+                                while (_levels[*firstRemaining] != id) {
+                                    ++firstRemaining;
+                                }
+                                root = *firstRemaining;
+                            }
+                            
+                            // take the root and the contours inside it out of this level
+                            _levels[root] = 0;
+                            vector<size_t> inner;
+                            for (size_t c : _containees[root]) {
+                                if (_levels[c] == id) {
+                                    _levels[c] = 0;
+                                    inner.push_back(c);
+                                }
+                            }
+                            remaining -= inner.size() + 1;
+                            
+                            for (size_t x : inner) {
+                                for (size_t c : _containees[x]) {
+                                    if (_levels[c] == id && --_containerCounts[c] == 0) {
+                                        uncontained.push(c);
+                                    }
+                                }
+                            }
+                            
+                            contour_tree_node_ref node = make_shared<contour_tree_node>();
+                            node->contour = _contours[root];
+                            node->children = build(inner);
+                            rootNodes.push_back(node);
+                        }
+                        
+                        return rootNodes;
+                    }
+                    
+                private:
+                    
+                    const vector <PolyLine2d> &_contours;
+                    vector<vector<size_t>> _containees;
+                    vector<size_t> _containerCounts;
+                    
+                    // the id of the level each contour is currently in, or 0 once it has been placed in the tree
+                    vector<size_t> _levels;
+                    size_t _nextLevel;
+                };
+                
+            }
+            
             /**
              Given a "soup" of contours (an unordered mess of closed polylines) build a tree (with possibly
              multiple roots) which describes their nesting in a manner useful for constructing PolyShapes
              */
             vector <contour_tree_node_ref> build_contour_tree(const vector <PolyLine2d> &contourSoup) {
+                vector<size_t> all(contourSoup.size());
+                iota(all.begin(), all.end(), 0);
+                return contour_tree_builder(contourSoup).build(all);
+            }
+            
+            namespace reference {
                 
-                // simple cases
-                if (contourSoup.size() == 0) {
-                    return vector<contour_tree_node_ref>();
-                } else if (contourSoup.size() == 1) {
-                    contour_tree_node_ref node = make_shared<contour_tree_node>();
-                    node->contour = contourSoup.front();
-                    vector <contour_tree_node_ref> ret = {node};
-                    return ret;
-                }
-                
-                
-                // create a set of pointers to our polylines
-                set<const PolyLine2d *> contours;
-                for (auto &pl : contourSoup) {
-                    contours.insert(&pl);
-                }
-                
-                vector <contour_tree_node_ref> rootNodes;
-                while (!contours.empty()) {
+                /**
+                 Given a "soup" of contours (an unordered mess of closed polylines) build a tree (with possibly
+                 multiple roots) which describes their nesting in a manner useful for constructing PolyShapes
+                 */
+                vector <contour_tree_node_ref> build_contour_tree(const vector <PolyLine2d> &contourSoup) {
                     
+                    // simple cases
+                    if (contourSoup.size() == 0) {
+                        return vector<contour_tree_node_ref>();
+                    } else if (contourSoup.size() == 1) {
+                        contour_tree_node_ref node = make_shared<contour_tree_node>();
+                        node->contour = contourSoup.front();
+                        vector <contour_tree_node_ref> ret = {node};
+                        return ret;
+                    }
                     
-                    contour_tree_node_ref node = make_shared<contour_tree_node>();
-                    rootNodes.push_back(node);
                     
-                    // find first polyline which is not a hole in another polyline. remove it
-                    for (auto candidateIt = begin(contours); candidateIt != end(contours); ++candidateIt) {
-                        bool isHole = false;
-                        for (auto it2 = begin(contours); it2 != end(contours); ++it2) {
-                            if (candidateIt != it2) {
-                                if ((*it2)->contains(*(*candidateIt)->begin())) {
-                                    isHole = true;
-                                    break;
+                    // create a set of pointers to our polylines
+                    set<const PolyLine2d *> contours;
+                    for (auto &pl : contourSoup) {
+                        contours.insert(&pl);
+                    }
+                    
+                    vector <contour_tree_node_ref> rootNodes;
+                    while (!contours.empty()) {
+                        
+                        
+                        contour_tree_node_ref node = make_shared<contour_tree_node>();
+                        rootNodes.push_back(node);
+                        
+                        // find first polyline which is not a hole in another polyline. remove it
+                        for (auto candidateIt = begin(contours); candidateIt != end(contours); ++candidateIt) {
+                            bool isHole = false;
+                            for (auto it2 = begin(contours); it2 != end(contours); ++it2) {
+                                if (candidateIt != it2) {
+                                    if ((*it2)->contains(*(*candidateIt)->begin())) {
+                                        isHole = true;
+                                        break;
+                                    }
                                 }
                             }
+                            
+                            // we found a non-hole contour; remove candidate from set and break loop
+                            if (!isHole) {
+                                node->contour = **candidateIt;
+                                contours.erase(candidateIt);
+                                break;
+                            }
                         }
                         
-                        // we found a non-hole contour; remove candidate from set and break loop
-                        if (!isHole) {
-                            node->contour = **candidateIt;
-                            contours.erase(candidateIt);
-                            break;
-                        }
-                    }
-                    
-                    // find each polyline which is inside the one we just found
-                    vector <PolyLine2d> innerContours;
-                    for (auto candidateHoleIt = begin(contours); candidateHoleIt != end(contours);) {
-                        if (node->contour.contains(*(*candidateHoleIt)->begin())) {
-                            innerContours.push_back(**candidateHoleIt);
-                            candidateHoleIt = contours.erase(candidateHoleIt);
-                        } else {
-                            ++candidateHoleIt;
+                        // find each polyline which is inside the one we just found
+                        vector <PolyLine2d> innerContours;
+                        for (auto candidateHoleIt = begin(contours); candidateHoleIt != end(contours);) {
+                            if (node->contour.contains(*(*candidateHoleIt)->begin())) {
+                                innerContours.push_back(**candidateHoleIt);
+                                candidateHoleIt = contours.erase(candidateHoleIt);
+                            } else {
+                                ++candidateHoleIt;
+                            }
                         }
+                        
+                        // now we know innerContours are children of node->outerContour - but
+                        // only those with no children may become holes. Any which have children
+                        // themselves must become new root nodes
+                        
+                        auto children = build_contour_tree(innerContours);
+                        node->children.insert(end(node->children), begin(children), end(children));
                     }
                     
-                    // now we know innerContours are children of node->outerContour - but
-                    // only those with no children may become holes. Any which have children
-                    // themselves must become new root nodes
-                    
-                    auto children = build_contour_tree(innerContours);
-                    node->children.insert(end(node->children), begin(children), end(children));
+                    return rootNodes;
                 }
                 
-                return rootNodes;
             }
             
             vector <ShapeRef> build_from_contour_tree(contour_tree_node_ref rootNode, int depth) {
@@ -502,6 +725,61 @@ namespace elements {
                 return group;
             }
             
+            vector <set<ShapeRef>> find_contact_groups(const vector <ShapeRef> &shapes, const map <ShapeRef, GroupBaseRef> &parentage) {
+                
+                //
+                // Union-find over shared poly_edges. Each edge records the first shape (per parent group) which
+                // claimed it; every later shape of the same parentage with that edge is unioned with the claimant.
+                // We walk shapes in set order so groups come out in the same order find_contact_group produces them.
+                //
+                
+                const set <ShapeRef> uniqueShapes(shapes.begin(), shapes.end());
+                const vector <ShapeRef> orderedShapes(uniqueShapes.begin(), uniqueShapes.end());
+                const size_t N = orderedShapes.size();
+                
+                vector <size_t> parents(N);
+                std::iota(parents.begin(), parents.end(), 0);
+                
+                auto findRoot = [&parents](size_t i) {
+                    while (parents[i] != i) {
+                        parents[i] = parents[parents[i]];
+                        i = parents[i];
+                    }
+                    return i;
+                };
+                
+                map <GroupBaseRef, unordered_map<poly_edge, size_t>> edgeClaimantsByParent;
+                for (size_t i = 0; i < N; i++) {
+                    const ShapeRef &shape = orderedShapes[i];
+                    auto &edgeClaimants = edgeClaimantsByParent[floodfill::shape_get_parent_group(shape, parentage)];
+                    
+                    for (const auto &edge : shape->getWorldSpaceContourEdges()) {
+                        auto result = edgeClaimants.emplace(edge, i);
+                        if (!result.second) {
+                            size_t a = findRoot(result.first->second);
+                            size_t b = findRoot(i);
+                            if (a != b) {
+                                // keep the lowest index as root
+                                parents[max(a, b)] = min(a, b);
+                            }
+                        }
+                    }
+                }
+                
+                vector <set<ShapeRef>> groups;
+                vector <size_t> groupIndexByRoot(N, N);
+                for (size_t i = 0; i < N; i++) {
+                    const size_t root = findRoot(i);
+                    if (groupIndexByRoot[root] == N) {
+                        groupIndexByRoot[root] = groups.size();
+                        groups.emplace_back();
+                    }
+                    groups[groupIndexByRoot[root]].insert(orderedShapes[i]);
+                }
+                
+                return groups;
+            }
+            
 #pragma mark - Mitering
             
             /**
@@ -52,6 +52,9 @@ namespace elements {
             
             cpBB polygon_bb(const dpolygon2 poly);
             
+            // union a set of (possibly overlapping) polygons, returning disjoint polygons
+            vector<dpolygon2> polygon_union(const vector<dpolygon2> &polygons);
+            
 #pragma mark - Conversion to/from Boost::Geometry, PolyLine2d & Shape
             
             struct polyline_with_holes {
@@ -87,10 +90,19 @@ namespace elements {
             
             /**
              Given a "soup" of contours (an unordered mess of closed polylines) build a tree (with possibly
-             multiple roots) which describes their nesting in a manner useful for constructing PolyShapes
+             multiple roots) which describes their nesting in a manner useful for constructing PolyShapes.
+             Containment candidates are found with a sweep over the contours' bounds, so this scales well past the
+             quadratic pairwise search of reference::build_contour_tree while producing the same tree.
              */
             vector<contour_tree_node_ref> build_contour_tree(const vector<PolyLine2d> &contourSoup);
             
+            namespace reference {
+                
+                // the original pairwise implementation of build_contour_tree, kept for verification and benchmarking
+                vector<contour_tree_node_ref> build_contour_tree(const vector<PolyLine2d> &contourSoup);
+                
+            }
+            
             vector<ShapeRef> build_from_contour_tree(contour_tree_node_ref rootNode, int depth);
             
 #pragma mark - Sorted Ref Pair
@@ -132,6 +144,13 @@ namespace elements {
             // flood fill, finding all shapes which can reach origin
             set<ShapeRef> find_contact_group(ShapeRef origin, const set<ShapeRef> &all, const map<ShapeRef, GroupBaseRef> &parentage);
             
+            /**
+             Partition `shapes into groups of shapes of common parentage connected by shared edges; equivalent to
+             repeatedly calling find_contact_group, but near-linear in the total edge count instead of quadratic in shape count.
+             Groups are returned in the same order find_contact_group would discover them.
+             */
+            vector<set<ShapeRef>> find_contact_groups(const vector<ShapeRef> &shapes, const map<ShapeRef, GroupBaseRef> &parentage);
+            
 #pragma mark - Mitering
             
             /**
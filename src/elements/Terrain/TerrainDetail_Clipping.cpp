@@ -0,0 +1,799 @@
+//
+//  TerrainDetail_Clipping.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/10/18.
+//
+
+#include "elements/Terrain/TerrainDetail_Clipping.hpp"
+
+#include <limits>
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+            namespace {
+                
+                const double MIN_HOLE_AREA = 1;
+                const size_t NO_FRAGMENT = std::numeric_limits<size_t>::max();
+                
+#pragma mark - Fixed Point Geometry
+                
+                /**
+                 A vertex snapped to the 1/POLY_EDGE_PRECISION grid. We use 64-bit coordinates so that
+                 the cross products used by the predicates below are exact.
+                 */
+                struct fixed_vertex {
+                    int64_t x, y;
+                    
+                    fixed_vertex() :
+                    x(0),
+                    y(0) {
+                    }
+                    
+                    fixed_vertex(int64_t X, int64_t Y) :
+                    x(X),
+                    y(Y) {
+                    }
+                    
+                    friend bool operator==(const fixed_vertex &a, const fixed_vertex &b) {
+                        return a.x == b.x && a.y == b.y;
+                    }
+                    
+                    friend bool operator!=(const fixed_vertex &a, const fixed_vertex &b) {
+                        return a.x != b.x || a.y != b.y;
+                    }
+                    
+                    friend bool operator<(const fixed_vertex &a, const fixed_vertex &b) {
+                        return a.x != b.x ? a.x < b.x : a.y < b.y;
+                    }
+                };
+                
+                typedef vector<fixed_vertex> fixed_ring;
+                
+                struct fixed_bb {
+                    int64_t l, b, r, t;
+                    
+                    fixed_bb() :
+                    l(numeric_limits<int64_t>::max()),
+                    b(numeric_limits<int64_t>::max()),
+                    r(numeric_limits<int64_t>::min()),
+                    t(numeric_limits<int64_t>::min()) {
+                    }
+                    
+                    fixed_bb(const fixed_vertex &a, const fixed_vertex &c) :
+                    l(std::min(a.x, c.x)),
+                    b(std::min(a.y, c.y)),
+                    r(std::max(a.x, c.x)),
+                    t(std::max(a.y, c.y)) {
+                    }
+                    
+                    void expand(const fixed_vertex &v) {
+                        l = std::min(l, v.x);
+                        b = std::min(b, v.y);
+                        r = std::max(r, v.x);
+                        t = std::max(t, v.y);
+                    }
+                    
+                    bool intersects(const fixed_bb &o) const {
+                        return l <= o.r && o.l <= r && b <= o.t && o.b <= t;
+                    }
+                };
+                
+                inline int64_t orient(const fixed_vertex &o, const fixed_vertex &a, const fixed_vertex &b) {
+                    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+                }
+                
+                inline int sign(int64_t v) {
+                    return (v > 0) - (v < 0);
+                }
+                
+                inline fixed_vertex to_fixed(const dvec2 &v) {
+                    return fixed_vertex(llround(v.x * POLY_EDGE_PRECISION), llround(v.y * POLY_EDGE_PRECISION));
+                }
+                
+                inline dvec2 from_fixed(const fixed_vertex &v) {
+                    return dvec2(v.x / POLY_EDGE_PRECISION, v.y / POLY_EDGE_PRECISION);
+                }
+                
+                // twice the signed area of a ring; positive for counter-clockwise winding
+                int64_t doubled_signed_area(const fixed_ring &ring) {
+                    int64_t sum = 0;
+                    for (size_t i = 0, N = ring.size(); i < N; i++) {
+                        const fixed_vertex &a = ring[i];
+                        const fixed_vertex &b = ring[(i + 1) % N];
+                        sum += a.x * b.y - b.x * a.y;
+                    }
+                    return sum;
+                }
+                
+                /**
+                 Remove repeated and collinear vertices (including zero-width spikes) from a ring.
+                 Returns false if the ring degenerated to fewer than 3 vertices.
+                 */
+                bool clean(fixed_ring &ring) {
+                    fixed_ring cleaned;
+                    cleaned.reserve(ring.size());
+                    
+                    for (const auto &v : ring) {
+                        if (!cleaned.empty() && cleaned.back() == v) {
+                            continue;
+                        }
+                        
+                        while (cleaned.size() >= 2 && orient(cleaned[cleaned.size() - 2], cleaned.back(), v) == 0) {
+                            cleaned.pop_back();
+                        }
+                        
+                        cleaned.push_back(v);
+                    }
+                    
+                    // the single pass above can't see across the seam between last and first vertex
+                    bool modified = true;
+                    while (modified && cleaned.size() >= 3) {
+                        const size_t N = cleaned.size();
+                        modified = true;
+                        
+                        if (cleaned.front() == cleaned.back() || orient(cleaned[N - 2], cleaned[N - 1], cleaned[0]) == 0) {
+                            cleaned.pop_back();
+                        } else if (orient(cleaned[N - 1], cleaned[0], cleaned[1]) == 0) {
+                            cleaned.erase(cleaned.begin());
+                        } else {
+                            modified = false;
+                        }
+                    }
+                    
+                    ring.swap(cleaned);
+                    return ring.size() >= 3;
+                }
+                
+                fixed_ring to_fixed_ring(const PolyLine2d &contour) {
+                    fixed_ring ring;
+                    ring.reserve(contour.size());
+                    for (const dvec2 &p : contour.getPoints()) {
+                        const fixed_vertex v = to_fixed(p);
+                        if (ring.empty() || ring.back() != v) {
+                            ring.push_back(v);
+                        }
+                    }
+                    
+                    // contours may or may not repeat first vertex as last
+                    while (ring.size() > 1 && ring.front() == ring.back()) {
+                        ring.pop_back();
+                    }
+                    
+                    return ring;
+                }
+                
+                fixed_ring to_fixed_ring(const dpolygon2::ring_type &boostRing) {
+                    fixed_ring ring;
+                    ring.reserve(boostRing.size());
+                    for (const auto &p : boostRing) {
+                        const fixed_vertex v = to_fixed(dvec2(boost::geometry::get<0>(p), boost::geometry::get<1>(p)));
+                        if (ring.empty() || ring.back() != v) {
+                            ring.push_back(v);
+                        }
+                    }
+                    
+                    while (ring.size() > 1 && ring.front() == ring.back()) {
+                        ring.pop_back();
+                    }
+                    
+                    return ring;
+                }
+                
+                /**
+                 A polygon with holes in fixed point. Outer ring is wound counter-clockwise, holes clockwise.
+                 */
+                struct fixed_polygon {
+                    vector<fixed_ring> rings;
+                    fixed_bb bb;
+                    
+                    // add a ring, winding it appropriately. returns false if the ring is degenerate
+                    bool add(fixed_ring ring, bool isOuter) {
+                        if (!clean(ring)) {
+                            return false;
+                        }
+                        
+                        const int64_t area = doubled_signed_area(ring);
+                        if (area == 0) {
+                            return false;
+                        }
+                        
+                        if ((area > 0) != isOuter) {
+                            std::reverse(ring.begin(), ring.end());
+                        }
+                        
+                        for (const auto &v : ring) {
+                            bb.expand(v);
+                        }
+                        
+                        rings.push_back(ring);
+                        return true;
+                    }
+                };
+                
+#pragma mark - Edge Splitting
+                
+                struct fixed_edge {
+                    fixed_vertex a, b;
+                    fixed_bb bb;
+                    vector<fixed_vertex> splits;
+                    
+                    fixed_edge(const fixed_vertex &A, const fixed_vertex &B) :
+                    a(A),
+                    b(B),
+                    bb(A, B) {
+                    }
+                    
+                    // true if v lies on the closed segment, given that v is known to be collinear with it
+                    bool contains_collinear(const fixed_vertex &v) const {
+                        return v.x >= bb.l && v.x <= bb.r && v.y >= bb.b && v.y <= bb.t;
+                    }
+                    
+                    // true if v lies in the edge's interior, e.g., it would split the edge
+                    bool splits_at(const fixed_vertex &v) const {
+                        return v != a && v != b;
+                    }
+                };
+                
+                typedef vector<fixed_edge> fixed_edges;
+                
+                // a bare directed fragment, cheap to copy when linking loops
+                struct fixed_segment {
+                    fixed_vertex a, b;
+                    
+                    fixed_segment(const fixed_vertex &A, const fixed_vertex &B) :
+                    a(A),
+                    b(B) {
+                    }
+                };
+                
+                typedef vector<fixed_segment> fixed_segments;
+                
+                void collect_edges(const fixed_polygon &polygon, fixed_edges &edges) {
+                    for (const auto &ring : polygon.rings) {
+                        for (size_t i = 0, N = ring.size(); i < N; i++) {
+                            edges.emplace_back(ring[i], ring[(i + 1) % N]);
+                        }
+                    }
+                }
+                
+                fixed_bb edges_bb(const fixed_edges &edges) {
+                    fixed_bb bb;
+                    for (const auto &e : edges) {
+                        bb.expand(e.a);
+                        bb.expand(e.b);
+                    }
+                    return bb;
+                }
+                
+                /**
+                 Find the intersection(s) of edges p and q, recording those which fall in an edge's interior as split points.
+                 Proper crossings are rounded to the fixed-point grid; everything else is exact.
+                 Returns true if either edge received a split.
+                 */
+                bool intersect(fixed_edge &p, fixed_edge &q) {
+                    if (!p.bb.intersects(q.bb)) {
+                        return false;
+                    }
+                    
+                    const int64_t o1 = orient(p.a, p.b, q.a);
+                    const int64_t o2 = orient(p.a, p.b, q.b);
+                    const int64_t o3 = orient(q.a, q.b, p.a);
+                    const int64_t o4 = orient(q.a, q.b, p.b);
+                    bool didSplit = false;
+                    
+                    auto addSplit = [&didSplit](fixed_edge &e, const fixed_vertex &v) {
+                        if (e.splits_at(v)) {
+                            e.splits.push_back(v);
+                            didSplit = true;
+                        }
+                    };
+                    
+                    if (o1 == 0 && o2 == 0) {
+                        
+                        // collinear - split each edge at the other's endpoints which lie on it
+                        if (p.contains_collinear(q.a)) addSplit(p, q.a);
+                        if (p.contains_collinear(q.b)) addSplit(p, q.b);
+                        if (q.contains_collinear(p.a)) addSplit(q, p.a);
+                        if (q.contains_collinear(p.b)) addSplit(q, p.b);
+                        return didSplit;
+                    }
+                    
+                    if (sign(o1) * sign(o2) > 0 || sign(o3) * sign(o4) > 0) {
+                        return false;
+                    }
+                    
+                    fixed_vertex x;
+                    if (o1 == 0) {
+                        x = q.a;
+                    } else if (o2 == 0) {
+                        x = q.b;
+                    } else if (o3 == 0) {
+                        x = p.a;
+                    } else if (o4 == 0) {
+                        x = p.b;
+                    } else {
+                        // proper crossing: x = p.a + t * (p.b - p.a)
+                        const double t = static_cast<double>(o3) / static_cast<double>(o3 - o4);
+                        x.x = llround(p.a.x + t * static_cast<double>(p.b.x - p.a.x));
+                        x.y = llround(p.a.y + t * static_cast<double>(p.b.y - p.a.y));
+                    }
+                    
+                    addSplit(p, x);
+                    addSplit(q, x);
+                    return didSplit;
+                }
+                
+                // replace each edge with the fragments produced by its split points
+                void split(fixed_edges &edges) {
+                    fixed_edges fragments;
+                    fragments.reserve(edges.size());
+                    
+                    for (const auto &edge : edges) {
+                        if (edge.splits.empty()) {
+                            fragments.emplace_back(edge.a, edge.b);
+                            continue;
+                        }
+                        
+                        const fixed_vertex dir(edge.b.x - edge.a.x, edge.b.y - edge.a.y);
+                        auto projection = [&edge, &dir](const fixed_vertex &v) -> int64_t {
+                            return (v.x - edge.a.x) * dir.x + (v.y - edge.a.y) * dir.y;
+                        };
+                        
+                        vector<fixed_vertex> splits = edge.splits;
+                        std::sort(splits.begin(), splits.end(), [&projection](const fixed_vertex &u, const fixed_vertex &v) {
+                            return projection(u) < projection(v);
+                        });
+                        
+                        fixed_vertex current = edge.a;
+                        for (const auto &s : splits) {
+                            if (s != current) {
+                                fragments.emplace_back(current, s);
+                                current = s;
+                            }
+                        }
+                        
+                        if (current != edge.b) {
+                            fragments.emplace_back(current, edge.b);
+                        }
+                    }
+                    
+                    edges.swap(fragments);
+                }
+                
+                /**
+                 Split subject and clip edges at their mutual intersections. Since rounded intersection points move
+                 fragments slightly, this is repeated until the fragments form a planar arrangement.
+                 We never intersect a polygon against itself since input contours are assumed to be simple.
+                 Returns false if the arrangement didn't settle.
+                 */
+                bool build_arrangement(fixed_edges &subjectEdges, fixed_edges &clipEdges) {
+                    const int MaxPasses = 8;
+                    
+                    for (int pass = 0; pass < MaxPasses; pass++) {
+                        const fixed_bb clipBB = edges_bb(clipEdges);
+                        bool didSplit = false;
+                        
+                        for (auto &se : subjectEdges) {
+                            if (se.bb.intersects(clipBB)) {
+                                for (auto &ce : clipEdges) {
+                                    didSplit = intersect(se, ce) || didSplit;
+                                }
+                            }
+                        }
+                        
+                        if (!didSplit) {
+                            return true;
+                        }
+                        
+                        split(subjectEdges);
+                        split(clipEdges);
+                    }
+                    
+                    return false;
+                }
+                
+                /**
+                 Even-odd containment test against a closed edge set for a point given in doubled coordinates,
+                 e.g., the sum of two vertices. Using doubled coordinates lets us test edge midpoints exactly.
+                 */
+                bool contains_doubled(const fixed_edges &edges, const fixed_bb &bb, const fixed_vertex &p) {
+                    if (p.x < 2 * bb.l || p.x > 2 * bb.r || p.y < 2 * bb.b || p.y > 2 * bb.t) {
+                        return false;
+                    }
+                    
+                    // we cast the ray towards +x, so edges wholly to the left of p can't cross it
+                    bool inside = false;
+                    for (const auto &e : edges) {
+                        const fixed_vertex u(2 * e.a.x, 2 * e.a.y);
+                        const fixed_vertex v(2 * e.b.x, 2 * e.b.y);
+                        if ((u.y > p.y) != (v.y > p.y) && (u.x >= p.x || v.x >= p.x)) {
+                            const int64_t o = orient(u, v, p);
+                            if ((v.y > u.y) ? (o > 0) : (o < 0)) {
+                                inside = !inside;
+                            }
+                        }
+                    }
+                    
+                    return inside;
+                }
+                
+                // order edges by start vertex, then end vertex, for binary searching
+                bool edge_order(const fixed_edge &e0, const fixed_edge &e1) {
+                    if (e0.a != e1.a) {
+                        return e0.a < e1.a;
+                    }
+                    return e0.b < e1.b;
+                }
+                
+                // find the index of the edge running from a to b in an edge_order sorted vector, or edges.size() if there is none
+                size_t find_edge(const fixed_edges &sortedEdges, const fixed_vertex &a, const fixed_vertex &b) {
+                    const fixed_edge probe(a, b);
+                    auto pos = std::lower_bound(sortedEdges.begin(), sortedEdges.end(), probe, edge_order);
+                    if (pos != sortedEdges.end() && pos->a == a && pos->b == b) {
+                        return pos - sortedEdges.begin();
+                    }
+                    return sortedEdges.size();
+                }
+                
+#pragma mark - Loop Tracing
+                
+                /**
+                 Open addressed index from a vertex to the fragments which start at it. Fragments sharing a start vertex
+                 are chained through `next, so a lookup costs a probe or two rather than a search.
+                 */
+                class outgoing_index {
+                public:
+                    
+                    outgoing_index(const fixed_segments &fragments) :
+                    _fragments(fragments),
+                    _next(fragments.size(), NO_FRAGMENT) {
+                        size_t capacity = 16;
+                        while (capacity < fragments.size() * 2) {
+                            capacity *= 2;
+                        }
+                        
+                        _mask = capacity - 1;
+                        _slots.resize(capacity, NO_FRAGMENT);
+                        
+                        // insert in reverse so each chain lists fragments in their original order
+                        for (size_t i = fragments.size(); i-- > 0;) {
+                            size_t &slot = _slots[find_slot(fragments[i].a)];
+                            _next[i] = slot;
+                            slot = i;
+                        }
+                    }
+                    
+                    // index of first fragment starting at v, or NO_FRAGMENT
+                    size_t first(const fixed_vertex &v) const {
+                        return _slots[find_slot(v)];
+                    }
+                    
+                    // index of the next fragment sharing fragment i's start vertex, or NO_FRAGMENT
+                    size_t next(size_t i) const {
+                        return _next[i];
+                    }
+                
+                private:
+                    
+                    size_t find_slot(const fixed_vertex &v) const {
+                        size_t slot = static_cast<size_t>(v.x * 73856093LL ^ v.y * 19349663LL) & _mask;
+                        while (_slots[slot] != NO_FRAGMENT && _fragments[_slots[slot]].a != v) {
+                            slot = (slot + 1) & _mask;
+                        }
+                        return slot;
+                    }
+                    
+                    const fixed_segments &_fragments;
+                    vector<size_t> _slots, _next;
+                    size_t _mask;
+                };
+                
+                /**
+                 Link directed fragments into closed loops. Where several fragments leave a vertex we take
+                 the sharpest left turn, which keeps each loop tight around the region on its left and
+                 separates loops which merely touch at a vertex.
+                 Returns false if the fragments don't form closed loops.
+                 */
+                bool trace(const fixed_segments &fragments, vector<fixed_ring> &loops) {
+                    const size_t N = fragments.size();
+                    const outgoing_index outgoing(fragments);
+                    vector<bool> used(N, false);
+                    
+                    for (size_t first = 0; first < N; first++) {
+                        if (used[first]) {
+                            continue;
+                        }
+                        
+                        fixed_ring loop;
+                        size_t current = first;
+                        used[current] = true;
+                        
+                        while (true) {
+                            const fixed_segment &f = fragments[current];
+                            loop.push_back(f.a);
+                            
+                            if (f.b == fragments[first].a) {
+                                break;
+                            }
+                            
+                            size_t available = 0, next = N;
+                            for (size_t candidate = outgoing.first(f.b); candidate != NO_FRAGMENT; candidate = outgoing.next(candidate)) {
+                                if (!used[candidate]) {
+                                    available++;
+                                    next = candidate;
+                                }
+                            }
+                            
+                            // the common case is a single way out, which needs no turn evaluation
+                            if (available > 1) {
+                                const fixed_vertex in(f.b.x - f.a.x, f.b.y - f.a.y);
+                                double bestTurn = 0;
+                                next = N;
+                                
+                                for (size_t candidate = outgoing.first(f.b); candidate != NO_FRAGMENT; candidate = outgoing.next(candidate)) {
+                                    if (used[candidate]) {
+                                        continue;
+                                    }
+                                    
+                                    const fixed_segment &c = fragments[candidate];
+                                    const fixed_vertex out(c.b.x - c.a.x, c.b.y - c.a.y);
+                                    const double crossProduct = static_cast<double>(in.x * out.y - in.y * out.x);
+                                    const double dotProduct = static_cast<double>(in.x * out.x + in.y * out.y);
+                                    double turn = atan2(crossProduct, dotProduct);
+                                    
+                                    // a u-turn is the turn of last resort
+                                    if (crossProduct == 0 && dotProduct < 0) {
+                                        turn = -M_PI;
+                                    }
+                                    
+                                    if (next == N || turn > bestTurn) {
+                                        next = candidate;
+                                        bestTurn = turn;
+                                    }
+                                }
+                            }
+                            
+                            if (next == N) {
+                                return false;
+                            }
+                            
+                            used[next] = true;
+                            current = next;
+                        }
+                        
+                        loops.push_back(loop);
+                    }
+                    
+                    return true;
+                }
+                
+#pragma mark - Difference
+                
+                /**
+                 Compute subject - clip. Resulting outer rings are wound counter-clockwise and
+                 each is paired with the (clockwise) hole rings it contains.
+                 Returns false if the operation failed and the caller should fall back to another engine.
+                 */
+                bool fixed_difference(const fixed_polygon &subject, const fixed_polygon &clip, vector<pair<fixed_ring, vector<fixed_ring>>> &result) {
+                    
+                    fixed_edges subjectFragments, clipFragments;
+                    collect_edges(subject, subjectFragments);
+                    collect_edges(clip, clipFragments);
+                    
+                    if (!build_arrangement(subjectFragments, clipFragments)) {
+                        return false;
+                    }
+                    
+                    const fixed_bb subjectBB = edges_bb(subjectFragments);
+                    const fixed_bb clipBB = edges_bb(clipFragments);
+                    
+                    //
+                    // classify. For A - B:
+                    // - A's fragments outside B are kept
+                    // - B's fragments inside A are kept, reversed
+                    // - fragments shared by A and B in the same direction bound A & B and are discarded,
+                    //   those shared in opposite directions bound A - B and A's copy is kept
+                    //
+                    
+                    std::sort(clipFragments.begin(), clipFragments.end(), edge_order);
+                    const size_t NoEdge = clipFragments.size();
+                    
+                    vector<bool> clipFragmentIsShared(clipFragments.size(), false);
+                    fixed_segments kept;
+                    kept.reserve(subjectFragments.size() + clipFragments.size());
+                    
+                    for (const auto &f : subjectFragments) {
+                        if (!f.bb.intersects(clipBB)) {
+                            kept.emplace_back(f.a, f.b);
+                            continue;
+                        }
+                        
+                        const size_t same = find_edge(clipFragments, f.a, f.b);
+                        if (same != NoEdge) {
+                            clipFragmentIsShared[same] = true;
+                            continue;
+                        }
+                        
+                        const size_t opposite = find_edge(clipFragments, f.b, f.a);
+                        if (opposite != NoEdge) {
+                            clipFragmentIsShared[opposite] = true;
+                            kept.emplace_back(f.a, f.b);
+                            continue;
+                        }
+                        
+                        if (!contains_doubled(clipFragments, clipBB, fixed_vertex(f.a.x + f.b.x, f.a.y + f.b.y))) {
+                            kept.emplace_back(f.a, f.b);
+                        }
+                    }
+                    
+                    for (size_t i = 0, N = clipFragments.size(); i < N; i++) {
+                        const fixed_edge &f = clipFragments[i];
+                        if (!clipFragmentIsShared[i] && contains_doubled(subjectFragments, subjectBB, fixed_vertex(f.a.x + f.b.x, f.a.y + f.b.y))) {
+                            kept.emplace_back(f.b, f.a);
+                        }
+                    }
+                    
+                    //
+                    // link into loops, and sort loops into outers and holes
+                    //
+                    
+                    vector<fixed_ring> loops;
+                    if (!trace(kept, loops)) {
+                        return false;
+                    }
+                    
+                    vector<pair<fixed_ring, int64_t>> outers, holes;
+                    const double minHoleDoubledArea = 2 * MIN_HOLE_AREA * POLY_EDGE_PRECISION * POLY_EDGE_PRECISION;
+                    
+                    for (auto &loop : loops) {
+                        if (!clean(loop)) {
+                            continue;
+                        }
+                        
+                        const int64_t area = doubled_signed_area(loop);
+                        if (area > 0) {
+                            outers.emplace_back(loop, area);
+                        } else if (area < 0 && -area >= minHoleDoubledArea) {
+                            holes.emplace_back(loop, -area);
+                        }
+                    }
+                    
+                    result.clear();
+                    for (const auto &outer : outers) {
+                        result.emplace_back(outer.first, vector<fixed_ring>());
+                    }
+                    
+                    if (holes.empty()) {
+                        return true;
+                    }
+                    
+                    vector<fixed_edges> outerEdges(outers.size());
+                    vector<fixed_bb> outerBBs(outers.size());
+                    for (size_t i = 0, N = outers.size(); i < N; i++) {
+                        fixed_polygon outerPolygon;
+                        outerPolygon.rings.push_back(outers[i].first);
+                        collect_edges(outerPolygon, outerEdges[i]);
+                        outerBBs[i] = edges_bb(outerEdges[i]);
+                    }
+                    
+                    for (const auto &hole : holes) {
+                        
+                        // a hole belongs to the smallest outer which contains it
+                        const fixed_vertex testPoint(hole.first[0].x + hole.first[1].x, hole.first[0].y + hole.first[1].y);
+                        size_t bestOuter = outers.size();
+                        
+                        for (size_t i = 0, N = outers.size(); i < N; i++) {
+                            if (bestOuter < N && outers[i].second >= outers[bestOuter].second) {
+                                continue;
+                            }
+                            
+                            if (contains_doubled(outerEdges[i], outerBBs[i], testPoint)) {
+                                bestOuter = i;
+                            }
+                        }
+                        
+                        if (bestOuter < outers.size()) {
+                            result[bestOuter].second.push_back(hole.first);
+                        }
+                    }
+                    
+                    return true;
+                }
+                
+                PolyLine2d to_polyline(const fixed_ring &ring, const dmat4 &modelview) {
+                    PolyLine2d contour;
+                    for (const auto &v : ring) {
+                        contour.push_back(modelview * from_fixed(v));
+                    }
+                    return contour;
+                }
+                
+            }
+            
+#pragma mark - boost_geometry_clipper
+            
+            vector<polyline_with_holes> boost_geometry_clipper::difference(const PolyLine2d &outerContour, const vector<PolyLine2d> &holeContours,
+                                                                           const dpolygon2 &polygonToSubtract, const dmat4 &modelview) const {
+                dpolygon2 subject;
+                
+                for (auto &p : outerContour.getPoints()) {
+                    subject.outer().push_back(boost::geometry::make<dpoint2>(p.x, p.y));
+                }
+                
+                for (auto &holeContour : holeContours) {
+                    dpolygon2::ring_type ring;
+                    for (auto &p : holeContour.getPoints()) {
+                        ring.push_back(boost::geometry::make<dpoint2>(p.x, p.y));
+                    }
+                    subject.inners().push_back(ring);
+                }
+                
+                boost::geometry::correct(subject);
+                
+                std::vector<dpolygon2> output;
+                boost::geometry::difference(subject, polygonToSubtract, output);
+                
+                return dpolygon2_to_polyline_with_holes(output, modelview);
+            }
+            
+#pragma mark - fixed_point_clipper
+            
+            vector<polyline_with_holes> fixed_point_clipper::difference(const PolyLine2d &outerContour, const vector<PolyLine2d> &holeContours,
+                                                                        const dpolygon2 &polygonToSubtract, const dmat4 &modelview) const {
+                fixed_polygon subject, clip;
+                
+                if (!subject.add(to_fixed_ring(outerContour), true)) {
+                    return vector<polyline_with_holes>();
+                }
+                
+                for (const auto &hc : holeContours) {
+                    subject.add(to_fixed_ring(hc), false);
+                }
+                
+                if (!clip.add(to_fixed_ring(polygonToSubtract.outer()), true)) {
+                    CI_LOG_E("Polygon to subtract is degenerate at fixed-point precision");
+                    return vector<polyline_with_holes>();
+                }
+                
+                for (const auto &inner : polygonToSubtract.inners()) {
+                    clip.add(to_fixed_ring(inner), false);
+                }
+                
+                vector<pair<fixed_ring, vector<fixed_ring>>> output;
+                if (!fixed_difference(subject, clip, output)) {
+                    CI_LOG_E("Fixed-point difference failed to produce closed contours, falling back to boost::geometry");
+                    return get_clipper(BOOST_GEOMETRY_CLIPPING).difference(outerContour, holeContours, polygonToSubtract, modelview);
+                }
+                
+                vector<polyline_with_holes> result;
+                for (const auto &polygon : output) {
+                    vector<PolyLine2d> holes;
+                    for (const auto &hole : polygon.second) {
+                        holes.push_back(to_polyline(hole, modelview));
+                    }
+                    result.emplace_back(to_polyline(polygon.first, modelview), holes);
+                }
+                
+                return result;
+            }
+            
+            const clipper &get_clipper(ClippingEngine engine) {
+                static const boost_geometry_clipper boostGeometryClipper;
+                static const fixed_point_clipper fixedPointClipper;
+                
+                switch (engine) {
+                    case BOOST_GEOMETRY_CLIPPING:
+                        return boostGeometryClipper;
+                    case FIXED_POINT_CLIPPING:
+                        return fixedPointClipper;
+                }
+                
+                return fixedPointClipper;
+            }
+            
+        }
+    }
+} // end namespace elements::terrain::detail
@@ -0,0 +1,78 @@
+//
+//  TerrainDetail_Clipping.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/10/18.
+//
+
+#ifndef TerrainDetail_Clipping_hpp
+#define TerrainDetail_Clipping_hpp
+
+#include "elements/Terrain/TerrainDetail.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+#pragma mark - Clipping
+            
+            /**
+             clipper is the polygon boolean backend used by Shape::subtract. Implementations operate on a polygon
+             described by an outer contour and zero or more hole contours, and produce contours with holes directly.
+             */
+            class clipper {
+            public:
+                
+                virtual ~clipper() {
+                }
+                
+                virtual string get_name() const = 0;
+                
+                /**
+                 Subtract `polygonToSubtract from the polygon described by `outerContour and `holeContours. All inputs
+                 are expected to be in the same coordinate space; the output contours are transformed by `modelview.
+                 Returns an empty vector if nothing remains after the subtraction.
+                 */
+                virtual vector<polyline_with_holes> difference(const PolyLine2d &outerContour, const vector<PolyLine2d> &holeContours,
+                                                               const dpolygon2 &polygonToSubtract, const dmat4 &modelview) const = 0;
+            };
+            
+            /**
+             Clipper backed by boost::geometry::difference, converting to and from dpolygon2
+             */
+            class boost_geometry_clipper : public clipper {
+            public:
+                
+                string get_name() const override {
+                    return "boost_geometry";
+                }
+                
+                vector<polyline_with_holes> difference(const PolyLine2d &outerContour, const vector<PolyLine2d> &holeContours,
+                                                       const dpolygon2 &polygonToSubtract, const dmat4 &modelview) const override;
+            };
+            
+            /**
+             Clipper which snaps all vertices to a fixed-point grid of 1/POLY_EDGE_PRECISION (the same snapping used by
+             poly_edge) and performs the boolean operation with exact integer predicates. Since output vertices are
+             snapped, edges shared by neighboring shapes remain congruent after a cut. If the fixed-point pass can't
+             produce a consistent result it falls back to boost_geometry_clipper.
+             */
+            class fixed_point_clipper : public clipper {
+            public:
+                
+                string get_name() const override {
+                    return "fixed_point";
+                }
+                
+                vector<polyline_with_holes> difference(const PolyLine2d &outerContour, const vector<PolyLine2d> &holeContours,
+                                                       const dpolygon2 &polygonToSubtract, const dmat4 &modelview) const override;
+            };
+            
+            // get the shared clipper instance for a given engine
+            const clipper &get_clipper(ClippingEngine engine);
+            
+        }
+    }
+} // end namespace elements::terrain::detail
+
+#endif /* TerrainDetail_Clipping_hpp */
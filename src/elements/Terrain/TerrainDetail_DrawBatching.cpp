@@ -0,0 +1,155 @@
+//
+//  TerrainDetail_DrawBatching.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/16/18.
+//
+
+#include "elements/Terrain/TerrainDetail_DrawBatching.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+#pragma mark - counting_draw_batch_backend
+            
+            void counting_draw_batch_backend::allocate(size_t capacity) {
+                this->allocations++;
+                this->capacity = capacity;
+            }
+            
+            void counting_draw_batch_backend::write(size_t offset, const batch_vertex *vertices, size_t count) {
+                CI_ASSERT_MSG(offset + count <= capacity, "Write overflows allocated storage");
+                writes++;
+                verticesWritten += count;
+            }
+            
+            void counting_draw_batch_backend::draw(size_t offset, size_t count) {
+                CI_ASSERT_MSG(offset + count <= capacity, "Draw overflows allocated storage");
+                drawCalls++;
+                verticesDrawn += count;
+            }
+            
+#pragma mark - gl_draw_batch_backend
+            
+            /*
+             gl::VboRef _vbo;
+             gl::VaoRef _vao;
+             gl::GlslProgRef _shader;
+             */
+            
+            gl_draw_batch_backend::gl_draw_batch_backend() {
+                auto vsh = CI_GLSL(150,
+                                   uniform
+                                   mat4 ciModelViewProjection;
+                                   in
+                                   vec4 ciPosition;
+                                   in
+                                   vec4 ciColor;
+                                   out
+                                   vec4 Color;
+                                   
+                                   void main(void) {
+                                       Color = ciColor;
+                                       gl_Position = ciModelViewProjection * ciPosition;
+                                   }
+                                   );
+                
+                auto fsh = CI_GLSL(150,
+                                   in
+                                   vec4 Color;
+                                   out
+                                   vec4 oColor;
+                                   
+                                   void main(void) {
+                                       oColor = Color;
+                                   }
+                                   );
+                
+                _shader = gl::GlslProg::create(gl::GlslProg::Format().vertex(vsh).fragment(fsh));
+                _vbo = gl::Vbo::create(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+                _vao = gl::Vao::create();
+                
+                gl::ScopedVao scopedVao(_vao);
+                gl::ScopedBuffer scopedVbo(_vbo);
+                
+                const int positionLocation = _shader->getAttribSemanticLocation(geom::Attrib::POSITION);
+                gl::enableVertexAttribArray(positionLocation);
+                gl::vertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, sizeof(batch_vertex), (const GLvoid *) offsetof(batch_vertex, position));
+                
+                const int colorLocation = _shader->getAttribSemanticLocation(geom::Attrib::COLOR);
+                gl::enableVertexAttribArray(colorLocation);
+                gl::vertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(batch_vertex), (const GLvoid *) offsetof(batch_vertex, color));
+            }
+            
+            void gl_draw_batch_backend::allocate(size_t capacity) {
+                // passing nullptr orphans the previous storage, so we don't stall on draws still reading from it
+                _vbo->bufferData(capacity * sizeof(batch_vertex), nullptr, GL_STREAM_DRAW);
+            }
+            
+            void gl_draw_batch_backend::write(size_t offset, const batch_vertex *vertices, size_t count) {
+                _vbo->bufferSubData(offset * sizeof(batch_vertex), count * sizeof(batch_vertex), vertices);
+            }
+            
+            void gl_draw_batch_backend::draw(size_t offset, size_t count) {
+                gl::ScopedGlslProg scopedShader(_shader);
+                gl::ScopedVao scopedVao(_vao);
+                gl::setDefaultShaderVars();
+                gl::drawArrays(GL_TRIANGLES, static_cast<GLint>(offset), static_cast<GLsizei>(count));
+            }
+            
+#pragma mark - draw_batcher
+            
+            /*
+             vector<batch_vertex> _vertices;
+             size_t _capacity, _head;
+             draw_batch_backend *_allocatedBackend;
+             */
+            
+            draw_batcher::draw_batcher(size_t initialCapacity) :
+            _capacity(max<size_t>(initialCapacity, 1)),
+            _head(0),
+            _allocatedBackend(nullptr) {
+            }
+            
+            void draw_batcher::add(const TriMesh &trimesh, const dmat4 &modelMatrix, const ColorA &color) {
+                const vec2 *positions = trimesh.getPositions<2>();
+                const vector<uint32_t> &indices = trimesh.getIndices();
+                const vec4 c(color.r, color.g, color.b, color.a);
+                
+                _vertices.reserve(_vertices.size() + indices.size());
+                for (uint32_t index : indices) {
+                    const dvec2 p = modelMatrix * dvec2(positions[index]);
+                    _vertices.emplace_back(vec2(p), c);
+                }
+            }
+            
+            void draw_batcher::flush(draw_batch_backend &backend) {
+                const size_t count = _vertices.size();
+                if (count == 0) {
+                    return;
+                }
+                
+                if (count > _capacity) {
+                    while (_capacity < count) {
+                        _capacity *= 2;
+                    }
+                    _allocatedBackend = nullptr;
+                }
+                
+                if (_allocatedBackend != &backend || _head + count > _capacity) {
+                    backend.allocate(_capacity);
+                    _allocatedBackend = &backend;
+                    _head = 0;
+                }
+                
+                backend.write(_head, _vertices.data(), count);
+                backend.draw(_head, count);
+                
+                _head += count;
+                _vertices.clear();
+            }
+            
+        }
+    }
+} // end namespace elements::terrain::detail
@@ -0,0 +1,137 @@
+//
+//  TerrainDetail_DrawBatching.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/16/18.
+//
+
+#ifndef TerrainDetail_DrawBatching_hpp
+#define TerrainDetail_DrawBatching_hpp
+
+#include "core/Core.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+#pragma mark - Draw Batching
+            
+            /**
+             A vertex in a batched draw; position is in world space and color is baked in,
+             so a whole frame of terrain can be drawn with a single draw call.
+             */
+            struct batch_vertex {
+                vec2 position;
+                vec4 color;
+                
+                batch_vertex() {
+                }
+                
+                batch_vertex(vec2 p, vec4 c) :
+                position(p),
+                color(c) {
+                }
+            };
+            
+            /**
+             draw_batch_backend abstracts the ring buffer storage and draw calls used by draw_batcher,
+             so the batching logic can be exercised without a GL context.
+             */
+            class draw_batch_backend {
+            public:
+                
+                virtual ~draw_batch_backend() {
+                }
+                
+                // (re)allocate storage for `capacity vertices, orphaning any previous contents
+                virtual void allocate(size_t capacity) = 0;
+                
+                // write `count vertices to storage starting at vertex `offset
+                virtual void write(size_t offset, const batch_vertex *vertices, size_t count) = 0;
+                
+                // draw `count vertices starting at vertex `offset as a triangle list
+                virtual void draw(size_t offset, size_t count) = 0;
+            };
+            
+            /**
+             Backend which records what would have been sent to the GPU, for verifying draw_batcher on the CPU.
+             */
+            class counting_draw_batch_backend : public draw_batch_backend {
+            public:
+                
+                size_t allocations, capacity, writes, verticesWritten, drawCalls, verticesDrawn;
+                
+                counting_draw_batch_backend() {
+                    reset();
+                }
+                
+                void reset() {
+                    allocations = capacity = writes = verticesWritten = drawCalls = verticesDrawn = 0;
+                }
+                
+                void allocate(size_t capacity) override;
+                
+                void write(size_t offset, const batch_vertex *vertices, size_t count) override;
+                
+                void draw(size_t offset, size_t count) override;
+            };
+            
+            /**
+             Backend which streams vertices into a GL_STREAM_DRAW vbo and draws them with a shader using per-vertex color.
+             Must be created and used on the main thread with a GL context.
+             */
+            class gl_draw_batch_backend : public draw_batch_backend {
+            public:
+                
+                gl_draw_batch_backend();
+                
+                void allocate(size_t capacity) override;
+                
+                void write(size_t offset, const batch_vertex *vertices, size_t count) override;
+                
+                void draw(size_t offset, size_t count) override;
+            
+            private:
+                
+                gl::VboRef _vbo;
+                gl::VaoRef _vao;
+                gl::GlslProgRef _shader;
+            };
+            
+            /**
+             draw_batcher collects the triangles of many trimeshes, transformed to world space with their color baked in,
+             and submits them to a persistent ring buffer with one draw call per flush. When the next flush doesn't fit
+             in the space remaining, the buffer is orphaned and writing restarts at the front; when a flush doesn't
+             fit at all, the buffer grows.
+             */
+            class draw_batcher {
+            public:
+                
+                draw_batcher(size_t initialCapacity = 1 << 16);
+                
+                void add(const TriMesh &trimesh, const dmat4 &modelMatrix, const ColorA &color);
+                
+                // write everything added since the last flush to `backend and draw it
+                void flush(draw_batch_backend &backend);
+                
+                // number of vertices added since the last flush
+                size_t size() const {
+                    return _vertices.size();
+                }
+                
+                size_t capacity() const {
+                    return _capacity;
+                }
+            
+            private:
+                
+                vector<batch_vertex> _vertices;
+                size_t _capacity, _head;
+                draw_batch_backend *_allocatedBackend;
+            };
+            
+        }
+    }
+} // end namespace elements::terrain::detail
+
+#endif /* TerrainDetail_DrawBatching_hpp */
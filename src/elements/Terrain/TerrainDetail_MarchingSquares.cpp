@@ -0,0 +1,367 @@
+//
+//  TerrainDetail_MarchingSquares.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/17/18.
+//
+
+#include "elements/Terrain/TerrainDetail_MarchingSquares.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+            namespace {
+                
+                typedef PerimeterGenerator::Edge edge;
+                
+                const size_t NONE = numeric_limits<size_t>::max();
+                
+                /**
+                 Stable sort edges by first vertex, so that edges sharing a first vertex keep their submission order
+                 */
+                void sort_by_first_vertex(vector <edge> &edges) {
+                    ivec2Comparator compare;
+                    stable_sort(edges.begin(), edges.end(), [&compare](const edge &a, const edge &b) {
+                        return compare(a.first, b.first);
+                    });
+                }
+                
+                /**
+                 For edges sorted by first vertex, find the index of the edge which starts at `vertex, or NONE
+                 */
+                size_t find_edge_starting_at(const vector <edge> &edges, const ivec2 &vertex) {
+                    ivec2Comparator compare;
+                    auto pos = lower_bound(edges.begin(), edges.end(), vertex, [&compare](const edge &e, const ivec2 &v) {
+                        return compare(e.first, v);
+                    });
+                    
+                    return pos != edges.end() && pos->first == vertex ? static_cast<size_t>(pos - edges.begin()) : NONE;
+                }
+                
+                /**
+                 Collects the segments of one tile as fixed-point edges, in the same form PerimeterGenerator stores them
+                 */
+                struct tile_segment_buffer {
+                    vector <edge> edges;
+                    
+                    void operator()(int x, int y, const marching_squares::segment &seg) {
+                        edge e(PerimeterGenerator::scaleUp(seg.a), PerimeterGenerator::scaleUp(seg.b));
+                        if (e.first != e.second) {
+                            edges.push_back(e);
+                        }
+                    }
+                };
+                
+                /**
+                 The result of marching and chaining one tile. Loops lie entirely inside the tile and don't repeat their
+                 first vertex; runs enter and leave through the tile's seams, and hold every vertex from head to tail.
+                 Seam heads and tails are the first/second vertices of every edge lying on the tile's border, which are
+                 the only vertices which may be shared with another tile.
+                 */
+                struct marched_tile {
+                    vector <vector<ivec2>> loops, runs;
+                    vector <ivec2> seamHeads, seamTails;
+                    bool pinched;
+                    
+                    marched_tile() :
+                    pinched(false) {
+                    }
+                };
+                
+                void march_tile(const Channel8uVoxelStoreAdapter &adapter, double isoLevel, ivec2 firstCell, ivec2 lastCell, marched_tile &tile) {
+                    tile_segment_buffer buffer;
+                    marching_squares::march(adapter, buffer, firstCell, lastCell, isoLevel);
+                    
+                    vector <edge> &edges = buffer.edges;
+                    const size_t count = edges.size();
+                    
+                    // sort edges by first vertex; a repeated first vertex means the soup pinches
+                    sort_by_first_vertex(edges);
+                    for (size_t i = 1; i < count; i++) {
+                        if (edges[i].first == edges[i - 1].first) {
+                            tile.pinched = true;
+                            return;
+                        }
+                    }
+                    
+                    vector <size_t> next(count, NONE);
+                    vector <bool> hasPrevious(count, false);
+                    for (size_t i = 0; i < count; i++) {
+                        const size_t j = find_edge_starting_at(edges, edges[i].second);
+                        if (j != NONE) {
+                            if (hasPrevious[j]) {
+                                tile.pinched = true;
+                                return;
+                            }
+                            next[i] = j;
+                            hasPrevious[j] = true;
+                        }
+                    }
+                    
+                    vector <bool> visited(count, false);
+                    
+                    // runs start at edges with no predecessor in this tile, and end at an edge with no successor
+                    for (size_t i = 0; i < count; i++) {
+                        if (!hasPrevious[i]) {
+                            tile.runs.emplace_back();
+                            vector <ivec2> &run = tile.runs.back();
+                            size_t j = i;
+                            while (true) {
+                                visited[j] = true;
+                                run.push_back(edges[j].first);
+                                if (next[j] == NONE) {
+                                    run.push_back(edges[j].second);
+                                    break;
+                                }
+                                j = next[j];
+                            }
+                        }
+                    }
+                    
+                    // everything left over is a closed loop
+                    for (size_t i = 0; i < count; i++) {
+                        if (!visited[i]) {
+                            tile.loops.emplace_back();
+                            vector <ivec2> &loop = tile.loops.back();
+                            size_t j = i;
+                            do {
+                                visited[j] = true;
+                                loop.push_back(edges[j].first);
+                                j = next[j];
+                            } while (j != i);
+                        }
+                    }
+                    
+                    // record vertices on the tile's border so pinches across seams can be detected
+                    const ivec2 seamMin = PerimeterGenerator::scaleUp(dvec2(firstCell)),
+                    seamMax = PerimeterGenerator::scaleUp(dvec2(lastCell + ivec2(1)));
+                    
+                    auto onSeam = [&seamMin, &seamMax](const ivec2 &v) {
+                        return v.x == seamMin.x || v.x == seamMax.x || v.y == seamMin.y || v.y == seamMax.y;
+                    };
+                    
+                    for (const auto &e : edges) {
+                        if (onSeam(e.first)) {
+                            tile.seamHeads.push_back(e.first);
+                        }
+                        if (onSeam(e.second)) {
+                            tile.seamTails.push_back(e.second);
+                        }
+                    }
+                }
+                
+                bool has_duplicates(vector <ivec2> &vertices) {
+                    sort(vertices.begin(), vertices.end(), ivec2Comparator());
+                    return adjacent_find(vertices.begin(), vertices.end()) != vertices.end();
+                }
+                
+                // run fn(i) for i in [0,count) on `pool, in a few contiguous chunks per thread
+                template<class FN>
+                void parallel_for(core::util::ThreadPool &pool, size_t count, const FN &fn) {
+                    const size_t chunks = min(count, pool.getThreadCount() * 4);
+                    pool.parallelFor(chunks, [&](size_t chunk) {
+                        for (size_t j = chunk * count / chunks, end = (chunk + 1) * count / chunks; j < end; j++) {
+                            fn(j);
+                        }
+                    });
+                }
+                
+            }
+            
+            size_t PerimeterGenerator::generate(std::vector<PolyLine2d> &perimeters, dmat4 transform) {
+                perimeters.clear();
+                
+                //
+                //  Sort edges by first vertex. Where edges share a first vertex the last one submitted wins,
+                //  matching MapPerimeterGenerator, which overwrites its map entry.
+                //
+                
+                sort_by_first_vertex(_edges);
+                
+                size_t count = 0;
+                for (size_t i = 0; i < _edges.size(); i++) {
+                    if (i + 1 == _edges.size() || _edges[i + 1].first != _edges[i].first) {
+                        _edges[count++] = _edges[i];
+                    }
+                }
+                _edges.resize(count);
+                
+                vector <size_t> next(count);
+                for (size_t i = 0; i < count; i++) {
+                    next[i] = find_edge_starting_at(_edges, _edges[i].second);
+                }
+                
+                //
+                //  Walk perimeters, starting each at the least unvisited vertex. A perimeter ends when its next edge
+                //  is missing or already consumed, and is closed with the final edge's second vertex.
+                //
+                
+                vector <bool> visited(count, false);
+                for (size_t first = 0; first < count; first++) {
+                    if (visited[first]) {
+                        continue;
+                    }
+                    
+                    perimeters.push_back(PolyLine2d());
+                    PolyLine2d &perimeter = perimeters.back();
+                    
+                    size_t i = first;
+                    while (true) {
+                        visited[i] = true;
+                        perimeter.push_back(transform * scaleDown(_edges[i].first));
+                        
+                        if (next[i] == NONE || visited[next[i]]) {
+                            perimeter.push_back(transform * scaleDown(_edges[i].second));
+                            break;
+                        }
+                        
+                        i = next[i];
+                    }
+                }
+                
+                _edges.clear();
+                return perimeters.size();
+            }
+            
+            size_t march_serial(const Channel8u &store, double isoLevel, dmat4 transform, std::vector<PolyLine2d> &perimeters) {
+                Channel8uVoxelStoreAdapter adapter(store);
+                PerimeterGenerator pgen(PerimeterGenerator::CLOCKWISE);
+                marching_squares::march(adapter, pgen, isoLevel);
+                return pgen.generate(perimeters, transform);
+            }
+            
+            size_t march_tiled(const Channel8u &store, double isoLevel, dmat4 transform, std::vector<PolyLine2d> &perimeters, int tileSize, core::util::ThreadPool &pool) {
+                perimeters.clear();
+                
+                tileSize = max(tileSize, 1);
+                
+                //
+                //  March tiles in parallel. Cells run from min-1 to max so the border of the store is closed off.
+                //
+                
+                Channel8uVoxelStoreAdapter adapter(store);
+                const ivec2 firstCell = adapter.min() - ivec2(1), lastCell = adapter.max();
+                const int columns = (lastCell.x - firstCell.x + tileSize) / tileSize;
+                const int rows = (lastCell.y - firstCell.y + tileSize) / tileSize;
+                
+                vector <marched_tile> tiles(columns * rows);
+                parallel_for(pool, tiles.size(), [&](size_t i) {
+                    const ivec2 tileFirst = firstCell + ivec2(static_cast<int>(i) % columns, static_cast<int>(i) / columns) * tileSize;
+                    const ivec2 tileLast = min(tileFirst + ivec2(tileSize - 1), lastCell);
+                    march_tile(adapter, isoLevel, tileFirst, tileLast, tiles[i]);
+                });
+                
+                //
+                //  Check for pinches across seams - a vertex shared by two tiles lies on both their borders
+                //
+                
+                bool pinched = false;
+                vector <ivec2> seamHeads, seamTails;
+                for (const auto &tile : tiles) {
+                    pinched = pinched || tile.pinched;
+                    seamHeads.insert(seamHeads.end(), tile.seamHeads.begin(), tile.seamHeads.end());
+                    seamTails.insert(seamTails.end(), tile.seamTails.begin(), tile.seamTails.end());
+                }
+                
+                if (pinched || has_duplicates(seamHeads) || has_duplicates(seamTails)) {
+                    CI_LOG_D("Segment soup pinches, falling back to march_serial");
+                    return march_serial(store, isoLevel, transform, perimeters);
+                }
+                
+                //
+                //  Stitch runs into loops across tile seams. A run's tail is the head of the run which continues it.
+                //
+                
+                vector <vector<ivec2>> loops;
+                vector <const vector<ivec2>*> runs;
+                for (auto &tile : tiles) {
+                    for (auto &loop : tile.loops) {
+                        loops.push_back(std::move(loop));
+                    }
+                    for (const auto &run : tile.runs) {
+                        runs.push_back(&run);
+                    }
+                }
+                
+                // link runs the same way edges are linked, treating each as an edge from its head to its tail
+                ivec2Comparator compare;
+                sort(runs.begin(), runs.end(), [&compare](const vector <ivec2> *a, const vector <ivec2> *b) {
+                    return compare(a->front(), b->front());
+                });
+                
+                vector <edge> runEdges;
+                runEdges.reserve(runs.size());
+                for (const auto run : runs) {
+                    runEdges.emplace_back(run->front(), run->back());
+                }
+                
+                vector <bool> stitched(runs.size(), false);
+                for (size_t i = 0; i < runs.size() && !pinched; i++) {
+                    if (stitched[i]) {
+                        continue;
+                    }
+                    
+                    vector <ivec2> loop;
+                    size_t j = i;
+                    do {
+                        stitched[j] = true;
+                        
+                        // the tail is the next run's head, so leave it off
+                        const vector <ivec2> &run = *runs[j];
+                        loop.insert(loop.end(), run.begin(), run.end() - 1);
+                        
+                        j = find_edge_starting_at(runEdges, run.back());
+                        if (j == NONE || (stitched[j] && j != i)) {
+                            // an open perimeter; only a malformed soup gets here, but march_serial knows what to do with it
+                            pinched = true;
+                            break;
+                        }
+                    } while (j != i);
+                    
+                    loops.push_back(std::move(loop));
+                }
+                
+                if (pinched) {
+                    CI_LOG_D("Segment soup has open perimeters, falling back to march_serial");
+                    return march_serial(store, isoLevel, transform, perimeters);
+                }
+                
+                //
+                //  PerimeterGenerator always starts a perimeter at the least remaining vertex, so each perimeter starts
+                //  at its own least vertex, is closed by repeating it, and perimeters come out sorted by it.
+                //
+                
+                vector <size_t> leastVertexIndices(loops.size());
+                parallel_for(pool, loops.size(), [&](size_t i) {
+                    const auto &loop = loops[i];
+                    leastVertexIndices[i] = min_element(loop.begin(), loop.end(), ivec2Comparator()) - loop.begin();
+                });
+                
+                vector <size_t> order(loops.size());
+                for (size_t i = 0; i < order.size(); i++) {
+                    order[i] = i;
+                }
+                
+                sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                    return compare(loops[a][leastVertexIndices[a]], loops[b][leastVertexIndices[b]]);
+                });
+                
+                perimeters.resize(loops.size());
+                parallel_for(pool, loops.size(), [&](size_t i) {
+                    const auto &loop = loops[order[i]];
+                    const size_t first = leastVertexIndices[order[i]], count = loop.size();
+                    
+                    PolyLine2d &perimeter = perimeters[i];
+                    perimeter.getPoints().reserve(count + 1);
+                    for (size_t j = 0; j <= count; j++) {
+                        perimeter.push_back(transform * PerimeterGenerator::scaleDown(loop[(first + j) % count]));
+                    }
+                });
+                
+                return perimeters.size();
+            }
+            
+        }
+    }
+} // end namespace elements::terrain::detail
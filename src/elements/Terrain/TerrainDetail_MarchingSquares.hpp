@@ -11,6 +11,7 @@
 #include "core/Core.hpp"
 
 #include "core/util/ContourSimplification.hpp"
+#include "core/util/ThreadPool.hpp"
 #include "elements/Terrain/MarchingSquares.hpp"
 
 namespace elements {
@@ -58,6 +59,8 @@ namespace elements {
             
             /**
              PerimeterGenerator implements marching_cubes::march segment callback - stitching a soup of short segments into line loops.
+             Segments are collected into a flat edge array which generate() sorts by first vertex and links, so stitching makes
+             no per-segment allocations.
              NOTE: PG requires that the line segment soup be sane:
              1) Closed non-intersecting loops
              2) Edges have consistent windings. E.g., output from marching squares guarantees that each loop has one winding
@@ -70,23 +73,70 @@ namespace elements {
                     COUNTER_CLOCKWISE
                 };
                 
+                typedef std::pair<ivec2, ivec2> Edge;
+                
             private:
                 
-                typedef std::pair<ivec2, ivec2> Edge;
+                std::vector<Edge> _edges;
+                winding _winding;
+                
+            public:
+                
+                PerimeterGenerator(winding w, size_t expectedSegmentCount = 0) :
+                _winding(w) {
+                    _edges.reserve(expectedSegmentCount);
+                }
+                
+                void operator()(int x, int y, const marching_squares::segment &seg) {
+                    Edge e = _winding == CLOCKWISE ? Edge(scaleUp(seg.a), scaleUp(seg.b)) : Edge(scaleUp(seg.b), scaleUp(seg.a));
+                    if (e.first != e.second) {
+                        _edges.push_back(e);
+                    }
+                }
+                
+                /*
+                 Populate a vector of PolyLine2d with every perimeter computed for the isosurface
+                 Exterior perimeters will be in the current winding direction, interior perimeters
+                 will be in the opposite winding. Each perimeter starts at, and is closed by, the least
+                 vertex not consumed by an earlier perimeter.
+                 */
+                
+                size_t generate(std::vector<PolyLine2d> &perimeters, dmat4 transform);
+                
+                // segment vertices are snapped to a fixed-point grid of 1/V_SCALE so shared endpoints compare exactly
+                static constexpr double V_SCALE = 1024;
+                
+                static ivec2 scaleUp(const dvec2 &v) {
+                    return ivec2(lrint(V_SCALE * v.x), lrint(V_SCALE * v.y));
+                }
+                
+                static dvec2 scaleDown(const ivec2 &v) {
+                    return dvec2(static_cast<double>(v.x) / V_SCALE, static_cast<double>(v.y) / V_SCALE);
+                }
+            };
+            
+            /**
+             The original PerimeterGenerator, which keys a std::map by each edge's first vertex. Kept as a reference
+             to verify and benchmark PerimeterGenerator against.
+             */
+            struct MapPerimeterGenerator {
+            private:
+                
+                typedef PerimeterGenerator::Edge Edge;
                 
                 std::map<ivec2, Edge, ivec2Comparator> _edgesByFirstVertex;
-                winding _winding;
+                PerimeterGenerator::winding _winding;
                 
             public:
                 
-                PerimeterGenerator(winding w) :
+                MapPerimeterGenerator(PerimeterGenerator::winding w) :
                 _winding(w) {
                 }
                 
                 void operator()(int x, int y, const marching_squares::segment &seg) {
                     switch (_winding) {
-                        case CLOCKWISE: {
-                            Edge e(scaleUp(seg.a), scaleUp(seg.b));
+                        case PerimeterGenerator::CLOCKWISE: {
+                            Edge e(PerimeterGenerator::scaleUp(seg.a), PerimeterGenerator::scaleUp(seg.b));
                             
                             if (e.first != e.second) {
                                 _edgesByFirstVertex[e.first] = e;
@@ -94,9 +144,9 @@ namespace elements {
                             break;
                         }
                             
-                        case COUNTER_CLOCKWISE: {
-                            Edge e(scaleUp(seg.b),
-                                   scaleUp(seg.a));
+                        case PerimeterGenerator::COUNTER_CLOCKWISE: {
+                            Edge e(PerimeterGenerator::scaleUp(seg.b),
+                                   PerimeterGenerator::scaleUp(seg.a));
                             
                             if (e.first != e.second) {
                                 _edgesByFirstVertex[e.first] = e;
@@ -106,12 +156,6 @@ namespace elements {
                     }
                 }
                 
-                /*
-                 Populate a vector of PolyLine2d with every perimeter computed for the isosurface
-                 Exterior perimeters will be in the current winding direction, interior perimeters
-                 will be in the opposite winding.
-                 */
-                
                 size_t generate(std::vector<PolyLine2d> &perimeters, dmat4 transform) {
                     perimeters.clear();
                     
@@ -125,8 +169,8 @@ namespace elements {
                         perimeters.push_back(PolyLine2d());
                         
                         do {
-                            const Edge &e = it->second;
-                            perimeters.back().push_back(transform * scaleDown(e.first));
+                            const Edge e = it->second;
+                            perimeters.back().push_back(transform * PerimeterGenerator::scaleDown(e.first));
                             _edgesByFirstVertex.erase(it);
                             
                             it = _edgesByFirstVertex.find(e.second);
@@ -134,7 +178,7 @@ namespace elements {
                             
                             // final segment of loop - close it
                             if (it == end) {
-                                perimeters.back().push_back(transform * scaleDown(e.second));
+                                perimeters.back().push_back(transform * PerimeterGenerator::scaleDown(e.second));
                             }
                             
                         } while (it != begin && it != end && count > 0);
@@ -142,28 +186,28 @@ namespace elements {
                     
                     return perimeters.size();
                 }
-                
-            private:
-                
-                const double V_SCALE = 1024;
-                
-                ivec2 scaleUp(const dvec2 &v) const {
-                    return ivec2(lrint(V_SCALE * v.x), lrint(V_SCALE * v.y));
-                }
-                
-                dvec2 scaleDown(const ivec2 &v) const {
-                    return dvec2(static_cast<double>(v.x) / V_SCALE, static_cast<double>(v.y) / V_SCALE);
-                }
             };
             
+            /**
+             March the whole isosurface on the calling thread, stitching perimeters with PerimeterGenerator (clockwise winding).
+             This is the reference implementation for march_tiled.
+             */
+            size_t march_serial(const Channel8u &store, double isoLevel, dmat4 transform, std::vector<PolyLine2d> &perimeters);
+            
+            /**
+             March the isosurface in square tiles of `tileSize cells, in parallel on `pool.
+             Each tile's segments are chained locally into closed loops and open runs which end on the tile's seams, then the runs
+             are stitched together across seams. Produces output identical to march_serial - each perimeter starts at (and is closed
+             by) its least vertex, and perimeters are ordered by that vertex. If the segment soup pinches (two segments starting or
+             ending at the same vertex, which can only happen when interpolation snaps to a voxel) we fall back to march_serial.
+             */
+            size_t march_tiled(const Channel8u &store, double isoLevel, dmat4 transform, std::vector<PolyLine2d> &perimeters,
+                               int tileSize = 256, core::util::ThreadPool &pool = core::util::ThreadPool::shared());
+            
             inline bool march(const Channel8u &store, double isoLevel, dmat4 transform, double simplificationThreshold, std::vector<PolyLine2d> &resultPerimeters) {
-                Channel8uVoxelStoreAdapter adapter(store);
-                PerimeterGenerator pgen(PerimeterGenerator::CLOCKWISE);
-                marching_squares::march(adapter, pgen, isoLevel);
-                
                 if (simplificationThreshold > 0) {
                     std::vector<PolyLine2d> perimeters;
-                    if (pgen.generate(perimeters, transform)) {
+                    if (march_tiled(store, isoLevel, transform, perimeters)) {
                         for (auto &perimeter : perimeters) {
                             perimeter.setClosed(true);
                             if (perimeter.size() > 0) {
@@ -172,7 +216,7 @@ namespace elements {
                         }
                     }
                 } else {
-                    pgen.generate(resultPerimeters, transform);
+                    march_tiled(store, isoLevel, transform, resultPerimeters);
                 }
                 
                 //
@@ -0,0 +1,1158 @@
+//
+//  TerrainDetail_Triangulation.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/24/18.
+//
+
+#include "elements/Terrain/TerrainDetail_Triangulation.hpp"
+
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <cinder/Triangulate.h>
+
+#include "elements/Terrain/TerrainDetail.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+            namespace {
+                
+                std::atomic<int> _triangulationEngine(TRIANGULATION_EAR_CLIPPING);
+                
+                // ear clipping results whose area differs from the polygon's by more than this fraction are retriangulated with libtess
+                const double MaxAreaDeviation = 1e-6;
+                
+            }
+            
+            namespace ear_clipping {
+                
+                //
+                //  Ear clipping after the approach of mapbox's earcut: holes are bridged into the outer contour in order of their
+                //  leftmost vertex, then ears are clipped from the resulting single loop. For large polygons the candidates for
+                //  each ear test are found via a z-order curve index rather than walking the whole loop. Where no ears can be found,
+                //  as with degenerate or self intersecting input, collinear points are filtered, local self intersections cured,
+                //  and as a last resort the polygon split along a valid diagonal and each half clipped.
+                //
+                
+                struct node {
+                    
+                    // index of the source vertex
+                    uint32_t i;
+                    double x, y;
+                    
+                    // z-order curve value, 0 until indexed
+                    int32_t z;
+                    
+                    // the polygon loop, and the loop sorted by z-order
+                    node *prev, *next;
+                    node *prevZ, *nextZ;
+                    
+                    // the single vertex of a degenerate hole; never filtered out
+                    bool steiner;
+                };
+                
+                /**
+                 Hands out nodes from blocks which are kept between triangulations, so triangulating doesn't allocate once warmed up
+                 */
+                class node_arena {
+                public:
+                    
+                    node_arena() :
+                    _used(0) {
+                    }
+                    
+                    node *make(uint32_t i, double x, double y) {
+                        const size_t block = _used / BlockSize;
+                        if (block == _blocks.size()) {
+                            _blocks.emplace_back(new node[BlockSize]);
+                        }
+                        
+                        node *n = &_blocks[block][_used % BlockSize];
+                        _used++;
+                        
+                        *n = { i, x, y, 0, nullptr, nullptr, nullptr, nullptr, false };
+                        return n;
+                    }
+                    
+                    void reset() {
+                        _used = 0;
+                    }
+                
+                private:
+                    
+                    static const size_t BlockSize = 4096;
+                    
+                    vector<unique_ptr<node[]>> _blocks;
+                    size_t _used;
+                };
+                
+                struct scratch {
+                    node_arena nodes;
+                    vector<node*> holes;
+                };
+                
+                scratch &get_scratch() {
+                    thread_local scratch s;
+                    return s;
+                }
+                
+                /**
+                 Clips ears from a polygon loop, writing source vertex indices of each triangle to `indices
+                 */
+                class clipper {
+                public:
+                    
+                    clipper(node_arena &nodes, vector<uint32_t> &indices) :
+                    _nodes(nodes),
+                    _indices(indices),
+                    _minX(0),
+                    _minY(0),
+                    _invSize(0) {
+                    }
+                    
+                    // z-order index loops built from more than this many vertices
+                    static const size_t IndexThreshold = 80;
+                    
+                    void setIndexBounds(double minX, double minY, double maxX, double maxY) {
+                        const double size = max(maxX - minX, maxY - minY);
+                        _minX = minX;
+                        _minY = minY;
+                        _invSize = size > 0 ? 32767 / size : 0;
+                    }
+                    
+                    /**
+                     Create a loop of the points [first, first + count), wound as an outer loop if `outer and the opposite way,
+                     as a hole, otherwise. Returns the last node of the loop, or null if count is 0.
+                     */
+                    node *makeLoop(const dvec2 *points, uint32_t first, uint32_t count, bool outer) {
+                        node *last = nullptr;
+                        if (outer == (signedArea(points + first, count) > 0)) {
+                            for (uint32_t i = first; i < first + count; i++) {
+                                last = insert(i, points[i], last);
+                            }
+                        } else {
+                            for (uint32_t i = first + count; i-- > first;) {
+                                last = insert(i, points[i], last);
+                            }
+                        }
+                        
+                        if (last && equals(last, last->next)) {
+                            remove(last);
+                            last = last->next;
+                        }
+                        
+                        return last;
+                    }
+                    
+                    /**
+                     Bridge each hole in `holes (each a node of a hole loop) into the loop `outer, returning a node of the merged loop.
+                     */
+                    node *eliminateHoles(node *outer, vector<node*> &holes) {
+                        for (auto &hole : holes) {
+                            if (hole == hole->next) {
+                                hole->steiner = true;
+                            }
+                            hole = leftmost(hole);
+                        }
+                        
+                        sort(holes.begin(), holes.end(), [](const node *a, const node *b) {
+                            return a->x < b->x;
+                        });
+                        
+                        for (node *hole : holes) {
+                            outer = eliminateHole(hole, outer);
+                        }
+                        
+                        return outer;
+                    }
+                    
+                    void clip(node *ear, int pass) {
+                        if (!ear) {
+                            return;
+                        }
+                        
+                        if (pass == 0 && _invSize > 0) {
+                            indexCurve(ear);
+                        }
+                        
+                        node *stop = ear;
+                        while (ear->prev != ear->next) {
+                            node *prev = ear->prev;
+                            node *next = ear->next;
+                            
+                            if (_invSize > 0 ? isEarHashed(ear) : isEar(ear)) {
+                                emit(prev, ear, next);
+                                remove(ear);
+                                
+                                // skipping the next vertex leads to fewer sliver triangles
+                                ear = next->next;
+                                stop = next->next;
+                                continue;
+                            }
+                            
+                            ear = next;
+                            
+                            // went all the way around without finding an ear
+                            if (ear == stop) {
+                                if (pass == 0) {
+                                    clip(filter(ear, nullptr), 1);
+                                } else if (pass == 1) {
+                                    clip(cureLocalIntersections(filter(ear, nullptr)), 2);
+                                } else {
+                                    split(ear);
+                                }
+                                break;
+                            }
+                        }
+                    }
+                    
+                    // remove duplicate and collinear points between `start and `end
+                    node *filter(node *start, node *end) {
+                        if (!start) {
+                            return start;
+                        }
+                        if (!end) {
+                            end = start;
+                        }
+                        
+                        node *p = start;
+                        bool again;
+                        do {
+                            again = false;
+                            
+                            if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0)) {
+                                remove(p);
+                                p = end = p->prev;
+                                if (p == p->next) {
+                                    break;
+                                }
+                                again = true;
+                            } else {
+                                p = p->next;
+                            }
+                        } while (again || p != end);
+                        
+                        return end;
+                    }
+                
+                private:
+                    
+                    static double signedArea(const dvec2 *points, uint32_t count) {
+                        double sum = 0;
+                        for (uint32_t i = 0, j = count - 1; i < count; j = i++) {
+                            sum += (points[j].x - points[i].x) * (points[i].y + points[j].y);
+                        }
+                        return sum;
+                    }
+                    
+                    // twice the signed area of the triangle pqr; negative when wound as outer loops are, so positive means reflex
+                    static double area(const node *p, const node *q, const node *r) {
+                        return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+                    }
+                    
+                    static bool equals(const node *a, const node *b) {
+                        return a->x == b->x && a->y == b->y;
+                    }
+                    
+                    static bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py) {
+                        return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+                        (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+                        (bx - px) * (cy - py) >= (cx - px) * (by - py);
+                    }
+                    
+                    static int sign(double v) {
+                        return (v > 0) - (v < 0);
+                    }
+                    
+                    // for collinear p, q, r: does q lie on segment pr
+                    static bool onSegment(const node *p, const node *q, const node *r) {
+                        return q->x <= max(p->x, r->x) && q->x >= min(p->x, r->x) && q->y <= max(p->y, r->y) && q->y >= min(p->y, r->y);
+                    }
+                    
+                    static bool intersects(const node *p1, const node *q1, const node *p2, const node *q2) {
+                        const int o1 = sign(area(p1, q1, p2));
+                        const int o2 = sign(area(p1, q1, q2));
+                        const int o3 = sign(area(p2, q2, p1));
+                        const int o4 = sign(area(p2, q2, q1));
+                        
+                        if (o1 != o2 && o3 != o4) {
+                            return true;
+                        }
+                        
+                        return (o1 == 0 && onSegment(p1, p2, q1)) ||
+                        (o2 == 0 && onSegment(p1, q2, q1)) ||
+                        (o3 == 0 && onSegment(p2, p1, q2)) ||
+                        (o4 == 0 && onSegment(p2, q1, q2));
+                    }
+                    
+                    // does the diagonal ab intersect any edge of the polygon
+                    static bool intersectsPolygon(const node *a, const node *b) {
+                        const node *p = a;
+                        do {
+                            if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i && intersects(p, p->next, a, b)) {
+                                return true;
+                            }
+                            p = p->next;
+                        } while (p != a);
+                        
+                        return false;
+                    }
+                    
+                    // is the diagonal ab locally inside the polygon at a
+                    static bool locallyInside(const node *a, const node *b) {
+                        return area(a->prev, a, a->next) < 0 ?
+                        area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0 :
+                        area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+                    }
+                    
+                    // is the midpoint of the diagonal ab inside the polygon
+                    static bool middleInside(const node *a, const node *b) {
+                        const node *p = a;
+                        const double px = (a->x + b->x) / 2;
+                        const double py = (a->y + b->y) / 2;
+                        bool inside = false;
+                        do {
+                            if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y && (px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x)) {
+                                inside = !inside;
+                            }
+                            p = p->next;
+                        } while (p != a);
+                        
+                        return inside;
+                    }
+                    
+                    static bool sectorContainsSector(const node *m, const node *p) {
+                        return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0;
+                    }
+                    
+                    static bool isValidDiagonal(const node *a, const node *b) {
+                        return a->next->i != b->i && a->prev->i != b->i && !intersectsPolygon(a, b) &&
+                        ((locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) && (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0)) ||
+                         (equals(a, b) && area(a->prev, a, a->next) > 0 && area(b->prev, b, b->next) > 0));
+                    }
+                    
+                    static node *leftmost(node *start) {
+                        node *p = start, *left = start;
+                        do {
+                            if (p->x < left->x || (p->x == left->x && p->y < left->y)) {
+                                left = p;
+                            }
+                            p = p->next;
+                        } while (p != start);
+                        
+                        return left;
+                    }
+                    
+                    node *insert(uint32_t i, dvec2 p, node *last) {
+                        node *n = _nodes.make(i, p.x, p.y);
+                        if (!last) {
+                            n->prev = n;
+                            n->next = n;
+                        } else {
+                            n->next = last->next;
+                            n->prev = last;
+                            last->next->prev = n;
+                            last->next = n;
+                        }
+                        return n;
+                    }
+                    
+                    static void remove(node *p) {
+                        p->next->prev = p->prev;
+                        p->prev->next = p->next;
+                        
+                        if (p->prevZ) {
+                            p->prevZ->nextZ = p->nextZ;
+                        }
+                        if (p->nextZ) {
+                            p->nextZ->prevZ = p->prevZ;
+                        }
+                    }
+                    
+                    void emit(const node *a, const node *b, const node *c) {
+                        _indices.push_back(a->i);
+                        _indices.push_back(b->i);
+                        _indices.push_back(c->i);
+                    }
+                    
+                    /**
+                     Link a and b with a bridge, splitting the loop in two (or joining two loops in one, when bridging a hole).
+                     Returns the duplicate of b which starts the second loop.
+                     */
+                    node *splitPolygon(node *a, node *b) {
+                        node *a2 = _nodes.make(a->i, a->x, a->y);
+                        node *b2 = _nodes.make(b->i, b->x, b->y);
+                        node *an = a->next;
+                        node *bp = b->prev;
+                        
+                        a->next = b;
+                        b->prev = a;
+                        
+                        a2->next = an;
+                        an->prev = a2;
+                        
+                        b2->next = a2;
+                        a2->prev = b2;
+                        
+                        bp->next = b2;
+                        b2->prev = bp;
+                        
+                        return b2;
+                    }
+                    
+                    node *eliminateHole(node *hole, node *outer) {
+                        node *bridge = findHoleBridge(hole, outer);
+                        if (!bridge) {
+                            return outer;
+                        }
+                        
+                        node *bridgeReverse = splitPolygon(bridge, hole);
+                        
+                        // filter collinear points around the cuts; since that may remove `outer, return a node known to remain
+                        filter(bridgeReverse, bridgeReverse->next);
+                        return filter(bridge, bridge->next);
+                    }
+                    
+                    // find a vertex of the outer loop which can be connected to the leftmost vertex of a hole without crossing an edge
+                    node *findHoleBridge(node *hole, node *outer) {
+                        node *p = outer;
+                        const double hx = hole->x;
+                        const double hy = hole->y;
+                        double qx = -numeric_limits<double>::infinity();
+                        node *m = nullptr;
+                        
+                        // find the segment of the outer loop left of the hole point and closest to it on a horizontal ray;
+                        // its endpoint with the lower x is a bridge candidate
+                        do {
+                            if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+                                const double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+                                if (x <= hx && x > qx) {
+                                    qx = x;
+                                    m = p->x < p->next->x ? p : p->next;
+                                    if (x == hx) {
+                                        // the hole touches the outer segment
+                                        return m;
+                                    }
+                                }
+                            }
+                            p = p->next;
+                        } while (p != outer);
+                        
+                        if (!m) {
+                            return nullptr;
+                        }
+                        
+                        // look for vertices inside the triangle of the hole point, the ray intersection and the candidate; if
+                        // there are any, bridge to the one making the smallest angle with the ray instead
+                        const node *stop = m;
+                        const double mx = m->x;
+                        const double my = m->y;
+                        double tanMin = numeric_limits<double>::infinity();
+                        
+                        p = m;
+                        do {
+                            if (hx >= p->x && p->x >= mx && hx != p->x &&
+                                pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y)) {
+                                
+                                const double tan = abs(hy - p->y) / (hx - p->x);
+                                if (locallyInside(p, hole) && (tan < tanMin || (tan == tanMin && (p->x > m->x || (p->x == m->x && sectorContainsSector(m, p)))))) {
+                                    m = p;
+                                    tanMin = tan;
+                                }
+                            }
+                            p = p->next;
+                        } while (p != stop);
+                        
+                        return m;
+                    }
+                    
+                    bool isEar(const node *ear) const {
+                        const node *a = ear->prev, *b = ear, *c = ear->next;
+                        
+                        // reflex, can't be an ear
+                        if (area(a, b, c) >= 0) {
+                            return false;
+                        }
+                        
+                        const double x0 = min(a->x, min(b->x, c->x)), x1 = max(a->x, max(b->x, c->x));
+                        const double y0 = min(a->y, min(b->y, c->y)), y1 = max(a->y, max(b->y, c->y));
+                        
+                        // no other vertex of the loop may lie in the ear
+                        for (const node *p = c->next; p != a; p = p->next) {
+                            if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+                                pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0) {
+                                return false;
+                            }
+                        }
+                        
+                        return true;
+                    }
+                    
+                    bool isEarHashed(const node *ear) const {
+                        const node *a = ear->prev, *b = ear, *c = ear->next;
+                        
+                        if (area(a, b, c) >= 0) {
+                            return false;
+                        }
+                        
+                        const double x0 = min(a->x, min(b->x, c->x)), x1 = max(a->x, max(b->x, c->x));
+                        const double y0 = min(a->y, min(b->y, c->y)), y1 = max(a->y, max(b->y, c->y));
+                        
+                        // only vertices with z-order values in the range of the ear's bounds can lie in it
+                        const int32_t minZ = zOrder(x0, y0);
+                        const int32_t maxZ = zOrder(x1, y1);
+                        
+                        auto inEar = [=](const node *p) {
+                            return p != a && p != c && p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+                            pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0;
+                        };
+                        
+                        // look both ways along the z-order from the ear
+                        const node *p = ear->prevZ;
+                        const node *n = ear->nextZ;
+                        while (p && p->z >= minZ && n && n->z <= maxZ) {
+                            if (inEar(p) || inEar(n)) {
+                                return false;
+                            }
+                            p = p->prevZ;
+                            n = n->nextZ;
+                        }
+                        
+                        for (; p && p->z >= minZ; p = p->prevZ) {
+                            if (inEar(p)) {
+                                return false;
+                            }
+                        }
+                        
+                        for (; n && n->z <= maxZ; n = n->nextZ) {
+                            if (inEar(n)) {
+                                return false;
+                            }
+                        }
+                        
+                        return true;
+                    }
+                    
+                    // go through the loop and fix small local self intersections
+                    node *cureLocalIntersections(node *start) {
+                        node *p = start;
+                        do {
+                            node *a = p->prev;
+                            node *b = p->next->next;
+                            
+                            if (!equals(a, b) && intersects(a, p, p->next, b) && locallyInside(a, b) && locallyInside(b, a)) {
+                                emit(a, p, b);
+                                
+                                // remove the two nodes involved
+                                remove(p);
+                                remove(p->next);
+                                
+                                p = start = b;
+                            }
+                            p = p->next;
+                        } while (p != start);
+                        
+                        return filter(p, nullptr);
+                    }
+                    
+                    // try splitting the loop into two along a valid diagonal, and clip each
+                    void split(node *start) {
+                        node *a = start;
+                        do {
+                            for (node *b = a->next->next; b != a->prev; b = b->next) {
+                                if (a->i != b->i && isValidDiagonal(a, b)) {
+                                    node *c = splitPolygon(a, b);
+                                    
+                                    a = filter(a, a->next);
+                                    c = filter(c, c->next);
+                                    
+                                    clip(a, 0);
+                                    clip(c, 0);
+                                    return;
+                                }
+                            }
+                            a = a->next;
+                        } while (a != start);
+                    }
+                    
+                    // z-order of a point, from its coordinates scaled to 15 bits and interleaved
+                    int32_t zOrder(double px, double py) const {
+                        uint32_t x = static_cast<uint32_t>((px - _minX) * _invSize);
+                        uint32_t y = static_cast<uint32_t>((py - _minY) * _invSize);
+                        
+                        x = (x | (x << 8)) & 0x00FF00FF;
+                        x = (x | (x << 4)) & 0x0F0F0F0F;
+                        x = (x | (x << 2)) & 0x33333333;
+                        x = (x | (x << 1)) & 0x55555555;
+                        
+                        y = (y | (y << 8)) & 0x00FF00FF;
+                        y = (y | (y << 4)) & 0x0F0F0F0F;
+                        y = (y | (y << 2)) & 0x33333333;
+                        y = (y | (y << 1)) & 0x55555555;
+                        
+                        return static_cast<int32_t>(x | (y << 1));
+                    }
+                    
+                    // compute the z-order of each node of the loop and link them in that order
+                    void indexCurve(node *start) {
+                        node *p = start;
+                        do {
+                            if (p->z == 0) {
+                                p->z = zOrder(p->x, p->y);
+                            }
+                            p->prevZ = p->prev;
+                            p->nextZ = p->next;
+                            p = p->next;
+                        } while (p != start);
+                        
+                        p->prevZ->nextZ = nullptr;
+                        p->prevZ = nullptr;
+                        
+                        sortLinked(p);
+                    }
+                    
+                    // bottom up merge sort of the z linked list, after Simon Tatham's
+                    static node *sortLinked(node *list) {
+                        size_t inSize = 1;
+                        size_t numMerges;
+                        
+                        do {
+                            node *p = list;
+                            node *tail = nullptr;
+                            list = nullptr;
+                            numMerges = 0;
+                            
+                            while (p) {
+                                numMerges++;
+                                node *q = p;
+                                size_t pSize = 0;
+                                for (size_t i = 0; i < inSize && q; i++) {
+                                    pSize++;
+                                    q = q->nextZ;
+                                }
+                                size_t qSize = inSize;
+                                
+                                while (pSize > 0 || (qSize > 0 && q)) {
+                                    node *e;
+                                    if (pSize != 0 && (qSize == 0 || !q || p->z <= q->z)) {
+                                        e = p;
+                                        p = p->nextZ;
+                                        pSize--;
+                                    } else {
+                                        e = q;
+                                        q = q->nextZ;
+                                        qSize--;
+                                    }
+                                    
+                                    if (tail) {
+                                        tail->nextZ = e;
+                                    } else {
+                                        list = e;
+                                    }
+                                    
+                                    e->prevZ = tail;
+                                    tail = e;
+                                }
+                                
+                                p = q;
+                            }
+                            
+                            tail->nextZ = nullptr;
+                            inSize *= 2;
+                        } while (numMerges > 1);
+                        
+                        return list;
+                    }
+                    
+                    node_arena &_nodes;
+                    vector<uint32_t> &_indices;
+                    double _minX, _minY, _invSize;
+                };
+                
+                // twice the area of the polygon, less its holes, and of the triangles; for verifying a triangulation
+                double polygon_area(const dvec2 *points, uint32_t count) {
+                    double sum = 0;
+                    for (uint32_t i = 0, j = count - 1; i < count; j = i++) {
+                        sum += (points[j].x - points[i].x) * (points[i].y + points[j].y);
+                    }
+                    return abs(sum);
+                }
+                
+                double triangles_area(const vector<dvec2> &points, const vector<uint32_t> &indices) {
+                    double sum = 0;
+                    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                        const dvec2 a = points[indices[i]], b = points[indices[i + 1]], c = points[indices[i + 2]];
+                        sum += abs((a.x - c.x) * (b.y - a.y) - (a.x - b.x) * (c.y - a.y));
+                    }
+                    return sum;
+                }
+                
+                /**
+                 Triangulate the polygon made of the loop points [0, loopStarts[1]) with the holes made of each subsequent range,
+                 returning false if the triangles don't cover the polygon's area.
+                 */
+                bool triangulate(const vector<dvec2> &points, const vector<uint32_t> &loopStarts, vector<uint32_t> &indices) {
+                    scratch &s = get_scratch();
+                    s.nodes.reset();
+                    s.holes.clear();
+                    indices.clear();
+                    
+                    const uint32_t numPoints = static_cast<uint32_t>(points.size());
+                    const size_t numLoops = loopStarts.size();
+                    auto loopEnd = [&](size_t loop) {
+                        return loop + 1 < numLoops ? loopStarts[loop + 1] : numPoints;
+                    };
+                    
+                    clipper c(s.nodes, indices);
+                    node *outer = c.makeLoop(points.data(), 0, loopEnd(0), true);
+                    if (!outer || outer->next == outer->prev) {
+                        return false;
+                    }
+                    
+                    for (size_t loop = 1; loop < numLoops; loop++) {
+                        if (node *hole = c.makeLoop(points.data(), loopStarts[loop], loopEnd(loop) - loopStarts[loop], false)) {
+                            s.holes.push_back(hole);
+                        }
+                    }
+                    
+                    if (!s.holes.empty()) {
+                        outer = c.eliminateHoles(outer, s.holes);
+                    }
+                    
+                    if (points.size() > clipper::IndexThreshold) {
+                        double minX = points[0].x, minY = points[0].y, maxX = minX, maxY = minY;
+                        for (uint32_t i = 0; i < numPoints; i++) {
+                            minX = min(minX, points[i].x);
+                            minY = min(minY, points[i].y);
+                            maxX = max(maxX, points[i].x);
+                            maxY = max(maxY, points[i].y);
+                        }
+                        c.setIndexBounds(minX, minY, maxX, maxY);
+                    }
+                    
+                    c.clip(outer, 0);
+                    
+                    double area = polygon_area(points.data(), loopEnd(0));
+                    for (size_t loop = 1; loop < numLoops; loop++) {
+                        area -= polygon_area(points.data() + loopStarts[loop], loopEnd(loop) - loopStarts[loop]);
+                    }
+                    
+                    const double deviation = abs(triangles_area(points, indices) - area);
+                    return !indices.empty() && deviation <= MaxAreaDeviation * area;
+                }
+                
+            }
+            
+            namespace {
+                
+                bool triangulate_ear_clipping(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours, triangulation &result) {
+                    thread_local vector<dvec2> points;
+                    thread_local vector<uint32_t> loopStarts;
+                    points.clear();
+                    loopStarts.clear();
+                    
+                    // marched contours repeat their first vertex at the end; the loops are implicitly closed so drop it
+                    auto append = [](const PolyLine2d &pl) {
+                        const auto &src = pl.getPoints();
+                        size_t count = src.size();
+                        if (count > 1 && src.front() == src.back()) {
+                            count--;
+                        }
+                        
+                        if (count < 3) {
+                            return false;
+                        }
+                        
+                        loopStarts.push_back(static_cast<uint32_t>(points.size()));
+                        points.insert(points.end(), src.begin(), src.begin() + count);
+                        return true;
+                    };
+                    
+                    if (!append(contour)) {
+                        result.clear();
+                        return true;
+                    }
+                    
+                    for (const auto &hole : holeContours) {
+                        append(hole);
+                    }
+                    
+                    if (!ear_clipping::triangulate(points, loopStarts, result.indices)) {
+                        return false;
+                    }
+                    
+                    result.vertices.resize(points.size());
+                    for (size_t i = 0; i < points.size(); i++) {
+                        result.vertices[i] = vec2(points[i]);
+                    }
+                    
+                    return true;
+                }
+                
+                void triangulate_libtess(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours, triangulation &result) {
+                    Triangulator triangulator;
+                    triangulator.addPolyLine(polyline2d_to_2f(contour));
+                    for (const auto &hole : holeContours) {
+                        triangulator.addPolyLine(polyline2d_to_2f(hole));
+                    }
+                    
+                    const TriMeshRef trimesh = triangulator.createMesh();
+                    const vec2 *positions = trimesh->getPositions<2>();
+                    result.vertices.assign(positions, positions + trimesh->getNumVertices());
+                    result.indices = trimesh->getIndices();
+                }
+                
+            }
+            
+            void set_triangulation_engine(TriangulationEngine engine) {
+                _triangulationEngine = engine;
+                CI_LOG_D("triangulation engine: " << _triangulationEngine);
+            }
+            
+            TriangulationEngine get_triangulation_engine() {
+                return static_cast<TriangulationEngine>(_triangulationEngine.load());
+            }
+            
+            bool triangulate(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours, triangulation &result, TriangulationEngine engine) {
+                // ear clipping rejects input it can't cleanly triangulate; libtess handles anything
+                if (engine != TRIANGULATION_EAR_CLIPPING || !triangulate_ear_clipping(contour, holeContours, result)) {
+                    triangulate_libtess(contour, holeContours, result);
+                }
+                
+                return result.getNumTriangles() > 0;
+            }
+            
+            TriMeshRef triangulate(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours) {
+                thread_local triangulation result;
+                triangulate(contour, holeContours, result);
+                
+                TriMeshRef trimesh = make_shared<TriMesh>(TriMesh::Format().positions(2));
+                if (!result.vertices.empty()) {
+                    trimesh->appendPositions(result.vertices.data(), result.vertices.size());
+                }
+                if (!result.indices.empty()) {
+                    trimesh->appendIndices(result.indices.data(), result.indices.size());
+                }
+                
+                return trimesh;
+            }
+            
+            void convex_decomposition(const TriMesh &trimesh, size_t maxVertices, convex_polygons &result) {
+                result.clear();
+                
+                const size_t numTriangles = trimesh.getNumTriangles();
+                const vec2 *positions = trimesh.getPositions<2>();
+                const auto &indices = trimesh.getIndices();
+                const uint32_t NONE = numeric_limits<uint32_t>::max();
+                
+                // each polygon is a counter-clockwise loop of vertex indices, starting as a triangle; merged polygons are emptied
+                vector<vector<uint32_t>> polygons;
+                polygons.reserve(numTriangles);
+                
+                auto position = [positions](uint32_t i) {
+                    return dvec2(positions[i]);
+                };
+                
+                auto cross = [](dvec2 a, dvec2 b, dvec2 c) {
+                    return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+                };
+                
+                for (size_t t = 0; t < numTriangles; t++) {
+                    uint32_t a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+                    const double area = cross(position(a), position(b), position(c));
+                    if (area == 0 || a == b || b == c || a == c) {
+                        continue;
+                    }
+                    if (area < 0) {
+                        swap(a, c);
+                    }
+                    polygons.push_back({ a, b, c });
+                }
+                
+                // the polygon on the left of each directed edge; edges shared by more than two polygons are never merged across
+                unordered_map<uint64_t, uint32_t> edges;
+                edges.reserve(polygons.size() * 3);
+                auto edgeKey = [](uint32_t a, uint32_t b) {
+                    return (static_cast<uint64_t>(a) << 32) | b;
+                };
+                
+                for (uint32_t p = 0; p < polygons.size(); p++) {
+                    const auto &poly = polygons[p];
+                    for (size_t i = 0; i < 3; i++) {
+                        auto r = edges.emplace(edgeKey(poly[i], poly[(i + 1) % 3]), p);
+                        if (!r.second) {
+                            r.first->second = NONE;
+                        }
+                    }
+                }
+                
+                // candidate merges, smallest merged polygon first; candidates are stale once either polygon has grown
+                struct candidate {
+                    size_t size;
+                    uint32_t p, q;
+                    uint32_t a, b;
+                    size_t pSize, qSize;
+                    
+                    bool operator>(const candidate &other) const {
+                        return std::tie(size, p, q, a) > std::tie(other.size, other.p, other.q, other.a);
+                    }
+                };
+                
+                priority_queue<candidate, vector<candidate>, greater<candidate>> candidates;
+                auto addCandidates = [&](uint32_t p) {
+                    const auto &poly = polygons[p];
+                    for (size_t i = 0, pn = poly.size(); i < pn; i++) {
+                        const uint32_t a = poly[i], b = poly[(i + 1) % pn];
+                        const auto neighbor = edges.find(edgeKey(b, a));
+                        if (neighbor != edges.end() && neighbor->second != NONE && neighbor->second != p) {
+                            const uint32_t q = neighbor->second;
+                            const size_t size = pn + polygons[q].size() - 2;
+                            if (size <= maxVertices) {
+                                candidates.push({ size, p, q, a, b, pn, polygons[q].size() });
+                            }
+                        }
+                    }
+                };
+                
+                for (uint32_t p = 0; p < polygons.size(); p++) {
+                    addCandidates(p);
+                }
+                
+                vector<uint32_t> merged;
+                while (!candidates.empty()) {
+                    const candidate c = candidates.top();
+                    candidates.pop();
+                    
+                    auto &poly = polygons[c.p];
+                    auto &other = polygons[c.q];
+                    if (poly.size() != c.pSize || other.size() != c.qSize) {
+                        continue;
+                    }
+                    
+                    const size_t pn = poly.size(), qn = other.size();
+                    const size_t i = static_cast<size_t>(find(poly.begin(), poly.end(), c.a) - poly.begin());
+                    const size_t j = static_cast<size_t>(find(other.begin(), other.end(), c.b) - other.begin());
+                    if (i == pn || j == qn || poly[(i + 1) % pn] != c.b || other[(j + 1) % qn] != c.a) {
+                        continue;
+                    }
+                    
+                    // the merged polygon is convex if the corners at both ends of the removed edge are
+                    const uint32_t pPrev = poly[(i + pn - 1) % pn], pNext = poly[(i + 2) % pn];
+                    const uint32_t qPrev = other[(j + qn - 1) % qn], qNext = other[(j + 2) % qn];
+                    if (cross(position(pPrev), position(c.a), position(qNext)) < 0 || cross(position(qPrev), position(c.b), position(pNext)) < 0) {
+                        continue;
+                    }
+                    
+                    // b, the rest of p, a, then the rest of q
+                    merged.clear();
+                    for (size_t k = 0; k < pn; k++) {
+                        merged.push_back(poly[(i + 1 + k) % pn]);
+                    }
+                    for (size_t k = 2; k < qn; k++) {
+                        merged.push_back(other[(j + k) % qn]);
+                    }
+                    
+                    edges.erase(edgeKey(c.a, c.b));
+                    edges.erase(edgeKey(c.b, c.a));
+                    for (size_t k = 0; k < qn; k++) {
+                        const auto e = edges.find(edgeKey(other[k], other[(k + 1) % qn]));
+                        if (e != edges.end() && e->second == c.q) {
+                            e->second = c.p;
+                        }
+                    }
+                    
+                    poly.swap(merged);
+                    other.clear();
+                    addCandidates(c.p);
+                }
+                
+                for (const auto &poly : polygons) {
+                    if (!poly.empty()) {
+                        result.offsets.push_back(result.vertices.size());
+                        for (uint32_t i : poly) {
+                            result.vertices.push_back(position(i));
+                        }
+                    }
+                }
+                
+                if (!result.vertices.empty()) {
+                    result.offsets.push_back(result.vertices.size());
+                }
+            }
+            
+#pragma mark - triangle_grid
+            
+            namespace {
+                
+                // barycentric tolerance of triangle_grid::contains
+                const float TriangleContainsEpsilon = 1e-4f;
+                
+                bool triangle_contains(vec2 a, vec2 b, vec2 c, dvec2 p) {
+                    // https://stackoverflow.com/questions/13300904/determine-whether-point-lies-inside-triangle
+                    const float alpha = ((b.y - c.y)*(p.x - c.x) + (c.x - b.x)*(p.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
+                    const float beta = ((c.y - a.y)*(p.x - c.x) + (a.x - c.x)*(p.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
+                    const float gamma = 1.0f - alpha - beta;
+                    
+                    return alpha > -TriangleContainsEpsilon && beta > -TriangleContainsEpsilon && gamma > -TriangleContainsEpsilon;
+                }
+                
+                // the range of x covered by the triangle `v within the rows [yMin, yMax]
+                bool triangle_x_extent(const vec2 *v, double yMin, double yMax, double &xMin, double &xMax) {
+                    xMin = numeric_limits<double>::max();
+                    xMax = -numeric_limits<double>::max();
+                    
+                    // the triangle's intersection with the rows is convex, with vertices on the triangle's edges clipped to the rows
+                    for (int e = 0; e < 3; e++) {
+                        dvec2 p(v[e]), q(v[(e + 1) % 3]);
+                        if (p.y > q.y) {
+                            swap(p, q);
+                        }
+                        if (q.y < yMin || p.y > yMax) {
+                            continue;
+                        }
+                        
+                        const double dy = q.y - p.y;
+                        const double t0 = dy > 0 ? max(0.0, (yMin - p.y) / dy) : 0.0;
+                        const double t1 = dy > 0 ? min(1.0, (yMax - p.y) / dy) : 1.0;
+                        const double x0 = p.x + (q.x - p.x) * t0, x1 = p.x + (q.x - p.x) * t1;
+                        xMin = min(xMin, min(x0, x1));
+                        xMax = max(xMax, max(x0, x1));
+                    }
+                    
+                    return xMin <= xMax;
+                }
+                
+            }
+            
+            /*
+             vector<vec2> _vertices;
+             dvec2 _origin;
+             double _invCellSize;
+             size_t _cols, _rows;
+             vector<uint32_t> _cellStarts;
+             vector<uint32_t> _cellTriangles;
+             */
+            
+            triangle_grid::triangle_grid(const TriMesh &trimesh) :
+            _origin(0, 0),
+            _invCellSize(0),
+            _cols(0),
+            _rows(0) {
+                const size_t numTriangles = trimesh.getNumTriangles();
+                if (numTriangles == 0) {
+                    return;
+                }
+                
+                _vertices.resize(numTriangles * 3);
+                for (size_t i = 0; i < numTriangles; i++) {
+                    trimesh.getTriangleVertices(i, &_vertices[i * 3], &_vertices[i * 3 + 1], &_vertices[i * 3 + 2]);
+                }
+                
+                // the tolerance lets a point lie a little outside a triangle; pad each triangle by more than that
+                auto padding = [](const vec2 *v) {
+                    const double w = max(v[0].x, max(v[1].x, v[2].x)) - min(v[0].x, min(v[1].x, v[2].x));
+                    const double h = max(v[0].y, max(v[1].y, v[2].y)) - min(v[0].y, min(v[1].y, v[2].y));
+                    return 10 * TriangleContainsEpsilon * max(w, h) + 1e-3;
+                };
+                
+                dvec2 minP(numeric_limits<double>::max()), maxP(-numeric_limits<double>::max());
+                for (size_t i = 0; i < numTriangles; i++) {
+                    const vec2 *v = &_vertices[i * 3];
+                    const double pad = padding(v);
+                    for (int k = 0; k < 3; k++) {
+                        minP = min(minP, dvec2(v[k]) - pad);
+                        maxP = max(maxP, dvec2(v[k]) + pad);
+                    }
+                }
+                
+                // about one triangle per cell, within limits
+                const size_t MaxCellsPerSide = 1024;
+                const dvec2 size = maxP - minP;
+                const double cellSize = max(sqrt(size.x * size.y / numTriangles), max(size.x, size.y) / MaxCellsPerSide);
+                
+                _origin = minP;
+                _invCellSize = 1 / cellSize;
+                _cols = min(static_cast<size_t>(ceil(size.x * _invCellSize)), MaxCellsPerSide);
+                _rows = min(static_cast<size_t>(ceil(size.y * _invCellSize)), MaxCellsPerSide);
+                _cols = max<size_t>(_cols, 1);
+                _rows = max<size_t>(_rows, 1);
+                
+                // visit(cell, triangle) for each cell each padded triangle overlaps, row by row
+                auto forEachCell = [this, &padding](size_t triangle, const std::function<void(size_t)> &visit) {
+                    const vec2 *v = &_vertices[triangle * 3];
+                    const double pad = padding(v);
+                    const double yMin = min(v[0].y, min(v[1].y, v[2].y)) - pad;
+                    const double yMax = max(v[0].y, max(v[1].y, v[2].y)) + pad;
+                    
+                    auto clampRow = [this](double y) {
+                        return static_cast<size_t>(glm::clamp<double>(floor((y - _origin.y) * _invCellSize), 0, _rows - 1));
+                    };
+                    auto clampCol = [this](double x) {
+                        return static_cast<size_t>(glm::clamp<double>(floor((x - _origin.x) * _invCellSize), 0, _cols - 1));
+                    };
+                    
+                    for (size_t row = clampRow(yMin), lastRow = clampRow(yMax); row <= lastRow; row++) {
+                        const double rowMin = _origin.y + row / _invCellSize;
+                        const double rowMax = _origin.y + (row + 1) / _invCellSize;
+                        
+                        // the padded triangle's extent in this row is within its extent in the row widened by the padding
+                        double xMin, xMax;
+                        if (triangle_x_extent(v, rowMin - pad, rowMax + pad, xMin, xMax)) {
+                            for (size_t col = clampCol(xMin - pad), lastCol = clampCol(xMax + pad); col <= lastCol; col++) {
+                                visit(row * _cols + col);
+                            }
+                        }
+                    }
+                };
+                
+                // count, then fill
+                _cellStarts.assign(_cols * _rows + 1, 0);
+                for (size_t i = 0; i < numTriangles; i++) {
+                    forEachCell(i, [this](size_t cell) {
+                        _cellStarts[cell + 1]++;
+                    });
+                }
+                
+                for (size_t i = 1; i < _cellStarts.size(); i++) {
+                    _cellStarts[i] += _cellStarts[i - 1];
+                }
+                
+                vector<uint32_t> cursor(_cellStarts.begin(), _cellStarts.end() - 1);
+                _cellTriangles.resize(_cellStarts.back());
+                for (size_t i = 0; i < numTriangles; i++) {
+                    forEachCell(i, [this, i, &cursor](size_t cell) {
+                        _cellTriangles[cursor[cell]++] = static_cast<uint32_t>(i);
+                    });
+                }
+            }
+            
+            bool triangle_grid::contains(dvec2 point) const {
+                if (_cellStarts.empty()) {
+                    return false;
+                }
+                
+                const double col = floor((point.x - _origin.x) * _invCellSize);
+                const double row = floor((point.y - _origin.y) * _invCellSize);
+                if (col < 0 || row < 0 || col >= _cols || row >= _rows) {
+                    return false;
+                }
+                
+                const size_t cell = static_cast<size_t>(row) * _cols + static_cast<size_t>(col);
+                for (uint32_t i = _cellStarts[cell], end = _cellStarts[cell + 1]; i < end; i++) {
+                    const vec2 *v = &_vertices[_cellTriangles[i] * 3];
+                    if (triangle_contains(v[0], v[1], v[2], point)) {
+                        return true;
+                    }
+                }
+                
+                return false;
+            }
+            
+        }
+    }
+} // end namespace elements::terrain::detail
@@ -0,0 +1,134 @@
+//
+//  TerrainDetail_Triangulation.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/24/18.
+//
+
+#ifndef TerrainDetail_Triangulation_hpp
+#define TerrainDetail_Triangulation_hpp
+
+#include "core/Core.hpp"
+
+namespace elements {
+    namespace terrain {
+        namespace detail {
+            
+            // the ways triangulate() can triangulate a polygon
+            enum TriangulationEngine {
+                // hole bridging and ear clipping; input which doesn't triangulate cleanly this way is handed to libtess
+                TRIANGULATION_EAR_CLIPPING,
+                // cinder's Triangulator (libtess2) with the odd winding rule
+                TRIANGULATION_LIBTESS
+            };
+            
+            // select the engine triangulate() uses, e.g. to compare them; the default is TRIANGULATION_EAR_CLIPPING
+            void set_triangulation_engine(TriangulationEngine engine);
+            
+            TriangulationEngine get_triangulation_engine();
+            
+            /**
+             A triangle list, where each consecutive 3 indices into `vertices form a triangle. Triangle winding is unspecified.
+             */
+            struct triangulation {
+                vector<vec2> vertices;
+                vector<uint32_t> indices;
+                
+                size_t getNumTriangles() const {
+                    return indices.size() / 3;
+                }
+                
+                void clear() {
+                    vertices.clear();
+                    indices.clear();
+                }
+            };
+            
+            /**
+             Triangulate the polygon bounded by `contour with holes `holeContours, which may be wound either way,
+             replacing the contents of `result. The contours are expected to be simple, as terrain contours are, with
+             holes inside the outer contour. Returns false if no triangles were produced.
+             */
+            bool triangulate(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours, triangulation &result, TriangulationEngine engine);
+            
+            inline bool triangulate(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours, triangulation &result) {
+                return triangulate(contour, holeContours, result, get_triangulation_engine());
+            }
+            
+            /**
+             Triangulate as above, returning the result as a 2d TriMesh as cinder's Triangulator::createMesh would.
+             */
+            TriMeshRef triangulate(const PolyLine2d &contour, const vector<PolyLine2d> &holeContours = vector<PolyLine2d>());
+            
+            /**
+             A set of convex polygons, where polygon i's vertices are vertices [offsets[i], offsets[i + 1]), counter-clockwise.
+             */
+            struct convex_polygons {
+                vector<dvec2> vertices;
+                vector<size_t> offsets;
+                
+                size_t size() const {
+                    return offsets.empty() ? 0 : offsets.size() - 1;
+                }
+                
+                const dvec2 *getVertices(size_t polygon) const {
+                    return vertices.data() + offsets[polygon];
+                }
+                
+                size_t getNumVertices(size_t polygon) const {
+                    return offsets[polygon + 1] - offsets[polygon];
+                }
+                
+                void clear() {
+                    vertices.clear();
+                    offsets.clear();
+                }
+            };
+            
+            /**
+             Hertel-Mehlhorn convex decomposition: merge the triangles of `trimesh across their shared edges wherever the merged
+             polygon remains convex with no more than `maxVertices vertices, replacing the contents of `result. Triangles with no
+             area are skipped. The polygons cover the same area as the triangles, in fewer pieces; merges making the smallest polygons
+             are made first, which leaves fewer triangles stranded beside neighbors that are already full.
+             */
+            void convex_decomposition(const TriMesh &trimesh, size_t maxVertices, convex_polygons &result);
+            
+            /**
+             Point location for a TriMesh: a uniform grid over the mesh's bounds, each cell listing the triangles which may
+             overlap it, so a query tests the few triangles of one cell rather than every triangle. Triangles are entered by
+             their extent along each row of cells rather than by their bounds, so long slivers don't fill whole regions.
+             */
+            class triangle_grid {
+            public:
+                
+                explicit triangle_grid(const TriMesh &trimesh);
+                
+                /**
+                 Return true iff `point is inside a triangle of the mesh, by the barycentric test (with a small tolerance
+                 so points on shared edges aren't missed) which Shape::isLocalPointInside has always used.
+                 */
+                bool contains(dvec2 point) const;
+                
+                size_t getNumTriangles() const {
+                    return _vertices.size() / 3;
+                }
+            
+            private:
+                
+                // three vertices per triangle
+                vector<vec2> _vertices;
+                
+                dvec2 _origin;
+                double _invCellSize;
+                size_t _cols, _rows;
+                
+                // the triangles of cell i are _cellTriangles[_cellStarts[i], _cellStarts[i + 1])
+                vector<uint32_t> _cellStarts;
+                vector<uint32_t> _cellTriangles;
+            };
+            
+        }
+    }
+} // end namespace elements::terrain::detail
+
+#endif /* TerrainDetail_Triangulation_hpp */
@@ -8,18 +8,21 @@
 
 #include <queue>
 #include <limits>
+#include <thread>
 
-#include <cinder/Triangulate.h>
 #include <cinder/Rand.h>
 #include <cinder/Xml.h>
 
 #include "elements/Terrain/TerrainWorld.hpp"
 #include "elements/Terrain/TerrainDetail.hpp"
+#include "elements/Terrain/TerrainDetail_Clipping.hpp"
 #include "elements/Terrain/TerrainDetail_MarchingSquares.hpp"
+#include "elements/Terrain/TerrainDetail_Triangulation.hpp"
 #include "elements/Terrain/TerrainDetail_Svg.hpp"
 
 #include "core/util/ContourSimplification.hpp"
 #include "core/util/SvgParsing.hpp"
+#include "core/util/ThreadPool.hpp"
 
 using namespace core;
 
@@ -33,6 +36,58 @@ namespace elements {
             
             const double MIN_TRIANGLE_AREA = 1;
             
+            // upper bound on the vertex count of polygons merged by convex decomposition; chipmunk has no fixed limit,
+            // but polygon collision cost grows with vertex count
+            const size_t MAX_CONVEX_POLYGON_VERTICES = 8;
+            
+            /**
+             Call `emit(const cpVect *verts, int count, double area) for each collision polygon of `trimesh with at least
+             MIN_TRIANGLE_AREA area: each triangle, or if `convexDecomposition each polygon of the trimesh's convex decomposition.
+             Polygons are wound so their area is positive.
+             */
+            template<class F>
+            void for_each_collision_polygon(const TriMesh &trimesh, bool convexDecomposition, const F &emit) {
+                if (convexDecomposition) {
+                    thread_local detail::convex_polygons polygons;
+                    thread_local vector<cpVect> verts;
+                    detail::convex_decomposition(trimesh, MAX_CONVEX_POLYGON_VERTICES, polygons);
+                    
+                    for (size_t i = 0, N = polygons.size(); i < N; i++) {
+                        const dvec2 *v = polygons.getVertices(i);
+                        verts.resize(polygons.getNumVertices(i));
+                        for (size_t j = 0; j < verts.size(); j++) {
+                            verts[j] = cpv(v[j]);
+                        }
+                        
+                        const double area = cpAreaForPoly(static_cast<int>(verts.size()), verts.data(), 0);
+                        if (area >= MIN_TRIANGLE_AREA) {
+                            emit(verts.data(), static_cast<int>(verts.size()), area);
+                        }
+                    }
+                } else {
+                    cpVect triangle[3];
+                    for (size_t i = 0, N = trimesh.getNumTriangles(); i < N; i++) {
+                        vec2 a, b, c;
+                        trimesh.getTriangleVertices(i, &a, &b, &c);
+                        triangle[0] = cpv(a);
+                        triangle[1] = cpv(b);
+                        triangle[2] = cpv(c);
+                        
+                        double area = cpAreaForPoly(3, triangle, 0);
+                        if (area < 0) {
+                            triangle[0] = cpv(c);
+                            triangle[1] = cpv(b);
+                            triangle[2] = cpv(a);
+                            area = cpAreaForPoly(3, triangle, 0);
+                        }
+                        
+                        if (area >= MIN_TRIANGLE_AREA) {
+                            emit(triangle, 3, area);
+                        }
+                    }
+                }
+            }
+            
             // if > 0 we add a water-tight perimeter geometry around shapes
             // unfortunately, mitering is HARD and so right now this is disabled.
             const double PERIMETER_SEGMENT_RADIUS = 0;
@@ -50,6 +105,33 @@ namespace elements {
                 return static_cast<Drawable *>(obj)->getBB();
             }
             
+            void expandBBIterator(void *obj, void *data) {
+                cpBB *bb = static_cast<cpBB *>(data);
+                *bb = cpBBExpand(*bb, static_cast<Drawable *>(obj)->getBB());
+            }
+            
+            struct point_query {
+                dvec2 point;
+                ShapeRef shape;
+            };
+            
+            cpCollisionID shapeContainingPointCollector(void *obj1, void *obj2, cpCollisionID id, void *data) {
+                point_query *query = static_cast<point_query *>(data);
+                if (!query->shape) {
+                    Shape *shape = static_cast<Shape *>(obj2);
+                    if (shape->isLocalPointInside(query->point)) {
+                        query->shape = shape->shared_from_this_as<Shape>();
+                    }
+                }
+                return id;
+            }
+            
+            cpCollisionID shapeCollector(void *obj1, void *obj2, cpCollisionID id, void *data) {
+                set <ShapeRef> *shapes = static_cast<set <ShapeRef> *>(data);
+                shapes->insert(static_cast<Shape *>(obj2)->shared_from_this_as<Shape>());
+                return id;
+            }
+            
             cpCollisionID visibleObjectCollector(void *obj1, void *obj2, cpCollisionID id, void *data) {
                 //DrawDispatcher *dispatcher = static_cast<DrawDispatcher*>(obj1);
                 DrawableRef drawable = static_cast<Drawable *>(obj2)->shared_from_this_as<Drawable>();
@@ -87,9 +169,13 @@ namespace elements {
          cpSpatialIndex *_index;
          set<ShapeRef> _all;
          collector _collector;
+         bool _batched;
+         detail::draw_batcher _batcher;
+         unique_ptr<detail::gl_draw_batch_backend> _batchBackend;
          */
         DrawDispatcher::DrawDispatcher() :
-        _index(cpBBTreeNew(objectBBFunc, NULL))
+        _index(cpBBTreeNew(objectBBFunc, NULL)),
+        _batched(false)
         {
         }
         
@@ -138,6 +224,14 @@ namespace elements {
         }
         
         void DrawDispatcher::draw(const render_state &state, const gl::GlslProgRef &shader) {
+            if (_batched) {
+                if (!_batchBackend) {
+                    _batchBackend.reset(new detail::gl_draw_batch_backend());
+                }
+                drawBatched(state, *_batchBackend);
+                return;
+            }
+            
             render_state renderState = state;
             gl::ScopedGlslProg sglp(shader);
             
@@ -146,6 +240,18 @@ namespace elements {
             }
         }
         
+        void DrawDispatcher::drawBatched(const render_state &state, detail::draw_batch_backend &backend) {
+            for (const auto &drawable : _collector.sorted) {
+                if (drawable->shouldDraw(state)) {
+                    if (const TriMeshRef &trimesh = drawable->getTriMesh()) {
+                        _batcher.add(*trimesh, drawable->getModelMatrix(), ColorA(drawable->getColor(state), 1));
+                    }
+                }
+            }
+            
+            _batcher.flush(backend);
+        }
+        
         vector<DrawableRef>::iterator
         DrawDispatcher::_drawGroupRun(vector<DrawableRef>::iterator firstInRun, vector<DrawableRef>::iterator storageEnd, const render_state &state, const gl::GlslProgRef &shader) {
             
@@ -168,8 +274,10 @@ namespace elements {
                 
                 drawable = *it;
                 if (drawable->shouldDraw(state)) {
-                    shader->uniform("Color", ColorA(drawable->getColor(state), 1));
-                    gl::draw(drawable->getVboMesh());
+                    if (const gl::VboMeshRef &vboMesh = drawable->getVboMesh()) {
+                        shader->uniform("Color", ColorA(drawable->getColor(state), 1));
+                        gl::draw(vboMesh);
+                    }
                 }
             }
             
@@ -177,9 +285,36 @@ namespace elements {
         }
         
         
+#pragma mark - CutOperation
+        
+        /*
+         vector <dpolygon2> _polygons;
+         vector <cpBB> _polygonWorldBounds;
+         double _minSurfaceArea;
+         ClippingEngine _clippingEngine;
+         std::atomic<State> _state;
+         vector <item> _items;
+         std::atomic<bool> _claimed, _computed;
+         std::mutex _computedMutex;
+         std::condition_variable _computedCondition;
+         */
+        
+        CutOperation::CutOperation(const vector <dpolygon2> &polygons, const vector <cpBB> &polygonWorldBounds, double minSurfaceArea) :
+        _polygons(polygons),
+        _polygonWorldBounds(polygonWorldBounds),
+        _minSurfaceArea(minSurfaceArea),
+        _clippingEngine(World::getClippingEngine()),
+        _state(PENDING),
+        _claimed(false),
+        _computed(false) {
+        }
+        
 #pragma mark - World
         
-        size_t World::_idCounter = 0;
+        std::atomic<size_t> World::_idCounter(0);
+        // fixed point clipping builds its arrangement by testing every edge pair, so it stays opt-in until it scales to planet sized contours
+        ClippingEngine World::_clippingEngine = BOOST_GEOMETRY_CLIPPING;
+        bool World::_graphicsEnabled = true;
         
         void World::loadSvg(DataSourceRef svgData, dmat4 transform, vector <ShapeRef> &shapes, vector <AnchorRef> &anchors, vector <ElementRef> &elements, bool flip) {
             shapes.clear();
@@ -205,6 +340,90 @@ namespace elements {
             anchors = Anchor::fromContours(detail::march(anchorIsoSurface, isoLevel, transform, 0.01));
         }
         
+        namespace {
+            
+            /**
+             The window of a partition grid overlapped by a single shape. Tiles touched by any of the shape's contour
+             edges are marked as boundary tiles, which need a boolean intersection; every other tile in the window
+             lies entirely inside or entirely outside the shape.
+             */
+            struct partition_window {
+                cpBB gridBounds;
+                double tileSize;
+                int firstColumn, lastColumn, firstRow, lastRow;
+                vector <bool> boundary;
+                
+                partition_window(cpBB gridBounds, double tileSize, int columns, int rows, cpBB shapeBounds) :
+                gridBounds(gridBounds),
+                tileSize(tileSize) {
+                    
+                    // the tiles whose bounds (inclusively) intersect the shape's bounds
+                    firstColumn = max(static_cast<int>(ceil((shapeBounds.l - gridBounds.l) / tileSize - 1)), 0);
+                    lastColumn = min(static_cast<int>(floor((shapeBounds.r - gridBounds.l) / tileSize)), columns - 1);
+                    firstRow = max(static_cast<int>(ceil((shapeBounds.b - gridBounds.b) / tileSize - 1)), 0);
+                    lastRow = min(static_cast<int>(floor((shapeBounds.t - gridBounds.b) / tileSize)), rows - 1);
+                    
+                    if (!isEmpty()) {
+                        boundary.resize((lastColumn - firstColumn + 1) * (lastRow - firstRow + 1), false);
+                    }
+                }
+                
+                bool isEmpty() const {
+                    return lastColumn < firstColumn || lastRow < firstRow;
+                }
+                
+                cpBB tileBB(int column, int row) const {
+                    const double l = gridBounds.l + column * tileSize;
+                    const double b = gridBounds.b + row * tileSize;
+                    return cpBBNew(l, b, l + tileSize, b + tileSize);
+                }
+                
+                bool isBoundary(int column, int row) const {
+                    return boundary[(row - firstRow) * (lastColumn - firstColumn + 1) + (column - firstColumn)];
+                }
+                
+                // conservatively mark every tile the segment a->b touches, row by row
+                void markEdge(dvec2 a, dvec2 b) {
+                    const double epsilon = tileSize * 1e-6;
+                    
+                    const int rowMin = max(static_cast<int>(floor((min(a.y, b.y) - epsilon - gridBounds.b) / tileSize)), firstRow);
+                    const int rowMax = min(static_cast<int>(floor((max(a.y, b.y) + epsilon - gridBounds.b) / tileSize)), lastRow);
+                    
+                    for (int row = rowMin; row <= rowMax; row++) {
+                        
+                        // clip the segment to the row's vertical extent to get its horizontal extent in this row
+                        double xMin = min(a.x, b.x), xMax = max(a.x, b.x);
+                        if (a.y != b.y) {
+                            const double rowBottom = gridBounds.b + row * tileSize - epsilon;
+                            const double rowTop = rowBottom + tileSize + 2 * epsilon;
+                            const double t0 = saturate<double>((rowBottom - a.y) / (b.y - a.y));
+                            const double t1 = saturate<double>((rowTop - a.y) / (b.y - a.y));
+                            const double x0 = a.x + t0 * (b.x - a.x);
+                            const double x1 = a.x + t1 * (b.x - a.x);
+                            xMin = min(x0, x1);
+                            xMax = max(x0, x1);
+                        }
+                        
+                        const int columnMin = max(static_cast<int>(floor((xMin - epsilon - gridBounds.l) / tileSize)), firstColumn);
+                        const int columnMax = min(static_cast<int>(floor((xMax + epsilon - gridBounds.l) / tileSize)), lastColumn);
+                        
+                        for (int column = columnMin; column <= columnMax; column++) {
+                            boundary[(row - firstRow) * (lastColumn - firstColumn + 1) + (column - firstColumn)] = true;
+                        }
+                    }
+                }
+                
+                void markRing(const dpolygon2::ring_type &ring) {
+                    for (size_t i = 0, N = ring.size(); i < N; i++) {
+                        const dpoint2 &a = ring[i];
+                        const dpoint2 &b = ring[(i + 1) % N];
+                        markEdge(dvec2(a.x(), a.y()), dvec2(b.x(), b.y()));
+                    }
+                }
+            };
+            
+        }
+        
         vector <ShapeRef> World::partition(const vector <ShapeRef> &shapes, double partitionSize) {
             
             // first compute the march area
@@ -213,39 +432,118 @@ namespace elements {
                 bounds = cpBBExpand(bounds, shape->getWorldSpaceContourEdgesBB());
             }
             
+            const int columns = static_cast<int>(floor((bounds.r - bounds.l) / partitionSize)) + 1;
+            const int rows = static_cast<int>(floor((bounds.t - bounds.b) / partitionSize)) + 1;
             const dmat4 identity(1);
-            cpBB quadBB = cpBBInvalid;
-            
-            PolyLine2d quad;
-            quad.getPoints().resize(4);
             
             vector <ShapeRef> result;
             
             for (auto shape : shapes) {
-                dpolygon2 testPolygon = detail::shape_to_dpolygon2(shape);
-                
-                for (double marchY = bounds.b; marchY <= bounds.t; marchY += partitionSize) {
-                    quadBB.b = marchY;
-                    quadBB.t = quadBB.b + partitionSize;
-                    for (double marchX = bounds.l; marchX <= bounds.r; marchX += partitionSize) {
-                        quadBB.l = marchX;
-                        quadBB.r = quadBB.l + partitionSize;
+                const dpolygon2 testPolygon = detail::shape_to_dpolygon2(shape);
+                
+                partition_window window(bounds, partitionSize, columns, rows, shape->getWorldSpaceContourEdgesBB());
+                if (window.isEmpty()) {
+                    continue;
+                }
+                
+                //
+                //  Mark the tiles the shape's contours pass through. Only those need a boolean intersection;
+                //  the rest are copied as quads if they're inside the shape and dropped if they're outside.
+                //
+                
+                window.markRing(testPolygon.outer());
+                for (const auto &inner : testPolygon.inners()) {
+                    window.markRing(inner);
+                }
+                
+                auto partitionRow = [&](int row, vector <detail::polyline_with_holes> &rowResult) {
+                    PolyLine2d quad;
+                    quad.getPoints().resize(4);
+                    
+                    auto makeQuad = [&quad](cpBB quadBB) {
+                        quad.getPoints()[0] = dvec2(quadBB.l, quadBB.b);
+                        quad.getPoints()[1] = dvec2(quadBB.l, quadBB.t);
+                        quad.getPoints()[2] = dvec2(quadBB.r, quadBB.t);
+                        quad.getPoints()[3] = dvec2(quadBB.r, quadBB.b);
+                    };
+                    
+                    //
+                    //  Clip the shape to this row first, so each boundary tile is intersected against only
+                    //  the geometry in its row rather than the whole shape.
+                    //
+                    
+                    std::vector<dpolygon2> rowPolygons;
+                    vector <cpBB> rowPolygonBBs;
+                    for (int column = window.firstColumn; column <= window.lastColumn; column++) {
+                        if (window.isBoundary(column, row)) {
+                            makeQuad(cpBBMerge(window.tileBB(window.firstColumn, row), window.tileBB(window.lastColumn, row)));
+                            boost::geometry::intersection(testPolygon, detail::polyline2d_to_dpolygon2(quad), rowPolygons);
+                            for (const auto &rowPolygon : rowPolygons) {
+                                rowPolygonBBs.push_back(detail::polygon_bb(rowPolygon));
+                            }
+                            break;
+                        }
+                    }
+                    
+                    for (int column = window.firstColumn; column <= window.lastColumn;) {
                         
-                        if (cpBBIntersects(quadBB, shape->getWorldSpaceContourEdgesBB())) {
-                            // generate the test quad
-                            quad.getPoints()[0] = dvec2(quadBB.l, quadBB.b);
-                            quad.getPoints()[1] = dvec2(quadBB.l, quadBB.t);
-                            quad.getPoints()[2] = dvec2(quadBB.r, quadBB.t);
-                            quad.getPoints()[3] = dvec2(quadBB.r, quadBB.b);
-                            
+                        if (window.isBoundary(column, row)) {
+                            const cpBB quadBB = window.tileBB(column, row);
+                            makeQuad(quadBB);
                             auto polygonToIntersect = detail::polyline2d_to_dpolygon2(quad);
                             
                             std::vector<dpolygon2> output;
-                            boost::geometry::intersection(testPolygon, polygonToIntersect, output);
+                            for (size_t i = 0, N = rowPolygons.size(); i < N; i++) {
+                                if (cpBBIntersects(rowPolygonBBs[i], quadBB)) {
+                                    boost::geometry::intersection(rowPolygons[i], polygonToIntersect, output);
+                                }
+                            }
                             
-                            auto newShapes = detail::dpolygon2_to_shape(output, identity);
-                            result.insert(result.end(), newShapes.begin(), newShapes.end());
+                            auto newShapes = detail::dpolygon2_to_polyline_with_holes(output, identity);
+                            rowResult.insert(rowResult.end(), newShapes.begin(), newShapes.end());
+                            column++;
+                            continue;
+                        }
+                        
+                        //
+                        // a run of non-boundary tiles is entirely inside or entirely outside the shape, so one
+                        // point in polygon test classifies the whole run
+                        //
+                        
+                        int runEnd = column;
+                        while (runEnd < window.lastColumn && !window.isBoundary(runEnd + 1, row)) {
+                            runEnd++;
+                        }
+                        
+                        const cpBB firstBB = window.tileBB(column, row);
+                        const dpoint2 center((firstBB.l + firstBB.r) * 0.5, (firstBB.b + firstBB.t) * 0.5);
+                        if (boost::geometry::within(center, testPolygon)) {
+                            for (int c = column; c <= runEnd; c++) {
+                                makeQuad(window.tileBB(c, row));
+                                rowResult.emplace_back(quad, vector<PolyLine2d>());
+                            }
                         }
+                        
+                        column = runEnd + 1;
+                    }
+                };
+                
+                //
+                //  Rows are independent, so fan them out across the thread pool. Each row's geometry is collected
+                //  separately and made into shapes in row order on this thread, so neither the result nor the
+                //  shapes' ids depend on scheduling.
+                //
+                
+                const int rowCount = window.lastRow - window.firstRow + 1;
+                vector <vector<detail::polyline_with_holes>> rowResults(rowCount);
+                
+                util::ThreadPool::shared().parallelFor(static_cast<size_t>(rowCount), [&](size_t i) {
+                    partitionRow(window.firstRow + static_cast<int>(i), rowResults[i]);
+                });
+                
+                for (const auto &rowResult : rowResults) {
+                    for (const auto &plh : rowResult) {
+                        result.push_back(make_shared<Shape>(plh.contour, plh.holes));
                     }
                 }
             }
@@ -254,7 +552,7 @@ namespace elements {
         }
         
         /*
-         static size_t _idCounter;
+         static std::atomic<size_t> _idCounter;
          
          material _worldMaterial, _anchorMaterial;
          core::SpaceAccessRef _space;
@@ -278,7 +576,12 @@ namespace elements {
         World::World(SpaceAccessRef space, material worldMaterial, material anchorMaterial) :
         _worldMaterial(worldMaterial),
         _anchorMaterial(anchorMaterial),
-        _space(space) {
+        _space(space),
+        _parallelCutting(true) {
+            
+            if (!_graphicsEnabled) {
+                return;
+            }
             
             auto vsh = CI_GLSL(150,
                                uniform
@@ -307,6 +610,19 @@ namespace elements {
         }
         
         World::~World() {
+            
+            //
+            // in-flight cuts reference their operation only, but we don't want to leave pool tasks running on our shapes.
+            // claiming a cut no worker has started means it never will; otherwise wait for the worker to finish it.
+            //
+            
+            for (auto &operation : _pendingCuts) {
+                if (operation->_state == CutOperation::COMPUTING && operation->_claimed.exchange(true)) {
+                    waitForComputedCut(operation);
+                }
+            }
+            _pendingCuts.clear();
+            
             //
             // we want these destructors run before the drawDispatcher is destroyed
             //
@@ -393,18 +709,77 @@ namespace elements {
             
             if (!polygonShape.outer().empty()) {
                 auto sw = core::StopWatch("World::cut");
+                flushPendingCuts();
+                
+                CutOperationRef operation(new CutOperation({polygonShape}, {polygonShapeWorldBounds}, minSurfaceArea));
+                prepareCut(operation);
+                computeCut(operation, _parallelCutting);
+                commitCut(operation);
                 
-                if (!cpBBIsValid(polygonShapeWorldBounds)) {
-                    polygonShapeWorldBounds = detail::polygon_bb(polygonShape);
+            } else {
+                CI_LOG_E("Either length and/or radius were below minimum thresholds");
+            }
+        }
+        
+        void World::cut(const vector <dpolygon2> &polygonShapes, double minSurfaceArea) {
+            
+            vector <dpolygon2> polygons;
+            for (const auto &polygonShape : polygonShapes) {
+                if (!polygonShape.outer().empty()) {
+                    polygons.push_back(polygonShape);
                 }
+            }
+            
+            if (!polygons.empty()) {
+                auto sw = core::StopWatch("World::cut - batch of " + str(polygons.size()));
+                flushPendingCuts();
                 
-                cut_collector collector(_worldMaterial.filter, _worldMaterial.collisionType);
+                CutOperationRef operation(new CutOperation(polygons, vector<cpBB>(polygons.size(), cpBBInvalid), minSurfaceArea));
+                prepareCut(operation);
+                computeCut(operation, _parallelCutting);
+                commitCut(operation);
                 
-                //
-                // perform a bounding box query
-                //
+            } else {
+                CI_LOG_E("No non-empty polygons to cut with");
+            }
+        }
+        
+        CutOperationRef World::cutAsync(const dpolygon2 &polygonShape, cpBB polygonShapeWorldBounds, double minSurfaceArea) {
+            CutOperationRef operation(new CutOperation({polygonShape}, {polygonShapeWorldBounds}, minSurfaceArea));
+            
+            if (!polygonShape.outer().empty()) {
+                _pendingCuts.push_back(operation);
                 
-                cpSpaceBBQuery(_space->getSpace(), polygonShapeWorldBounds, _worldMaterial.filter, [](cpShape *collisionShape, void *data) {
+                // start right away if nothing's ahead of us, so the snapshot reflects the world at the time of the cut
+                updatePendingCuts();
+            } else {
+                CI_LOG_E("Either length and/or radius were below minimum thresholds");
+                operation->_state = CutOperation::COMMITTED;
+            }
+            
+            return operation;
+        }
+        
+        void World::prepareCut(const CutOperationRef &operation) {
+            
+            StopWatch timer;
+            operation->_clippingEngine = getClippingEngine();
+            operation->_items.clear();
+            
+            //
+            // perform a bounding box query for each polygon, and note which polygons overlap each shape
+            //
+            
+            map <ShapeRef, vector<size_t>> shapePolygons;
+            for (size_t i = 0, N = operation->_polygons.size(); i < N; i++) {
+                
+                if (!cpBBIsValid(operation->_polygonWorldBounds[i])) {
+                    operation->_polygonWorldBounds[i] = detail::polygon_bb(operation->_polygons[i]);
+                }
+                
+                cut_collector collector(_worldMaterial.filter, _worldMaterial.collisionType);
+                
+                cpSpaceBBQuery(_space->getSpace(), operation->_polygonWorldBounds[i], _worldMaterial.filter, [](cpShape *collisionShape, void *data) {
                     cut_collector *collector = static_cast<cut_collector *>(data);
                     if (cpShapeGetCollisionType(collisionShape) == collector->collisionType) {
                         Shape *terrainShapePtr = static_cast<Shape *>(cpShapeGetUserData(collisionShape));
@@ -414,58 +789,262 @@ namespace elements {
                     }
                 }, &collector);
                 
-                CI_LOG_D("Collected " << collector.shapes.size() << " shapes (" << collector.groups.size()
-                         << " groups) to cut");
+                for (const ShapeRef &shape : collector.shapes) {
+                    shapePolygons[shape].push_back(i);
+                }
+            }
+            
+            CI_LOG_D("Collected " << shapePolygons.size() << " shapes to cut by " << operation->_polygons.size() << " polygons");
+            
+            operation->_profile = cut_profile();
+            operation->_profile.polygons = operation->_polygons.size();
+            operation->_profile.shapesCut = shapePolygons.size();
+            operation->_profile.bbQuery = timer.mark();
+            
+            //
+            // snapshot each shape's model space geometry and transform, so computeCut never has to touch live shapes
+            //
+            
+            for (const auto &sp : shapePolygons) {
+                const ShapeRef &shape = sp.first;
+                
+                CutOperation::item item;
+                item.shape = shape;
+                item.polygons = sp.second;
+                item.parentGroup = shape->getGroup();
+                item.generation = shape->_generation;
+                item.isStatic = item.parentGroup == _staticGroup;
+                item.inverseModelMatrix = shape->getInverseModelMatrix();
+                item.outerContour = shape->_outerContour.model;
+                for (const auto &holeContour : shape->_holeContours) {
+                    item.holeContours.push_back(holeContour.model);
+                }
+                
+                operation->_items.push_back(item);
+            }
+            
+            operation->_profile.total = timer.mark();
+        }
+        
+        void World::computeCut(const CutOperationRef &operation, bool parallel) {
+            
+            //
+            //  Subtraction is pure geometry, so it can be fanned out across the thread pool. Results are left in the
+            //  parent group's model space, and commitCut moves them to world space using the parent's transform
+            //  at commit time. Static shapes live in world space so their results can be triangulated here as well,
+            //  and StaticGroup::addShape will reuse the trimesh. Dynamic groups re-center their shapes, so they
+            //  triangulate in build(). Only geometry is produced here; the Shapes are made in commitCut, so
+            //  World::nextId is never called from the pool and ids don't depend on how work was scheduled.
+            //
+            
+            const detail::clipper &clipper = detail::get_clipper(operation->_clippingEngine);
+            vector <CutOperation::item> &items = operation->_items;
+            
+            auto computeItem = [&](size_t i) {
+                CutOperation::item &item = items[i];
+                StopWatch timer;
                 
                 //
-                // Collect all shapes which are in groups affected by the cut,
-                // but NOT shapes which will be actually cut.
+                // when several polygons overlap this shape, union them so the shape is subtracted from once
+                // per disjoint region rather than once per polygon
                 //
                 
-                vector <ShapeRef> affectedShapes;
-                for (auto &group : collector.groups) {
-                    for (auto &shape : group->getShapes()) {
-                        if (collector.shapes.find(shape) == collector.shapes.end()) {
-                            affectedShapes.push_back(shape);
+                vector <dpolygon2> polygonsModelSpace;
+                for (size_t polygonIndex : item.polygons) {
+                    polygonsModelSpace.push_back(detail::transformed(operation->_polygons[polygonIndex], item.inverseModelMatrix));
+                }
+                
+                if (polygonsModelSpace.size() > 1) {
+                    polygonsModelSpace = detail::polygon_union(polygonsModelSpace);
+                }
+                
+                vector <detail::polyline_with_holes> plhs = { detail::polyline_with_holes(item.outerContour, item.holeContours) };
+                for (const auto &polygonModelSpace : polygonsModelSpace) {
+                    vector <detail::polyline_with_holes> remaining;
+                    for (const auto &plh : plhs) {
+                        const auto difference = clipper.difference(plh.contour, plh.holes, polygonModelSpace, dmat4(1));
+                        remaining.insert(remaining.end(), difference.begin(), difference.end());
+                    }
+                    plhs = remaining;
+                }
+                
+                item.results.clear();
+                for (const auto &plh : plhs) {
+                    item.results.push_back({ plh.contour, plh.holes, nullptr });
+                }
+                
+                item.subtractTime = timer.mark();
+                
+                if (item.isStatic) {
+                    timer.start();
+                    for (auto &r : item.results) {
+                        // as Shape::triangulate would, given an empty triangulation leaves the shape untriangulated
+                        r.trimesh = detail::triangulate(r.outerContour, r.holeContours);
+                        if (r.trimesh->getNumTriangles() == 0) {
+                            r.trimesh.reset();
                         }
                     }
+                    item.triangulateTime = timer.mark();
+                } else {
+                    item.triangulateTime = 0;
+                }
+            };
+            
+            StopWatch timer;
+            if (parallel) {
+                util::ThreadPool::shared().parallelFor(items.size(), computeItem);
+            } else {
+                for (size_t i = 0, N = items.size(); i < N; i++) {
+                    computeItem(i);
+                }
+            }
+            
+            operation->_profile.total += timer.mark();
+        }
+        
+        void World::commitCut(const CutOperationRef &operation) {
+            
+            StopWatch timer;
+            
+            //
+            //  If anything changed the shapes we snapshotted (culling, a dynamic group going static, a shape
+            //  being regrouped or cut away) the computed geometry is stale and we have to start over.
+            //
+            
+            bool isStale = false;
+            for (const auto &item : operation->_items) {
+                const GroupBaseRef group = item.shape->getGroup();
+                const bool groupIsLive = group && (group == _staticGroup || _dynamicGroups.find(dynamic_pointer_cast<DynamicGroup>(group)) != _dynamicGroups.end());
+                if (item.shape->_generation != item.generation || group != item.parentGroup || !groupIsLive) {
+                    isStale = true;
+                    break;
+                }
+            }
+            
+            if (isStale) {
+                CI_LOG_D("Cut snapshot is stale, recomputing");
+                prepareCut(operation);
+                computeCut(operation, _parallelCutting);
+            }
+            
+            //
+            // Collect all shapes which are in groups affected by the cut,
+            // but NOT shapes which will be actually cut.
+            //
+            
+            //
+            // start the world's profile from the operation's; build() accumulates grouping, collision shape and attachment timings into it
+            //
+            
+            _cutProfile = operation->_profile;
+            
+            set <ShapeRef> shapesToCut;
+            set <GroupBaseRef> groupsToCut;
+            for (const auto &item : operation->_items) {
+                shapesToCut.insert(item.shape);
+                groupsToCut.insert(item.parentGroup);
+                _cutProfile.subtract += item.subtractTime;
+                _cutProfile.triangulate += item.triangulateTime;
+                _cutProfile.shapesCreated += item.results.size();
+            }
+            
+            //
+            // dynamic groups are rebuilt whole, but the static group can be the entire planet. Only its shapes
+            // bordering the cut shapes can touch the new shapes, and those all intersect the cut shapes' bounds.
+            // build() searches the rest of the static group when it needs to know if a group is still anchored.
+            //
+            
+            cpBB staticCutBB = cpBBInvalid;
+            for (const auto &item : operation->_items) {
+                if (item.parentGroup == _staticGroup) {
+                    staticCutBB = cpBBExpand(staticCutBB, item.shape->getWorldSpaceContourEdgesBB());
+                }
+            }
+            
+            vector <ShapeRef> affectedShapes;
+            for (auto &group : groupsToCut) {
+                const set <ShapeRef> groupShapes = group == _staticGroup ? _staticGroup->findShapesIntersecting(staticCutBB) : group->getShapes();
+                for (auto &shape : groupShapes) {
+                    if (shapesToCut.find(shape) == shapesToCut.end()) {
+                        affectedShapes.push_back(shape);
+                    }
                 }
+            }
+            
+            //
+            //	Apply the cut, adding results to affectedShapes and assigning parentage
+            //	so we can apply lin/ang vel to new bodies.
+            //  While we're at it, gather all attachments which were "attached" to the shapes that were cut.
+            //  note: attachments are actually attached to groups, but they test validity
+            //  by being inside a particular shape.
+            //
+            
+            map <ShapeRef, GroupBaseRef> parentage;
+            vector <AttachmentRef> attachmentsToReparent;
+            for (auto &item : operation->_items) {
                 
-                //
-                //	Perform cut, adding results to affectedShapes and assigning parentage
-                //	so we can apply lin/ang vel to new bodies.
-                //  While we're at it, gather all attachments which were "attached" to the shapes that were cut.
-                //  note: attachments are actually attached to groups, but they test validity
-                //  by being inside a particular shape.
-                //
+                const ShapeRef &shapeToCut = item.shape;
+                const GroupBaseRef &parentGroup = item.parentGroup;
                 
-                map <ShapeRef, GroupBaseRef> parentage;
-                vector <AttachmentRef> attachmentsToReparent;
-                for (const ShapeRef &shapeToCut : collector.shapes) {
-                    
-                    GroupBaseRef parentGroup = shapeToCut->getGroup();
-                    
-                    auto result = shapeToCut->subtract(polygonShape);
-                    
-                    //
-                    // add newly generated shapes to the affected list
-                    //
-                    
-                    affectedShapes.insert(end(affectedShapes), begin(result), end(result));
+                vector <ShapeRef> result;
+                for (const auto &r : item.results) {
+                    result.push_back(make_shared<Shape>(r.outerContour, r.holeContours, r.trimesh));
+                }
+                
+                if (result.empty()) {
                     
-                    //
-                    // collect the attachments; they'll be reparented or orphaned in build()
-                    //
+                    // handle failure case, as Shape::subtract does
+                    result.push_back(shapeToCut);
                     
-                    copy(shapeToCut->_attachments.begin(), shapeToCut->_attachments.end(), back_inserter(attachmentsToReparent));
+                } else if (!item.isStatic) {
                     
                     //
-                    //	Update parentage map for use in build() - maps a shape to its previous parent group
+                    // move new shapes from the parent group's model space to world space
                     //
                     
+                    const dmat4 modelMatrix = parentGroup->getModelMatrix();
                     for (auto &newShape : result) {
-                        parentage[newShape] = parentGroup;
+                        detail::transform(newShape->_outerContour.world, modelMatrix);
+                        newShape->_outerContour.model = newShape->_outerContour.world;
+                        
+                        for (auto &holeContour : newShape->_holeContours) {
+                            detail::transform(holeContour.world, modelMatrix);
+                            holeContour.model = holeContour.world;
+                        }
+                        
+                        newShape->_worldSpaceShapeContourEdgesDirty = true;
                     }
+                }
+                
+                //
+                // add newly generated shapes to the affected list
+                //
+                
+                affectedShapes.insert(end(affectedShapes), begin(result), end(result));
+                
+                //
+                // collect the attachments; they'll be reparented or orphaned in build()
+                //
+                
+                copy(shapeToCut->_attachments.begin(), shapeToCut->_attachments.end(), back_inserter(attachmentsToReparent));
+                
+                //
+                //	Update parentage map for use in build() - maps a shape to its previous parent group
+                //
+                
+                for (auto &newShape : result) {
+                    parentage[newShape] = parentGroup;
+                }
+                
+                //
+                // if the shape belonged to the static group, just remove it; the static group's
+                // remaining shapes stay put and build() only touches the ones which change.
+                // otherwise, remove the shape's dynamic parent group because we'll be rebuilding it completely in build()
+                //
+                
+                if (parentGroup == _staticGroup) {
+                    _staticGroup->removeShape(shapeToCut);
+                } else {
                     
                     //
                     //	Release the parent group's shapes. we do this because the group's
@@ -475,39 +1054,100 @@ namespace elements {
                     //
                     
                     parentGroup->releaseShapes();
+                    _dynamicGroups.erase(dynamic_pointer_cast<DynamicGroup>(parentGroup));
+                }
+            }
+            
+            // let go of strong references
+            operation->_items.clear();
+            shapesToCut.clear();
+            groupsToCut.clear();
+            
+            // temporarily adjust the min surface area for shape generation
+            double msa = _worldMaterial.minSurfaceArea;
+            _worldMaterial.minSurfaceArea = operation->_minSurfaceArea > 0 ? operation->_minSurfaceArea : msa;
+            
+            build(affectedShapes, parentage, attachmentsToReparent);
+            
+            _worldMaterial.minSurfaceArea = msa;
+            operation->_state = CutOperation::COMMITTED;
+            
+            _cutProfile.total += timer.mark();
+        }
+        
+        void World::updatePendingCuts() {
+            while (!_pendingCuts.empty()) {
+                CutOperationRef operation = _pendingCuts.front();
+                
+                if (operation->_state == CutOperation::PENDING) {
+                    prepareCut(operation);
+                    operation->_state = CutOperation::COMPUTING;
                     
-                    //
-                    // if the shape belonged to the static group, just remove it
-                    // otherwise, remove the shape's dynamic parent group because
-                    // we'll be rebuilding it completely in build()
-                    //
-                    
-                    if (parentGroup == _staticGroup) {
-                        _staticGroup->removeShape(shapeToCut);
-                    } else {
-                        _dynamicGroups.erase(dynamic_pointer_cast<DynamicGroup>(parentGroup));
-                    }
+                    const bool parallel = _parallelCutting;
+                    util::ThreadPool::shared().enqueue([operation, parallel]() {
+                        claimAndComputeCut(operation, parallel);
+                    });
                 }
                 
+                // a pool without workers will have computed the cut before enqueue returned
+                if (!operation->_computed) {
+                    return;
+                }
                 
-                // let go of strong references
-                collector.clear();
+                {
+                    auto sw = core::StopWatch("World::cutAsync - commit");
+                    commitCut(operation);
+                }
                 
-                // temporarily adjust the min surface area for shape generation
-                double msa = _worldMaterial.minSurfaceArea;
-                _worldMaterial.minSurfaceArea = minSurfaceArea > 0 ? minSurfaceArea : msa;
+                _pendingCuts.pop_front();
+            }
+        }
+        
+        void World::claimAndComputeCut(const CutOperationRef &operation, bool parallel) {
+            if (!operation->_claimed.exchange(true)) {
+                computeCut(operation, parallel);
                 
-                build(affectedShapes, parentage, attachmentsToReparent);
+                std::lock_guard<std::mutex> lock(operation->_computedMutex);
+                operation->_computed = true;
+                operation->_computedCondition.notify_all();
+            }
+        }
+        
+        void World::waitForComputedCut(const CutOperationRef &operation) {
+            std::unique_lock<std::mutex> lock(operation->_computedMutex);
+            operation->_computedCondition.wait(lock, [&operation]() {
+                return operation->_computed.load();
+            });
+        }
+        
+        void World::flushPendingCuts() {
+            while (!_pendingCuts.empty()) {
+                CutOperationRef operation = _pendingCuts.front();
                 
-                _worldMaterial.minSurfaceArea = msa;
+                if (operation->_state == CutOperation::PENDING) {
+                    prepareCut(operation);
+                    operation->_state = CutOperation::COMPUTING;
+                }
                 
-            } else {
-                CI_LOG_E("Either length and/or radius were below minimum thresholds");
+                // if no worker has started the cut, run it here rather than wait for one to
+                claimAndComputeCut(operation, _parallelCutting);
+                waitForComputedCut(operation);
+                
+                {
+                    auto sw = core::StopWatch("World::cutAsync - commit");
+                    commitCut(operation);
+                }
+                
+                _pendingCuts.pop_front();
             }
         }
         
         void World::draw(const render_state &renderState) {
             
+            if (!_graphicsEnabled) {
+                return;
+            }
+            
             _drawDispatcher.cull(renderState);
             _drawDispatcher.draw(renderState, _shader);
             
@@ -621,6 +1261,8 @@ namespace elements {
         
         void World::update(const time_state &timeState) {
             
+            updatePendingCuts();
+            
             if (_staticGroup) {
                 _staticGroup->update(timeState);
             }
@@ -860,10 +1502,34 @@ namespace elements {
             // while building new groups, collect any attachments from the old groups, and re-insert after we're done.
             //
             
+            StopWatch timer;
             auto shapeGroups = findShapeGroups(affectedShapes, parentage);
+            _cutProfile.grouping += timer.mark();
+            
+            //
+            // a cut only regroups the static shapes near it (see commitCut), so a group which was static but doesn't
+            // overlap an anchor itself may still reach one through the rest of the static group. the new shapes which
+            // aren't in the static group's index have to be searched too.
+            //
+            
+            vector <ShapeRef> unindexedStaticShapes;
+            if (!parentage.empty()) {
+                for (const auto &shape : affectedShapes) {
+                    auto pos = parentage.find(shape);
+                    if (!shape->getGroup() && pos != parentage.end() && pos->second == _staticGroup) {
+                        unindexedStaticShapes.push_back(shape);
+                    }
+                }
+            }
             
+            set <ShapeRef> anchoredShapes, claimedShapes;
             for (const auto &shapeGroup : shapeGroups) {
                 
+                // an earlier group's island may have swallowed this one
+                if (claimedShapes.find(*shapeGroup.begin()) != claimedShapes.end()) {
+                    continue;
+                }
+                
                 // find parent
                 GroupBaseRef parentGroup;
                 if (!parentage.empty()) {
@@ -876,7 +1542,16 @@ namespace elements {
                     }
                 }
                 
-                if (isShapeGroupStatic(shapeGroup, parentGroup)) {
+                bool isStatic = isShapeGroupStatic(shapeGroup, parentGroup);
+                set <ShapeRef> island;
+                if (!isStatic && !parentage.empty() && (!parentGroup || parentGroup == _staticGroup)) {
+                    isStatic = isShapeGroupAnchoredThroughStaticGroup(shapeGroup, unindexedStaticShapes, anchoredShapes, island);
+                    claimedShapes.insert(island.begin(), island.end());
+                } else if (isStatic) {
+                    anchoredShapes.insert(shapeGroup.begin(), shapeGroup.end());
+                }
+                
+                if (isStatic) {
                     
                     //
                     //	 Add these shapes to the singleton static group
@@ -894,11 +1569,13 @@ namespace elements {
                 } else {
                     
                     //
-                    //	This cut promoted static shapes to dynamic - got to remove them from _staticGroup
+                    //	This cut promoted static shapes to dynamic - got to remove them from _staticGroup.
+                    //  If the anchor search ran, the island it visited is the whole of the new group.
                     //
                     
-                    if (parentGroup == _staticGroup) {
-                        for (const auto &shape : shapeGroup) {
+                    const set <ShapeRef> &dynamicShapes = island.empty() ? shapeGroup : island;
+                    for (const auto &shape : dynamicShapes) {
+                        if (shape->getGroup() == _staticGroup) {
                             _staticGroup->removeShape(shape);
                         }
                     }
@@ -920,7 +1597,7 @@ namespace elements {
                     //
                     
                     DynamicGroupRef group = make_shared<DynamicGroup>(shared_from_this(), _worldMaterial, _drawDispatcher);
-                    if (group->build(shapeGroup, parentGroup, _worldMaterial.minSurfaceArea)) {
+                    if (group->build(dynamicShapes, parentGroup, _worldMaterial.minSurfaceArea)) {
                         _dynamicGroups.insert(group);
                     }
                 }
@@ -929,6 +1606,7 @@ namespace elements {
             //
             // now re-parent all affected attachments
             //
+            timer.start();
             for (auto &attachment : attachmentsToReparent) {
                 
                 const dvec2 position = attachment->getWorldPosition();
@@ -962,31 +1640,17 @@ namespace elements {
                     }
                 }
             }
+            _cutProfile.attachments += timer.mark();
         }
         
         vector <set<ShapeRef>> World::findShapeGroups(const vector <ShapeRef> &affectedShapes, const map <ShapeRef, GroupBaseRef> &parentage) {
             
             //
-            // for each shape in affectedShapes, use floodfill to find connected shapes.
-            // these neighbors all go into a new group, and get removed from the affectedShapes set
+            // partition affectedShapes into groups of connected shapes of common parentage.
             // note: A singleton shape (no neighbors) still becomes a group
             //
             
-            set <ShapeRef> affectedShapesSet(affectedShapes.begin(), affectedShapes.end());
-            vector <set<ShapeRef>> shapeGroups;
-            
-            while (!affectedShapesSet.empty()) {
-                ShapeRef shape = *affectedShapesSet.begin(); // grab one
-                
-                set <ShapeRef> group = detail::find_contact_group(shape, affectedShapesSet, parentage);
-                for (auto groupedShape : group) {
-                    affectedShapesSet.erase(groupedShape);
-                }
-                
-                shapeGroups.push_back(group);
-            }
-            
-            return shapeGroups;
+            return detail::find_contact_groups(affectedShapes, parentage);
         }
         
         bool World::isShapeGroupStatic(const set <ShapeRef> shapeGroup, const GroupBaseRef &parentGroup) {
@@ -996,27 +1660,35 @@ namespace elements {
             
             if (!parentGroup || parentGroup == _staticGroup) {
                 for (auto &shape : shapeGroup) {
-                    for (auto &anchor : _anchors) {
-                        if (cpBBIntersects(anchor->getBB(), shape->getWorldSpaceContourEdgesBB())) {
-                            
-                            const PolyLine2d &shapeContour = shape->getOuterContour().world;
-                            const PolyLine2d &anchorContour = anchor->getContour();
-                            
-                            //
-                            // check if the anchor overlaps the shape's outer contour
-                            //
-                            
-                            for (auto p : anchorContour.getPoints()) {
-                                if (shapeContour.contains(p)) {
-                                    return true;
-                                }
-                            }
-                            
-                            for (auto p : shapeContour.getPoints()) {
-                                if (anchorContour.contains(p)) {
-                                    return true;
-                                }
-                            }
+                    if (isShapeAnchored(shape)) {
+                        return true;
+                    }
+                }
+            }
+            
+            return false;
+        }
+        
+        bool World::isShapeAnchored(const ShapeRef &shape) const {
+            for (auto &anchor : _anchors) {
+                if (cpBBIntersects(anchor->getBB(), shape->getWorldSpaceContourEdgesBB())) {
+                    
+                    const PolyLine2d &shapeContour = shape->getOuterContour().world;
+                    const PolyLine2d &anchorContour = anchor->getContour();
+                    
+                    //
+                    // check if the anchor overlaps the shape's outer contour
+                    //
+                    
+                    for (auto p : anchorContour.getPoints()) {
+                        if (shapeContour.contains(p)) {
+                            return true;
+                        }
+                    }
+                    
+                    for (auto p : shapeContour.getPoints()) {
+                        if (anchorContour.contains(p)) {
+                            return true;
                         }
                     }
                 }
@@ -1025,6 +1697,72 @@ namespace elements {
             return false;
         }
         
+        bool World::isShapeGroupAnchoredThroughStaticGroup(const set <ShapeRef> &shapeGroup, const vector <ShapeRef> &unindexedShapes, set <ShapeRef> &anchoredShapes, set <ShapeRef> &island) {
+            
+            //
+            // best-first search outward from shapeGroup over shapes sharing edges, always expanding the shape
+            // nearest an anchor. A group still joined to the static group usually finds an anchored shape after
+            // visiting little more than the shapes between it and the anchor; a severed island is visited whole,
+            // which is needed anyway since all of it becomes dynamic.
+            //
+            
+            vector <cpVect> anchorCenters;
+            for (const auto &anchor : _anchors) {
+                anchorCenters.push_back(cpBBCenter(anchor->getBB()));
+            }
+            
+            auto distanceToAnchor = [&anchorCenters](const ShapeRef &shape) {
+                const cpVect center = cpBBCenter(shape->getWorldSpaceContourEdgesBB());
+                double distance = numeric_limits<double>::max();
+                for (const auto &anchorCenter : anchorCenters) {
+                    distance = min(distance, cpvdistsq(center, anchorCenter));
+                }
+                return distance;
+            };
+            
+            typedef pair<double, ShapeRef> candidate;
+            priority_queue<candidate, vector<candidate>, greater<candidate>> candidates;
+            set <ShapeRef> visited;
+            for (const auto &shape : shapeGroup) {
+                visited.insert(shape);
+                candidates.emplace(distanceToAnchor(shape), shape);
+            }
+            
+            while (!candidates.empty()) {
+                const ShapeRef shape = candidates.top().second;
+                candidates.pop();
+                
+                // shapeGroup's own shapes were already tested by isShapeGroupStatic
+                if (anchoredShapes.find(shape) != anchoredShapes.end() || (shapeGroup.find(shape) == shapeGroup.end() && isShapeAnchored(shape))) {
+                    anchoredShapes.insert(visited.begin(), visited.end());
+                    return true;
+                }
+                
+                //
+                // neighbors are the static group's shapes, and the new shapes from this cut which haven't
+                // been added to it (yet), which share an edge with this one
+                //
+                
+                const cpBB bb = shape->getWorldSpaceContourEdgesBB();
+                set <ShapeRef> neighbors = _staticGroup->findShapesIntersecting(bb);
+                for (const auto &unindexedShape : unindexedShapes) {
+                    if (cpBBIntersects(bb, unindexedShape->getWorldSpaceContourEdgesBB())) {
+                        neighbors.insert(unindexedShape);
+                    }
+                }
+                
+                for (const auto &neighbor : neighbors) {
+                    if (visited.find(neighbor) == visited.end() && detail::shared_edges(shape, neighbor)) {
+                        visited.insert(neighbor);
+                        candidates.emplace(distanceToAnchor(neighbor), neighbor);
+                    }
+                }
+            }
+            
+            island = visited;
+            return false;
+        }
+        
 #pragma mark - Attachment
         
         Attachment::Attachment():
@@ -1140,6 +1878,7 @@ namespace elements {
         /*
          cpBody *_body;
          set<ShapeRef> _shapes;
+         cpSpatialIndex *_index;
          mutable cpBB _worldBB;
          double _surfaceArea;
          */
@@ -1147,6 +1886,7 @@ namespace elements {
         StaticGroup::StaticGroup(WorldRef world, material m, DrawDispatcher &dispatcher) :
         terrain::GroupBase(world, m, dispatcher),
         _body(nullptr),
+        _index(cpBBTreeNew(objectBBFunc, NULL)),
         _worldBB(cpBBInvalid),
         _surfaceArea(0) {
             _name = "StaticGroup";
@@ -1157,15 +1897,19 @@ namespace elements {
         
         StaticGroup::~StaticGroup() {
             releaseShapes();
+            cpSpatialIndexFree(_index);
             cpCleanupAndFree(_body);
         }
         
         cpBB StaticGroup::getBB() const {
+            //
+            //  _worldBB is expanded as shapes are added, and only invalidated when a removed
+            //  shape touched its boundary. In that rare case we rebuild it from the index.
+            //
+            
             if (!cpBBIsValid(_worldBB)) {
                 cpBB worldBB = cpBBInvalid;
-                for (auto shape : _shapes) {
-                    worldBB = cpBBExpand(worldBB, shape->getWorldSpaceContourEdgesBB());
-                }
+                cpSpatialIndexEach(_index, expandBBIterator, &worldBB);
                 _worldBB = worldBB;
             }
             
@@ -1173,9 +1917,10 @@ namespace elements {
         }
         
         void StaticGroup::releaseShapes() {
-            // remove shapes from draw dispatcher
+            // remove shapes from draw dispatcher and our index
             for (auto &shape : _shapes) {
                 _drawDispatcher.remove(shape);
+                cpSpatialIndexRemove(_index, shape.get(), getCPHashValue(shape));
             }
             _shapes.clear();
             _worldBB = cpBBInvalid;
@@ -1184,20 +1929,36 @@ namespace elements {
         ShapeRef StaticGroup::findShapeContainingLocalPoint(const dvec2 lp) const {
             // note: StaticGroup is always in world space so we can treat local == world
             if (cpBBContainsVect(getBB(), cpv(lp))) {
-                for (auto &shape : _shapes) {
-                    if (shape->isLocalPointInside(lp)) {
-                        return shape;
-                    }
-                }
+                point_query query = { lp, nullptr };
+                cpSpatialIndexQuery(_index, nullptr, cpBBNewForCircle(cpv(lp), 0), shapeContainingPointCollector, &query);
+                return query.shape;
             }
             
             return nullptr;
         }
         
+        set <ShapeRef> StaticGroup::findShapesIntersecting(cpBB bb) const {
+            set <ShapeRef> shapes;
+            if (cpBBIsValid(bb)) {
+                cpSpatialIndexQuery(_index, nullptr, bb, shapeCollector, &shapes);
+            }
+            return shapes;
+        }
+        
         void StaticGroup::addShape(ShapeRef shape, double minShapeArea) {
             
+            // shapes which stayed static across a cut are already fully set up
+            if (_shapes.find(shape) != _shapes.end()) {
+                return;
+            }
+            
+            const WorldRef world = getWorld();
+            StopWatch timer;
+            
             if (!shape->hasValidTriMesh()) {
-                if (!shape->triangulate()) {
+                const bool triangulated = shape->triangulate();
+                world->_cutProfile.triangulate += timer.mark();
+                if (!triangulated) {
                     return;
                 }
             }
@@ -1223,7 +1984,9 @@ namespace elements {
                     vector < cpShape * > collisionShapes = shape->getShapes(modelBB);
                     bool didCreateNewShapes = false;
                     if (collisionShapes.empty()) {
-                        collisionShapes = shape->createCollisionShapes(_body, modelBB, getMaterial().collisionShapeRadius);
+                        timer.start();
+                        collisionShapes = shape->createCollisionShapes(_body, modelBB, getMaterial());
+                        world->_cutProfile.collisionShapes += timer.mark();
                         didCreateNewShapes = true;
                     }
                     
@@ -1237,7 +2000,13 @@ namespace elements {
                     
                     
                     if (!collisionShapes.empty() && cpBBIsValid(modelBB)) {
-                        _worldBB = cpBBExpand(_worldBB, modelBB);
+                        
+                        // if _worldBB is invalid it will be rebuilt from the index on demand, so don't expand it here
+                        if (cpBBIsValid(_worldBB) || _shapes.size() == 1) {
+                            _worldBB = cpBBExpand(_worldBB, modelBB);
+                        }
+                        
+                        cpSpatialIndexInsert(_index, shape.get(), getCPHashValue(shape));
                         
                         if (didCreateNewShapes) {
                             for (cpShape *collisionShape : collisionShapes) {
@@ -1260,8 +2029,18 @@ namespace elements {
         
         void StaticGroup::removeShape(ShapeRef shape) {
             if (_shapes.erase(shape)) {
+                
+                //
+                //  Removing a shape only shrinks our bounds if it touched them
+                //
+                
+                const cpBB shapeBB = shape->getBB();
+                cpSpatialIndexRemove(_index, shape.get(), getCPHashValue(shape));
+                if (cpBBIsValid(_worldBB) && !(shapeBB.l > _worldBB.l && shapeBB.r < _worldBB.r && shapeBB.b > _worldBB.b && shapeBB.t < _worldBB.t)) {
+                    _worldBB = cpBBInvalid;
+                }
+                
                 shape->setGroup(nullptr);
-                _worldBB = cpBBInvalid;
                 _surfaceArea -= shape->getSurfaceArea();
                 
                 //
@@ -1454,12 +2233,17 @@ namespace elements {
             //	Triangulate - any which fail should be collected to garbage
             //
             
+            const WorldRef world = getWorld();
+            StopWatch timer;
+            
             for (auto &shape : shapes) {
                 if (!shape->triangulate()) {
                     garbage.insert(shape);
                 }
             }
             
+            world->_cutProfile.triangulate += timer.mark();
+            
             emptyGarbage();
             
             //
@@ -1492,8 +2276,10 @@ namespace elements {
                     
                     // destroy any lingering collision shapes from previous tessellations and build new shapes
                     
+                    timer.start();
                     shape->destroyCollisionShapes();
-                    vector < cpShape * > collisionShapes = shape->createCollisionShapes(_body, modelBB, getMaterial().collisionShapeRadius);
+                    vector < cpShape * > collisionShapes = shape->createCollisionShapes(_body, modelBB, getMaterial());
+                    world->_cutProfile.collisionShapes += timer.mark();
                     
                     if (!collisionShapes.empty() && cpBBIsValid(modelBB)) {
                         _modelBB = cpBBExpand(_modelBB, modelBB);
@@ -1604,6 +2390,7 @@ namespace elements {
         /*
          size_t _id;
          WorldWeakRef _world;
+         mutable gl::VboMeshRef _vboMesh;
          */
         
         Drawable::Drawable() :
@@ -1613,6 +2400,16 @@ namespace elements {
         Drawable::~Drawable() {
         }
         
+        const gl::VboMeshRef &Drawable::getVboMesh() const {
+            if (!_vboMesh) {
+                const TriMeshRef &trimesh = getTriMesh();
+                if (trimesh && trimesh->getNumTriangles() > 0) {
+                    _vboMesh = gl::VboMesh::create(*trimesh);
+                }
+            }
+            return _vboMesh;
+        }
+        
         void Drawable::setWorld(WorldRef w) {
             _world = w;
         }
@@ -1633,7 +2430,6 @@ namespace elements {
          cpBB _bb;
          string _id;
          TriMeshRef _trimesh;
-         gl::VboMeshRef _vboMesh;
          */
         Element::Element(string id, const PolyLine2d &contour) :
         _bb(cpBBInvalid),
@@ -1645,12 +2441,7 @@ namespace elements {
             }
             _bb = bb;
             
-            Triangulator triangulator;
-            triangulator.addPolyLine(detail::polyline2d_to_2f(contour));
-            _trimesh = triangulator.createMesh();
-            if (_trimesh->getNumTriangles() > 0) {
-                _vboMesh = gl::VboMesh::create(*_trimesh);
-            }
+            _trimesh = detail::triangulate(contour);
         }
         
         Element::~Element() {
@@ -1689,7 +2480,6 @@ namespace elements {
          PolyLine2d _contour;
          
          TriMeshRef _trimesh;
-         gl::VboMeshRef _vboMesh;
          */
         
         Anchor::Anchor(const PolyLine2d &contour) :
@@ -1703,12 +2493,20 @@ namespace elements {
             }
             _bb = bb;
             
-            Triangulator triangulator;
-            triangulator.addPolyLine(detail::polyline2d_to_2f(_contour));
-            _trimesh = triangulator.createMesh();
-            if (_trimesh->getNumTriangles() > 0) {
-                _vboMesh = gl::VboMesh::create(*_trimesh);
+            _trimesh = detail::triangulate(_contour);
+        }
+        
+        Anchor::Anchor(const PolyLine2d &contour, const TriMeshRef &trimesh) :
+        _staticBody(nullptr),
+        _bb(cpBBInvalid),
+        _contour(contour),
+        _trimesh(trimesh) {
+            
+            cpBB bb = cpBBInvalid;
+            for (auto &p : _contour.getPoints()) {
+                bb = cpBBExpand(bb, p);
             }
+            _bb = bb;
         }
         
         Anchor::~Anchor() {
@@ -1730,27 +2528,10 @@ namespace elements {
             _staticBody = cpBodyNewStatic();
             
             double areaSum = 0;
-            cpVect triangle[3];
-            for (size_t i = 0, N = _trimesh->getNumTriangles(); i < N; i++) {
-                vec2 a, b, c;
-                _trimesh->getTriangleVertices(i, &a, &b, &c);
-                triangle[0] = cpv(a);
-                triangle[1] = cpv(b);
-                triangle[2] = cpv(c);
-                
-                double area = cpAreaForPoly(3, triangle, 0);
-                if (area < 0) {
-                    triangle[0] = cpv(c);
-                    triangle[1] = cpv(b);
-                    triangle[2] = cpv(a);
-                    area = cpAreaForPoly(3, triangle, 0);
-                }
-                
-                if (area >= MIN_TRIANGLE_AREA) {
-                    _shapes.push_back(cpPolyShapeNew(_staticBody, 3, triangle, cpTransformIdentity, 0));
-                    areaSum += area;
-                }
-            }
+            for_each_collision_polygon(*_trimesh, _material.convexDecomposition, [&](const cpVect *verts, int count, double area) {
+                _shapes.push_back(cpPolyShapeNew(_staticBody, count, verts, cpTransformIdentity, 0));
+                areaSum += area;
+            });
             
             if (areaSum >= _material.minSurfaceArea && !_shapes.empty()) {
                 
@@ -1826,12 +2607,13 @@ namespace elements {
          GroupBaseWeakRef _group;
          size_t _groupDrawingBatchId;
          cpHashValue _groupHash;
+         size_t _generation;
          
          unordered_set<poly_edge> _worldSpaceContourEdges;
          cpBB _worldSpaceContourEdgesBB;
          
          TriMeshRef _trimesh;
-         gl::VboMeshRef _vboMesh;
+         shared_ptr<detail::triangle_grid> _triangleGrid;
          */
         
         
@@ -1841,6 +2623,7 @@ namespace elements {
         _modelCentroid(0, 0),
         _groupDrawingBatchId(0),
         _groupHash(0),
+        _generation(0),
         _worldSpaceContourEdgesBB(cpBBInvalid) {
             detail::wind_clockwise(_outerContour.world);
         }
@@ -1851,6 +2634,7 @@ namespace elements {
         _modelCentroid(0, 0),
         _groupDrawingBatchId(0),
         _groupHash(0),
+        _generation(0),
         _worldSpaceContourEdgesBB(cpBBInvalid) {
             
             for (const auto &hc : hcs) {
@@ -1863,6 +2647,11 @@ namespace elements {
             }
         }
         
+        Shape::Shape(const PolyLine2d &sc, const std::vector<PolyLine2d> &hcs, const TriMeshRef &trimesh) :
+        Shape(sc, hcs) {
+            _trimesh = trimesh;
+        }
+        
         Shape::~Shape() {
             destroyCollisionShapes();
             _group.reset();
@@ -1892,23 +2681,26 @@ namespace elements {
                 dpolygon2 polygonToSubtractModelSpace = detail::transformed(polygonToSubtract, getInverseModelMatrix());
                 
                 //
-                // convert self (outerContour & holeContours) to a boost poly in model space
+                // now subtract - the clipper consumes our model space contours directly, and applies
+                // our modelview to the results to move them back to world space
                 //
                 
-                dpolygon2 thisPolyModelSpace = detail::shape_to_dpolygon2(const_cast<Shape *>(this)->shared_from_this_as<Shape>());
-                
-                //
-                // now subtract - results are in model space
-                //
+                vector <PolyLine2d> holeModelContours;
+                for (const auto &holeContour : _holeContours) {
+                    holeModelContours.push_back(holeContour.model);
+                }
                 
-                std::vector<dpolygon2> output;
-                boost::geometry::difference(thisPolyModelSpace, polygonToSubtractModelSpace, output);
+                const detail::clipper &clipper = detail::get_clipper(World::getClippingEngine());
+                const auto plhs = clipper.difference(_outerContour.model, holeModelContours, polygonToSubtractModelSpace, getModelMatrix());
                 
                 //
-                // convert output to Shapes - they need to have our modelview applied to them to move them back to world space
+                // convert output to Shapes
                 //
                 
-                vector <ShapeRef> newShapes = detail::dpolygon2_to_shape(output, getModelMatrix());
+                vector <ShapeRef> newShapes;
+                for (const auto &plh : plhs) {
+                    newShapes.push_back(make_shared<Shape>(plh.contour, plh.holes));
+                }
                 
                 if (!newShapes.empty()) {
                     return newShapes;
@@ -1928,23 +2720,10 @@ namespace elements {
             }
             
             if (cpBBContains(_shapesModelBB, cpv(localPoint))) {
-                // now we want to walk each triangle and test this point
-                const float epsilon = 1e-4;
-                for (size_t i = 0, N = _trimesh->getNumTriangles(); i < N; i++) {
-                    vec2 a, b, c;
-                    _trimesh->getTriangleVertices(i, &a, &b, &c);
-                    
-                    // barycentric coordinate test
-                    // https://stackoverflow.com/questions/13300904/determine-whether-point-lies-inside-triangle
-                    
-                    float alpha = ((b.y - c.y)*(localPoint.x - c.x) + (c.x - b.x)*(localPoint.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
-                    float beta = ((c.y - a.y)*(localPoint.x - c.x) + (a.x - c.x)*(localPoint.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
-                    float gamma = 1.0f - alpha - beta;
-                    
-                    if (alpha > -epsilon && beta > -epsilon && gamma > -epsilon) {
-                        return true;
-                    }
+                if (!_triangleGrid) {
+                    _triangleGrid = make_shared<detail::triangle_grid>(*_trimesh);
                 }
+                return _triangleGrid->contains(localPoint);
             }
             
             return false;
@@ -2017,6 +2796,7 @@ namespace elements {
         
         void Shape::setGroup(GroupBaseRef group) {
             _group = group;
+            _generation++;
             if (group) {
                 _groupDrawingBatchId = group->getDrawingBatchId();
                 _groupHash = group->getHash();
@@ -2032,18 +2812,17 @@ namespace elements {
             // note that when a shape is static, its world and model contours are the same
             //
             
-            Triangulator triangulator;
-            triangulator.addPolyLine(detail::polyline2d_to_2f(_outerContour.model));
-            
-            for (auto holeContour : _holeContours) {
-                triangulator.addPolyLine(detail::polyline2d_to_2f(holeContour.model));
+            vector<PolyLine2d> holeContours;
+            holeContours.reserve(_holeContours.size());
+            for (const auto &holeContour : _holeContours) {
+                holeContours.push_back(holeContour.model);
             }
             
-            _trimesh = triangulator.createMesh();
-            const size_t numTriangles = _trimesh->getNumTriangles();
+            _trimesh = detail::triangulate(_outerContour.model, holeContours);
+            _triangleGrid.reset();
+            releaseVboMesh();
             
-            if (numTriangles > 0) {
-                _vboMesh = gl::VboMesh::create(*_trimesh);
+            if (_trimesh->getNumTriangles() > 0) {
                 return true;
             }
             
@@ -2110,38 +2889,21 @@ namespace elements {
             _shapes.clear();
         }
         
-        const vector<cpShape *> &Shape::createCollisionShapes(cpBody *body, cpBB &modelBB, double collisionShapeRadius) {
+        const vector<cpShape *> &Shape::createCollisionShapes(cpBody *body, cpBB &modelBB, const material &m) {
             CI_ASSERT_MSG(_shapes.empty(), "Can't call createCollisionShapes on a Shape more than once. Always call destroyCollisionShapes first");
             
             cpBB bb = cpBBInvalid;
-            cpVect triangle[3];
             
-            for (size_t i = 0, N = _trimesh->getNumTriangles(); i < N; i++) {
-                vec2 a, b, c;
-                _trimesh->getTriangleVertices(i, &a, &b, &c);
-                triangle[0] = cpv(a);
-                triangle[1] = cpv(b);
-                triangle[2] = cpv(c);
+            for_each_collision_polygon(*_trimesh, m.convexDecomposition, [&](const cpVect *verts, int count, double area) {
+                cpShape *polyShape = cpPolyShapeNew(body, count, verts, cpTransformIdentity, m.collisionShapeRadius);
+                cpShapeSetUserData(polyShape, this);
+                _shapes.push_back(polyShape);
                 
-                double area = cpAreaForPoly(3, triangle, 0);
-                if (area < 0) {
-                    triangle[0] = cpv(c);
-                    triangle[1] = cpv(b);
-                    triangle[2] = cpv(a);
-                    area = cpAreaForPoly(3, triangle, 0);
+                // verts are in model space
+                for (int i = 0; i < count; i++) {
+                    bb = cpBBExpand(bb, verts[i]);
                 }
-                
-                if (area >= MIN_TRIANGLE_AREA) {
-                    cpShape *polyShape = cpPolyShapeNew(body, 3, triangle, cpTransformIdentity, collisionShapeRadius);
-                    cpShapeSetUserData(polyShape, this);
-                    _shapes.push_back(polyShape);
-                    
-                    // a,b, & c are in model space
-                    bb = cpBBExpand(bb, a);
-                    bb = cpBBExpand(bb, b);
-                    bb = cpBBExpand(bb, c);
-                }
-            }
+            });
             
             if (PERIMETER_SEGMENT_RADIUS > 0) {
                 
@@ -12,9 +12,16 @@
 #include <cinder/app/App.h>
 #include <boost/functional/hash.hpp>
 #include <unordered_set>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include "core/Core.hpp"
 #include "core/Signals.hpp"
+#include "elements/Terrain/TerrainDetail_DrawBatching.hpp"
+#include "elements/Terrain/TerrainDetail_Triangulation.hpp"
 
 namespace elements {
     namespace terrain {
@@ -40,6 +47,8 @@ namespace elements {
         
         SMART_PTR(Attachment);
         
+        SMART_PTR(CutOperation);
+        
         /**
          Edges whos vertices are within 1/POLY_EDGE_PRECISION distance of eachother are considered congruent, and thus snapped.
          */
@@ -134,6 +143,10 @@ namespace elements {
             double minSurfaceArea;
             Color color;
             
+            // if true, collision shapes are convex polygons merged from the triangulation rather than one per triangle,
+            // which puts fewer shapes in the space
+            bool convexDecomposition;
+            
             material() :
             density(1),
             friction(1),
@@ -141,17 +154,19 @@ namespace elements {
             filter({0, 0, 0}),
             collisionType(0),
             minSurfaceArea(0.1),
-            color(0.2, 0.2, 0.2) {
+            color(0.2, 0.2, 0.2),
+            convexDecomposition(false) {
             }
             
-            material(cpFloat d, cpFloat f, cpFloat csr, cpShapeFilter flt, cpCollisionType ct, double msa, Color c) :
+            material(cpFloat d, cpFloat f, cpFloat csr, cpShapeFilter flt, cpCollisionType ct, double msa, Color c, bool cd = false) :
             density(d),
             friction(f),
             collisionShapeRadius(csr),
             filter(flt),
             collisionType(ct),
             minSurfaceArea(msa),
-            color(c) {
+            color(c),
+            convexDecomposition(cd) {
             }
             
             material(const material &c) :
@@ -161,7 +176,8 @@ namespace elements {
             filter(c.filter),
             collisionType(c.collisionType),
             minSurfaceArea(c.minSurfaceArea),
-            color(c.color) {
+            color(c.color),
+            convexDecomposition(c.convexDecomposition) {
             }
         };
         
@@ -196,6 +212,24 @@ namespace elements {
             
             void draw(const core::render_state &, const gl::GlslProgRef &shader);
             
+            /**
+             Pack the visible drawables' triangles, transformed to world space with their colors baked in,
+             into `backend and draw them with a single draw call. Used by draw() when batching is enabled.
+             */
+            void drawBatched(const core::render_state &, detail::draw_batch_backend &backend);
+            
+            /**
+             When enabled, draw() submits all visible drawables with one draw call via a streaming
+             vertex buffer, instead of a uniform change and draw call per drawable.
+             */
+            void setBatched(bool batched) {
+                _batched = batched;
+            }
+            
+            bool isBatched() const {
+                return _batched;
+            }
+            
             size_t visibleCount() const {
                 return _collector.sorted.size();
             }
@@ -222,6 +256,125 @@ namespace elements {
             set <DrawableRef> _all;
             collector _collector;
             
+            bool _batched;
+            detail::draw_batcher _batcher;
+            unique_ptr<detail::gl_draw_batch_backend> _batchBackend;
+            
+        };
+        
+        
+#pragma mark - ClippingEngine
+        
+        /**
+         Polygon boolean backends available to Shape::subtract, see TerrainDetail_Clipping.hpp
+         */
+        enum ClippingEngine {
+            BOOST_GEOMETRY_CLIPPING,
+            FIXED_POINT_CLIPPING
+        };
+        
+        
+#pragma mark - CutOperation
+        
+        /**
+         Timings (in seconds) of the phases of a cut, see World::getLastCutProfile. subtract and triangulate are summed
+         over the threads which performed them, so with parallel cutting enabled they can exceed the cut's wall time.
+         */
+        struct cut_profile {
+            size_t polygons;
+            size_t shapesCut;
+            size_t shapesCreated;
+            double bbQuery;
+            double subtract;
+            double triangulate;
+            double grouping;
+            double collisionShapes;
+            double attachments;
+            double total;
+            
+            cut_profile():
+            polygons(0),
+            shapesCut(0),
+            shapesCreated(0),
+            bbQuery(0),
+            subtract(0),
+            triangulate(0),
+            grouping(0),
+            collisionShapes(0),
+            attachments(0),
+            total(0)
+            {}
+        };
+        
+        /**
+         @class CutOperation
+         A cut by one or more polygons. World::cut runs it synchronously; World::cutAsync returns it as a handle.
+         The shapes to cut are snapshotted when the operation starts,
+         the subtraction and triangulation run on the shared thread pool, and the result is committed to the world
+         (chipmunk bodies, groups, draw dispatcher) during World::update.
+         */
+        class CutOperation {
+        public:
+            
+            enum State {
+                PENDING,
+                COMPUTING,
+                COMMITTED
+            };
+            
+            State getState() const {
+                return _state;
+            }
+            
+            bool isCommitted() const {
+                return _state == COMMITTED;
+            }
+            
+            const vector <dpolygon2> &getPolygons() const {
+                return _polygons;
+            }
+            
+        private:
+            
+            friend class World;
+            
+            CutOperation(const vector <dpolygon2> &polygons, const vector <cpBB> &polygonWorldBounds, double minSurfaceArea);
+            
+            // the geometry of a shape resulting from a cut; the Shape itself is made at commit, on the world's thread, so drawable ids
+            // are handed out in a deterministic order. trimesh is null if the result wasn't triangulated by computeCut.
+            struct result {
+                PolyLine2d outerContour;
+                vector <PolyLine2d> holeContours;
+                TriMeshRef trimesh;
+            };
+            
+            // a snapshot of a shape to cut, the indices of the polygons which overlap it, and the geometry which results from cutting it
+            struct item {
+                ShapeRef shape;
+                vector <size_t> polygons;
+                GroupBaseRef parentGroup;
+                size_t generation;
+                bool isStatic;
+                dmat4 inverseModelMatrix;
+                PolyLine2d outerContour;
+                vector <PolyLine2d> holeContours;
+                vector <result> results;
+                double subtractTime, triangulateTime;
+            };
+            
+            vector <dpolygon2> _polygons;
+            vector <cpBB> _polygonWorldBounds;
+            double _minSurfaceArea;
+            ClippingEngine _clippingEngine;
+            std::atomic<State> _state;
+            vector <item> _items;
+            
+            // whoever sets _claimed first (a pool worker, or a thread which needs the result now) runs computeCut;
+            // _computed is set under _computedMutex and _computedCondition signalled once it's done
+            std::atomic<bool> _claimed, _computed;
+            std::mutex _computedMutex;
+            std::condition_variable _computedCondition;
+            cut_profile _profile;
         };
         
         
@@ -250,11 +403,53 @@ namespace elements {
              */
             static vector <ShapeRef> partition(const vector <ShapeRef> &shapes, double partitionSize);
             
-            // return a unique ID; used to generate IDs for drawables, groups, etc
+            // return a unique ID; used to generate IDs for drawables, groups, etc. Safe to call from any thread.
             static size_t nextId() {
                 return _idCounter++;
             }
             
+            // select the polygon clipping backend used when cutting shapes; shared by all worlds. BOOST_GEOMETRY_CLIPPING by default
+            static void setClippingEngine(ClippingEngine engine) {
+                _clippingEngine = engine;
+            }
+            
+            static ClippingEngine getClippingEngine() {
+                return _clippingEngine;
+            }
+            
+            // when disabled, worlds skip creating their shader and drawing, so they can be built and cut without a GL context (e.g., for benchmarking)
+            static void setGraphicsEnabled(bool graphicsEnabled) {
+                _graphicsEnabled = graphicsEnabled;
+            }
+            
+            static bool getGraphicsEnabled() {
+                return _graphicsEnabled;
+            }
+            
+            /**
+             Disables graphics for its lifetime and restores the previous setting when destroyed, so a benchmark
+             which throws or bails early doesn't leave every subsequently created world without graphics.
+             */
+            class ScopedGraphicsDisabled {
+            public:
+                
+                ScopedGraphicsDisabled():
+                _graphicsEnabled(World::getGraphicsEnabled()) {
+                    World::setGraphicsEnabled(false);
+                }
+                
+                ~ScopedGraphicsDisabled() {
+                    World::setGraphicsEnabled(_graphicsEnabled);
+                }
+                
+                ScopedGraphicsDisabled(const ScopedGraphicsDisabled &) = delete;
+                ScopedGraphicsDisabled &operator=(const ScopedGraphicsDisabled &) = delete;
+                
+            private:
+                
+                bool _graphicsEnabled;
+            };
+            
         public:
             
             World(core::SpaceAccessRef space, material worldMaterial, material anchorMaterial);
@@ -272,7 +467,8 @@ namespace elements {
             
             /**
              Perform a cut in world space from a to b, with half-thickness of radius.
-             Discard any resultant geometry with less than minSurfaceArea
+             Discard any resultant geometry with less than minSurfaceArea.
+             Synchronous cuts commit any pending cutAsync cuts first, so cuts always take effect in the order they're made.
              */
             void cut(dvec2 a, dvec2 b, double radius, double minSurfaceArea = 1);
             
@@ -282,6 +478,39 @@ namespace elements {
              */
             void cut(const dpolygon2 &polygonShape, cpBB polygonShapeWorldBounds = cpBBInvalid, double minSurfaceArea = 0);
             
+            /**
+             Perform a batch of cuts in a single pass. Polygons overlapping the same shape are unioned and subtracted
+             from it once, and the affected groups are rebuilt once, which is considerably cheaper than calling cut()
+             for each polygon when several land in the same frame.
+             Discard any resultant geometry with less than minSurfaceArea
+             */
+            void cut(const vector <dpolygon2> &polygonShapes, double minSurfaceArea = 0);
+            
+            /**
+             Schedule a cut of `polygonShape. The geometry is computed on the shared thread pool and committed in update(),
+             keeping frame time flat during chains of explosions. Cuts are started and committed in the order they're
+             scheduled, and a synchronous cut() first commits any still pending. A cut whose snapshotted shapes were
+             regrouped or removed in the meantime is recomputed at commit.
+             */
+            CutOperationRef cutAsync(const dpolygon2 &polygonShape, cpBB polygonShapeWorldBounds = cpBBInvalid, double minSurfaceArea = 0);
+            
+            /**
+             When enabled (the default) cut() subtracts from the shapes it hits in parallel across
+             hardware threads; the resulting group bookkeeping is always performed on the calling thread.
+             */
+            void setParallelCutting(bool parallelCutting) {
+                _parallelCutting = parallelCutting;
+            }
+            
+            bool getParallelCutting() const {
+                return _parallelCutting;
+            }
+            
+            // get per-phase timings of the most recently committed cut
+            const cut_profile &getLastCutProfile() const {
+                return _cutProfile;
+            }
+            
             
             void draw(const core::render_state &renderState);
             
@@ -403,9 +632,46 @@ namespace elements {
             
             bool isShapeGroupStatic(const set <ShapeRef> shapeGroup, const GroupBaseRef &parentGroup);
             
+            // true if `shape overlaps one of the anchors
+            bool isShapeAnchored(const ShapeRef &shape) const;
+            
+            /**
+             Search the static group outward from `shapeGroup for a shape overlapping an anchor, or one already in `anchoredShapes.
+             unindexedShapes: new shapes of static parentage which aren't in the static group yet, searched along with it
+             anchoredShapes: shapes known to reach an anchor; on success every shape visited is added
+             island: on failure, receives every shape connected to `shapeGroup, shapeGroup included
+             */
+            bool isShapeGroupAnchoredThroughStaticGroup(const set <ShapeRef> &shapeGroup, const vector <ShapeRef> &unindexedShapes, set <ShapeRef> &anchoredShapes, set <ShapeRef> &island);
+            
+            // snapshot the shapes overlapped by a cut; must be called on the main thread
+            void prepareCut(const CutOperationRef &operation);
+            
+            // subtract the cut polygon from the snapshotted shapes; touches nothing but `operation so is safe to run on any thread
+            static void computeCut(const CutOperationRef &operation, bool parallel);
+            
+            // run computeCut on this thread and mark the operation computed, unless another thread has already claimed it
+            static void claimAndComputeCut(const CutOperationRef &operation, bool parallel);
+            
+            // block until a claimed operation has been computed
+            static void waitForComputedCut(const CutOperationRef &operation);
+            
+            // apply the computed cut to the world; must be called on the main thread
+            void commitCut(const CutOperationRef &operation);
+            
+            // start and commit async cuts in order
+            void updatePendingCuts();
+            
+            // compute (on this thread, if no worker has claimed it) and commit every pending async cut, so a synchronous cut lands after them
+            void flushPendingCuts();
+            
         private:
             
-            static size_t _idCounter;
+            friend class StaticGroup;
+            friend class DynamicGroup;
+            
+            static std::atomic<size_t> _idCounter;
+            static ClippingEngine _clippingEngine;
+            static bool _graphicsEnabled;
             
             material _worldMaterial, _anchorMaterial;
             core::SpaceAccessRef _space;
@@ -418,6 +684,9 @@ namespace elements {
             
             DrawDispatcher _drawDispatcher;
             gl::GlslProgRef _shader;
+            bool _parallelCutting;
+            deque <CutOperationRef> _pendingCuts;
+            cut_profile _cutProfile;
             
             core::ObjectWeakRef _object;
             
@@ -677,6 +946,9 @@ namespace elements {
             
             ShapeRef findShapeContainingLocalPoint(const dvec2 lp) const override;
             
+            // get the shapes whose bounds intersect `bb
+            set <ShapeRef> findShapesIntersecting(cpBB bb) const;
+            
             void addShape(ShapeRef shape, double minShapeArea);
             
             void removeShape(ShapeRef shape);
@@ -684,6 +956,7 @@ namespace elements {
         protected:
             cpBody *_body;
             set <ShapeRef> _shapes;
+            cpSpatialIndex *_index;
             mutable cpBB _worldBB;
             double _surfaceArea;
         };
@@ -800,7 +1073,12 @@ namespace elements {
             
             virtual const TriMeshRef &getTriMesh() const = 0;
             
-            virtual const gl::VboMeshRef &getVboMesh() const = 0;
+            /**
+             Get the VboMesh for this drawable's trimesh, uploading it on first request. DrawDispatcher only asks
+             for the meshes of visible drawables, so offscreen and short-lived geometry never touches the GPU.
+             Must be called on the main thread.
+             */
+            const gl::VboMeshRef &getVboMesh() const;
             
             virtual Color getColor(const core::render_state &state) const = 0;
             
@@ -825,10 +1103,18 @@ namespace elements {
             // IChipmunkUserData
             core::ObjectRef getObject() const override;
             
+        protected:
+            
+            // discard the uploaded VboMesh; call when the trimesh changes
+            void releaseVboMesh() {
+                _vboMesh.reset();
+            }
+            
         private:
             
             size_t _id;
             WorldWeakRef _world;
+            mutable gl::VboMeshRef _vboMesh;
             
         };
         
@@ -890,10 +1176,6 @@ namespace elements {
                 return _trimesh;
             }
             
-            const gl::VboMeshRef &getVboMesh() const override {
-                return _vboMesh;
-            }
-            
             Color getColor(const core::render_state &state) const override {
                 return Color(1, 0, 1);
             }
@@ -905,7 +1187,6 @@ namespace elements {
             cpBB _bb;
             string _id;
             TriMeshRef _trimesh;
-            gl::VboMeshRef _vboMesh;
             
         };
         
@@ -942,6 +1223,9 @@ namespace elements {
             
             Anchor(const PolyLine2d &contour);
             
+            // create an anchor with a previously computed triangulation of `contour, skipping triangulation
+            Anchor(const PolyLine2d &contour, const TriMeshRef &trimesh);
+            
             virtual ~Anchor();
             
             const PolyLine2d &getContour() const {
@@ -977,10 +1261,6 @@ namespace elements {
                 return _trimesh;
             }
             
-            const gl::VboMeshRef &getVboMesh() const override {
-                return _vboMesh;
-            }
-            
             Color getColor(const core::render_state &state) const override {
                 return _material.color;
             }
@@ -1005,7 +1285,6 @@ namespace elements {
             PolyLine2d _contour;
             
             TriMeshRef _trimesh;
-            gl::VboMeshRef _vboMesh;
             
         };
         
@@ -1038,6 +1317,10 @@ namespace elements {
             
             Shape(const PolyLine2d &shapeContour, const std::vector<PolyLine2d> &holeContours);
             
+            // create a shape with a previously computed world space triangulation of its contours; if the shape
+            // ends up static the triangulation is used as-is, otherwise it's recomputed in model space as usual
+            Shape(const PolyLine2d &shapeContour, const std::vector<PolyLine2d> &holeContours, const TriMeshRef &trimesh);
+            
             virtual ~Shape();
             
             const contour_pair &getOuterContour() const {
@@ -1103,10 +1386,6 @@ namespace elements {
                 return _trimesh;
             }
             
-            const gl::VboMeshRef &getVboMesh() const override {
-                return _vboMesh;
-            }
-            
             Color getColor(const core::render_state &state) const override {
                 return getGroup()->getColor(state);
             }
@@ -1138,14 +1417,21 @@ namespace elements {
             
             void setGroup(GroupBaseRef group);
             
-            // build the trimesh, returning true iff we got > 0 triangles
+            /**
+             Build the trimesh, returning true iff we got > 0 triangles. Only CPU side data is produced, so this is
+             safe to call off the main thread; the VboMesh is uploaded when the shape is first drawn.
+             */
             bool triangulate();
             
             void computeMassAndMoment(double density, double &mass, double &moment, double &area);
             
             void destroyCollisionShapes();
             
-            const vector<cpShape *> &createCollisionShapes(cpBody *body, cpBB &shapesModelBB, double collisionShapeRadius);
+            /**
+             Create collision shapes for the trimesh on `body, as triangles or as convex polygons per m.convexDecomposition,
+             returning them and writing their bounds to `shapesModelBB.
+             */
+            const vector<cpShape *> &createCollisionShapes(cpBody *body, cpBB &shapesModelBB, const material &m);
             
         private:
             
@@ -1160,11 +1446,17 @@ namespace elements {
             size_t _groupDrawingBatchId;
             cpHashValue _groupHash;
             
+            // bumped by setGroup; a shape's model geometry only changes as it's (re)grouped, so a cut snapshot
+            // taken at one generation is valid for as long as the shape stays at it
+            size_t _generation;
+            
             unordered_set<poly_edge> _worldSpaceContourEdges;
             cpBB _worldSpaceContourEdgesBB;
             
             TriMeshRef _trimesh;
-            gl::VboMeshRef _vboMesh;
+            
+            // point location over _trimesh for isLocalPointInside, built on first query and discarded when _trimesh changes
+            shared_ptr<detail::triangle_grid> _triangleGrid;
             
             // the attachments which are anchored by being in this shape's geometry
             set <AttachmentRef> _attachments;
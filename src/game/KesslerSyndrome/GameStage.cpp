@@ -250,6 +250,7 @@ namespace game {
     void GameStage::loadPlanet(const XmlTree &planetNode) {
         double friction = util::xml::readNumericAttribute<double>(planetNode, "friction", 1);
         double density = util::xml::readNumericAttribute<double>(planetNode, "density", 1);
+        bool convexDecomposition = util::xml::readBoolAttribute(planetNode, "convexDecomposition", false);
         double collisionShapeRadius = 0.1;
 
         const double minDensity = 1e-3;
@@ -260,8 +261,8 @@ namespace game {
         const Color coreColor = util::xml::readColorAttribute(planetNode, "coreColor", Color(0, 1, 1));
 
 
-        const terrain::material terrainMaterial(density, friction, collisionShapeRadius, ShapeFilters::TERRAIN, CollisionType::TERRAIN, minSurfaceArea, terrainColor);
-        const terrain::material anchorMaterial(1, friction, collisionShapeRadius, ShapeFilters::ANCHOR, CollisionType::ANCHOR, minSurfaceArea, coreColor);
+        const terrain::material terrainMaterial(density, friction, collisionShapeRadius, ShapeFilters::TERRAIN, CollisionType::TERRAIN, minSurfaceArea, terrainColor, convexDecomposition);
+        const terrain::material anchorMaterial(1, friction, collisionShapeRadius, ShapeFilters::ANCHOR, CollisionType::ANCHOR, minSurfaceArea, coreColor, convexDecomposition);
         auto world = make_shared<terrain::World>(getSpace(), terrainMaterial, anchorMaterial);
 
         _planet = Planet::create("Planet", world, planetNode, DrawLayers::PLANET);
@@ -519,10 +520,10 @@ namespace game {
         }
 
         {
-            // perform a cut against the planet surface
+            // perform a cut against the planet surface; the subtraction runs off the main thread and is committed on a later update
             const auto planet = _planet;
             scheduleDelayedInvocation(0.1, [planet,crackGeometry,minSurfaceAreaThreshold](){
-                planet->getWorld()->cut(crackGeometry->getPolygons()[0], crackGeometry->getBB(), minSurfaceAreaThreshold);
+                planet->getWorld()->cutAsync(crackGeometry->getPolygons()[0], crackGeometry->getBB(), minSurfaceAreaThreshold);
             });
         }
     }
@@ -53,11 +53,12 @@ namespace game {
 
     /*
      config _config;
-     ci::Perlin _noise;
+     core::util::GradientNoise _noise;
      core::seconds_t _time;
      cpBB _bb;
      vector<core::RadialGravitationCalculatorRef> _displacements;
      vector<particle_physics> _physics;
+     vector<float> _noiseX, _noiseValues;
      */
 
     CloudLayerParticleSimulation::CloudLayerParticleSimulation(const config &c) :
@@ -131,11 +132,26 @@ namespace game {
         const double deltaT2 = timeState.deltaT * timeState.deltaT;
         const dvec2 origin = _config.origin;
         cpBB bounds = cpBBInvalid;
+
+        //
+        // sample the noise for every particle in one batched call
+        //
+
+        const size_t count = _state.size();
+        _noiseX.resize(count);
+        _noiseValues.resize(count);
+        for (size_t i = 0; i < count; i++, a += da) {
+            _noiseX[i] = static_cast<float>(a * noiseTurbulence);
+        }
+        _noise.fBm(_noiseX.data(), static_cast<float>(noiseYAxis), _noiseValues.data(), count);
+        a = 0;
+
         auto physics = _physics.begin();
         auto state = _state.begin();
+        auto fbm = _noiseValues.begin();
         const auto end = _state.end();
 
-        for (; state != end; ++state, ++physics, a += da) {
+        for (; state != end; ++state, ++physics, ++fbm, a += da) {
 
             //
             // simplistic verlet integration
@@ -171,8 +187,7 @@ namespace game {
                 angle = a - M_PI_2;
             }
 
-            double fbm = _noise.fBm(a * noiseTurbulence, noiseYAxis);
-            double noise = (fbm + 1.0) * 0.5;
+            double noise = (*fbm + 1.0) * 0.5;
             double radius = 0;
             if (noise > noiseMin) {
                 double remappedNoiseVale = (noise - noiseMin) * rNoiseRange;
@@ -8,7 +8,7 @@
 #ifndef CloudLayerParticleSystem_hpp
 #define CloudLayerParticleSystem_hpp
 
-#include <cinder/Perlin.h>
+#include "core/util/GradientNoise.hpp"
 
 #include "elements/ParticleSystem/ParticleSystem.hpp"
 #include "game/KesslerSyndrome/GameConstants.hpp"
@@ -129,11 +129,12 @@ namespace game {
         };
 
         config _config;
-        ci::Perlin _noise;
+        core::util::GradientNoise _noise;
         core::seconds_t _time;
         cpBB _bb;
         vector<core::RadialGravitationCalculatorRef> _displacements;
         vector<particle_physics> _physics;
+        vector<float> _noiseX, _noiseValues;
     };
     
     class CloudLayerParticleSystemDrawComponent : public elements::ParticleSystemDrawComponent {
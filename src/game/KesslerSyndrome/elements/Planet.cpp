@@ -9,6 +9,7 @@
 
 #include "elements/Terrain/TerrainDetail.hpp"
 #include "game/KesslerSyndrome/GameConstants.hpp"
+#include "game/KesslerSyndrome/elements/PlanetGeneratorCache.hpp"
 
 using namespace core;
 using namespace elements;
@@ -89,14 +90,15 @@ namespace game {
     PlanetRef Planet::create(string name, terrain::WorldRef world, XmlTree planetNode, int drawLayer) {
         dvec2 origin = util::xml::readPointAttribute(planetNode, "origin", dvec2(0, 0));
         double partitionSize = util::xml::readNumericAttribute<double>(planetNode, "partitionSize", 250);
+        bool useGenerationCache = util::xml::readBoolAttribute(planetNode, "useGenerationCache", false);
         config surfaceConfig = config::parse(planetNode.getChild("surface"));
         config coreConfig = config::parse(planetNode.getChild("core"));
         auto attachmentGenerators = parseAttachmentGenerators(planetNode.getChild("attachmentGenerators"));
 
-        return create(name, world, surfaceConfig, coreConfig, attachmentGenerators, origin, partitionSize, drawLayer);
+        return create(name, world, surfaceConfig, coreConfig, attachmentGenerators, origin, partitionSize, useGenerationCache, drawLayer);
     }
 
-    PlanetRef Planet::create(string name, terrain::WorldRef world, const config &surfaceConfig, const config &coreConfig, const vector<planet_generation::params::perimeter_attachment_params> &attachments, dvec2 origin, double partitionSize, int drawLayer) {
+    PlanetRef Planet::create(string name, terrain::WorldRef world, const config &surfaceConfig, const config &coreConfig, const vector<planet_generation::params::perimeter_attachment_params> &attachments, dvec2 origin, double partitionSize, bool useGenerationCache, int drawLayer) {
         
         planet_generation::params params = create_planet_generation_params(surfaceConfig, coreConfig, origin, surfaceConfig.radius);
         
@@ -107,7 +109,10 @@ namespace game {
         params.terrain.partitionSize = partitionSize;
         params.attachments = attachments;
 
-        auto result = planet_generation::generate(params, world);
+        // the cache is opt-in, since a cached planet won't reflect generator changes made without a rebuild
+        auto result = useGenerationCache
+            ? planet_generation::generate(params, world, planet_generation::default_cache_directory())
+            : planet_generation::generate(params, world);
 
         // finally create the Planet
         auto planet = PlanetRef(new Planet(name, result.world, result.attachmentsByBatchId, drawLayer));
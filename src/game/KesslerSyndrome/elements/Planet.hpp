@@ -43,7 +43,7 @@ namespace game {
 
         static PlanetRef create(string name, elements::terrain::WorldRef world, XmlTree planetNode, int drawLayer);
 
-        static PlanetRef create(string name, elements::terrain::WorldRef world, const config &surfaceConfig, const config &coreConfig, const vector<planet_generation::params::perimeter_attachment_params> &attachments, dvec2 origin, double partitionSize, int drawLayer);
+        static PlanetRef create(string name, elements::terrain::WorldRef world, const config &surfaceConfig, const config &coreConfig, const vector<planet_generation::params::perimeter_attachment_params> &attachments, dvec2 origin, double partitionSize, bool useGenerationCache, int drawLayer);
 
     private:
 
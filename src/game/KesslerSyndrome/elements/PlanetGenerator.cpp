@@ -6,12 +6,14 @@
 //
 
 #include "game/KesslerSyndrome/elements/PlanetGenerator.hpp"
+#include "game/KesslerSyndrome/elements/PlanetGeneratorCache.hpp"
 
 #include <cinder/Rand.h>
 #include <cinder/Perlin.h>
 
 #include "core/util/ContourSimplification.hpp"
 #include "core/util/ImageProcessing.hpp"
+#include "core/util/ThreadPool.hpp"
 
 #include "elements/Terrain/MarchingSquares.hpp"
 #include "elements/Terrain/TerrainDetail.hpp"
@@ -25,21 +27,104 @@ namespace game { namespace planet_generation {
     namespace {
         
         /**
-         Prune any unconnected floating islands that may have been generated.
+         Find the index of the shape in `shapes which was marched from the largest solid region of `map, by
+         finding the shape containing one of that region's pixels. Returns shapes.size() if the map has no
+         solid regions, or no shape contains the pixel.
+         */
+        size_t find_largest_shape(const vector<terrain::ShapeRef> &shapes, const Channel8u &map, double isoLevel, const dmat4 &transform) {
+            // marching squares treats pixels with value >= isoLevel * 255 as solid
+            const auto minValue = static_cast<uint8_t>(ceil(isoLevel * 255));
+            const util::ip::component_labels regions = util::ip::label_components(map, minValue);
+            if (regions.components.empty()) {
+                return shapes.size();
+            }
+            
+            const auto largest = max_element(regions.components.begin(), regions.components.end(), [](const util::ip::component_stats &a, const util::ip::component_stats &b) {
+                return a.area < b.area;
+            });
+            const uint32_t largestLabel = static_cast<uint32_t>(distance(regions.components.begin(), largest)) + 1;
+            
+            //
+            // find a pixel of the region whose 8 neighbors are in it too. marching squares puts no contour in
+            // the four cells around such a pixel, so it's about a pixel inside the shape, and the shape's contour
+            // simplification won't move the contour past it. fall back to the region's first pixel, which
+            // is on the top row of its bounds.
+            //
+            
+            const Area &bounds = largest->bounds;
+            auto isInterior = [&regions, largestLabel](int x, int y) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (regions.getLabel(x + dx, y + dy) != largestLabel) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            };
+            
+            ivec2 pixel(bounds.x1, bounds.y1);
+            while (regions.getLabel(pixel.x, pixel.y) != largestLabel) {
+                pixel.x++;
+            }
+            
+            bool foundInterior = false;
+            for (int y = bounds.y1 + 1; y < bounds.y2 - 1 && !foundInterior; y++) {
+                for (int x = bounds.x1 + 1; x < bounds.x2 - 1; x++) {
+                    if (isInterior(x, y)) {
+                        pixel = ivec2(x, y);
+                        foundInterior = true;
+                        break;
+                    }
+                }
+            }
+            
+            //
+            // the shape we want is the one whose outer contour contains the pixel and none of whose holes do;
+            // a hole may hold another shape
+            //
+            
+            const dvec2 point = transform * dvec2(pixel);
+            for (size_t i = 0; i < shapes.size(); i++) {
+                if (!shapes[i]->getOuterContour().world.contains(point)) {
+                    continue;
+                }
+                
+                bool inHole = false;
+                for (const auto &holeContour : shapes[i]->getHoleContours()) {
+                    if (holeContour.world.contains(point)) {
+                        inHole = true;
+                        break;
+                    }
+                }
+                
+                if (!inHole) {
+                    return i;
+                }
+            }
+            
+            return shapes.size();
+        }
+        
+        /**
+         Prune any unconnected floating islands that may have been generated, keeping the shape made from
+         the largest solid region of `map, which `shapes were marched from.
          Return number of pruned islands.
          */
-        size_t prune_floater(vector<terrain::ShapeRef> &shapes) {
+        size_t prune_floater(vector<terrain::ShapeRef> &shapes, const Channel8u &map, double isoLevel, const dmat4 &transform) {
             if (shapes.size() > 1) {
                 
                 //
-                // sort such that biggest shape is front in list, and then keep just that one
+                // keep just the biggest shape; the map's component labels tell us which that is without triangulating every island
                 //
-
-                sort(shapes.begin(), shapes.end(), [](const terrain::ShapeRef &a, const terrain::ShapeRef & b) -> bool {
-                    return a->getSurfaceArea() > b->getSurfaceArea();
-                });
+                
+                const size_t largest = find_largest_shape(shapes, map, isoLevel, transform);
+                if (largest == shapes.size()) {
+                    return 0;
+                }
+                
                 size_t originalSize = shapes.size();
-                shapes = vector<terrain::ShapeRef> { shapes.front() };
+                shapes = vector<terrain::ShapeRef> { shapes[largest] };
                 size_t newSize = shapes.size();
 
                 return originalSize - newSize;
@@ -127,6 +212,150 @@ namespace game { namespace planet_generation {
                 }
             }
         }
+        
+        struct attachment_candidate {
+            dvec2 position;
+            dvec2 rotation;
+        };
+        
+        // splitmix64's finalizer; fixed width, so it mixes the same on every platform and compiler
+        uint64_t splitmix64(uint64_t x) {
+            x += 0x9E3779B97F4A7C15ULL;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return x ^ (x >> 31);
+        }
+        
+        // seed for the random stream of the attachment batch at `batchIndex in params::attachments
+        uint32_t attachment_batch_seed(int seed, size_t batchIndex) {
+            const uint64_t mixed = splitmix64(splitmix64(static_cast<uint64_t>(static_cast<uint32_t>(seed))) ^ static_cast<uint64_t>(batchIndex));
+            return static_cast<uint32_t>(mixed >> 32);
+        }
+        
+        // walk the perimeters of `shapes and roll the dice for each step, returning the positions and rotations
+        // which should receive an attachment, in walk order. Doesn't touch the world, so batches may be collected in parallel.
+        vector<attachment_candidate> collect_attachment_candidates(const params &p, const params::perimeter_attachment_params &ap, const vector <terrain::ShapeRef> &shapes, Rand &rng) {
+            const dvec2 origin = p.origin();
+            const double placementNudge = 1e-2;
+            const double minPlacementRadius = p.anchors.enabled ? p.anchorOuterRadius() : 0;
+            const double minPlacementRadiusSquared = minPlacementRadius * minPlacementRadius;
+            const double step = 1/ ap.density;
+            const double wiggle = step * 0.5;
+            
+            vector<attachment_candidate> candidates;
+            for(const terrain::ShapeRef &shape : shapes) {
+                walk_shape_perimeter(shape, step, wiggle, rng, ap.includeHoleContours, [&](dvec2 position, dvec2 normal, bool isOuterContour)->bool {
+                    
+                    // check that we're outside the max radius of the anchor geometry - this
+                    // is a cheap test to prevent placing foliage where it will be hidden by anchors
+                    if (distanceSquared(position, origin) < minPlacementRadiusSquared) {
+                        return true;
+                    }
+                    
+                    // dice roll, scaled by closeness to desired slope
+                    double d = dot(normalize(position - origin), normal);
+                    d = sqrt(1.0 - saturate<double>(abs(d - ap.normalToUpDotTarget) / ap.normalToUpDotRange));
+                    if (rng.nextFloat() < ap.probability * d) {
+                        candidates.push_back({ position - normal * placementNudge, rotateCW(normal) });
+                    }
+                    
+                    return true;
+                });
+            }
+            
+            return candidates;
+        }
+        
+        /**
+         Fill a map with thresholded perlin noise. This is the first stage of map generation.
+         NOISE is util::GradientNoise, or ci::Perlin for the reference generator; both produce the same noise.
+         */
+        template<class NOISE>
+        Channel8u generate_land_noise(const params::generation_params &p, int size) {
+            Channel8u map = Channel8u(size, size);
+            NOISE pn(p.noiseOctaves, p.seed);
+            const float frequency = p.noiseFrequencyScale / 32.f;
+            core::util::ip::in_place::perlin_abs_thresh(map, pn, frequency, 12);
+            return map;
+        }
+        
+        /**
+         Perform radial samples from inside out, calling `visitor with each sample position. Any white blob
+         which is sampled is "solid land". We sample less frequently as we move out so as to allow for
+         "swiss cheese" surface
+         */
+        void visit_land_samples(const params::generation_params &p, int size, const function<void(ivec2)> &visitor) {
+            const vec2 center(size/2, size/2);
+            const double surfaceSolidity = saturate<double>(p.surfaceSolidity);
+            const double radiusStep = size / 64.0;
+            const double endRadius = size * 0.5 * p.vignetteEnd;
+            
+            // we want to sample the ring less and less as we step out towards end radius. so we have a
+            // scale factor which increases the sample distance, and the pow factor which delinearizes the change
+            const double surfaceSolidityRadIncrementPow = lrp<double>(surfaceSolidity, 0.5, 16);
+            const double surfaceSolidityRadIncrmementScale = lrp<double>(surfaceSolidity, size * 0.5, size * 0.01);
+            
+            // walk a ring of positions from center out to endRadius. skip the origin pixel to avoid div by zero
+            for (double radius = 1; radius <= endRadius; radius += radiusStep) {
+                
+                const double pixelArcWidth = abs(sin(1/radius)); // approx arc-width of 1 pixel at this radius
+                const double progress = radius / endRadius;
+                const double radsIncrement = max<double>(surfaceSolidityRadIncrmementScale * pow(progress, surfaceSolidityRadIncrementPow) * pixelArcWidth, 2 * pixelArcWidth);
+                
+                for (double radians = 0; radians < 2 * M_PI; radians += radsIncrement) {
+                    double px = center.x + radius * cos(radians);
+                    double py = center.y + radius * sin(radians);
+                    visitor(ivec2(static_cast<int>(round(px)), static_cast<int>(round(py))));
+                }
+            }
+        }
+        
+        /**
+         Generate the land noise and mark the white blobs hit by visit_land_samples as `landValue.
+         The map is labeled once, the sampled components are collected, and they're marked in a single pass.
+         */
+        Channel8u generate_land(const params::generation_params &p, int size, uint8_t landValue) {
+            Channel8u map = generate_land_noise<util::GradientNoise>(p, size);
+            
+            const util::ip::component_labels blobs = util::ip::label_components(map, 255);
+            vector<uint8_t> isLand(blobs.components.size(), 0);
+            visit_land_samples(p, size, [&](ivec2 plot) {
+                const uint32_t label = blobs.getLabel(plot.x, plot.y);
+                if (label) {
+                    isLand[label - 1] = 1;
+                }
+            });
+            
+            util::ip::in_place::apply(map, { [&](uint8_t *row, int y, int width) {
+                for (int x = 0; x < width; x++) {
+                    const uint32_t label = blobs.getLabel(x, y);
+                    if (label && isLand[label - 1]) {
+                        row[x] = landValue;
+                    }
+                }
+            }});
+            
+            return map;
+        }
+        
+        /**
+         The original land generator, which floodfills each sampled blob as it's found
+         */
+        Channel8u generate_land_reference(const params::generation_params &p, int size, uint8_t landValue) {
+            Channel8u map = generate_land_noise<Perlin>(p, size);
+            
+            uint8_t *data = map.getData();
+            int32_t rowBytes = map.getRowBytes();
+            int32_t increment = map.getIncrement();
+            
+            visit_land_samples(p, size, [&](ivec2 plot) {
+                if (data[plot.y * rowBytes + plot.x * increment] == 255) {
+                    util::ip::in_place::floodfill(map, plot, 255, landValue);
+                }
+            });
+            
+            return map;
+        }
     }
     
     namespace detail {
@@ -134,63 +363,62 @@ namespace game { namespace planet_generation {
         Channel8u generate_map(const params::generation_params &p, int size) {
             
             StopWatch timer("generate_map");
-            Channel8u map = Channel8u(size, size);
             
+            const uint8_t landValue = 128;
+            Channel8u map = generate_land(p, size, landValue);
+            const double surfaceSolidity = saturate<double>(p.surfaceSolidity);
+            
+            //
+            // Remap to make "land" white, and eveything else black. Then a blur pass
+            // which will cause nearby landmasses to touch when marching_squares is run.
+            // We don't need to threshold because marching_squares' isoLevel param is our thresholder.
             //
-            //    Initilialize our terrain with perlin noise, fading out to black with radial vignette
+            // The point-wise stages are fused into the blur's two passes: the remap is applied to each row as the
+            // horizontal pass reads it, and the roughness noise and vignette to each row as the vertical pass writes it.
+            // The vertical pass writes back into map, so after seeding the map is streamed twice rather than five
+            // times, and the only allocation is the blur's scratch channel.
             //
             
-            const vec2 center(size/2, size/2);
+            vector<util::ip::row_op> beforeBlur = { util::ip::row_ops::remap(landValue, 255, 0) };
+            vector<util::ip::row_op> afterBlur;
             
-            {
-                Perlin pn(p.noiseOctaves, p.seed);
-                const float frequency = p.noiseFrequencyScale / 32.f;
-                core::util::ip::in_place::perlin_abs_thresh(map, pn, frequency, 12);
+            //
+            // use more blur for more solid surfaces since it will join more
+            //
+            
+            int blurRadius = static_cast<int>(lrp<double>(surfaceSolidity, 5, 21));
+            
+            //
+            //  Add a little high-frequency noise for detail
+            //
+            
+            util::GradientNoise roughnessNoiseSource(p.noiseOctaves, p.seed + 1);
+            if (p.surfaceRoughness > 0) {
+                const float roughness = saturate(p.surfaceRoughness);
+                const float frequency = lrp<float>(roughness, 1.0f / 16.0f, 12.0f / 16.0f);
+                afterBlur.push_back(util::ip::row_ops::perlin_add(roughnessNoiseSource, frequency, saturate(roughness)));
             }
             
             //
-            // now perform radial samples from inside out, floodfilling
-            // white blobs to grey. grey will be our marker for "solid land". we
-            // sample less frequently as we move out so as to allow for "swiss cheese" surface
+            // Now apply vignette to prevent blobs from touching edges and, generally,
+            // circularize the median geometry
             //
             
-            const double surfaceSolidity = saturate<double>(p.surfaceSolidity);
-            const uint8_t landValue = 128;
+            afterBlur.push_back(util::ip::row_ops::vignette(map.getSize(), p.vignetteStart, p.vignetteEnd, 0));
             
-            {
-                uint8_t *data = map.getData();
-                int32_t rowBytes = map.getRowBytes();
-                int32_t increment = map.getIncrement();
-                
-                auto sample = [&](const ivec2 &p) -> uint8_t {
-                    return data[p.y * rowBytes + p.x * increment];
-                };
-                
-                const double radiusStep = size / 64.0;
-                const double endRadius = size * 0.5 * p.vignetteEnd;
-                
-                // we want to sample the ring less and less as we step out towards end radius. so we have a
-                // scale factor which increases the sample distance, and the pow factor which delinearizes the change
-                const double surfaceSolidityRadIncrementPow = lrp<double>(surfaceSolidity, 0.5, 16);
-                const double surfaceSolidityRadIncrmementScale = lrp<double>(surfaceSolidity, size * 0.5, size * 0.01);
-                
-                // walk a ring of positions from center out to endRadius. skip the origin pixel to avoid div by zero
-                for (double radius = 1; radius <= endRadius; radius += radiusStep) {
-                    
-                    const double pixelArcWidth = abs(sin(1/radius)); // approx arc-width of 1 pixel at this radius
-                    const double progress = radius / endRadius;
-                    const double radsIncrement = max<double>(surfaceSolidityRadIncrmementScale * pow(progress, surfaceSolidityRadIncrementPow) * pixelArcWidth, 2 * pixelArcWidth);
-                    
-                    for (double radians = 0; radians < 2 * M_PI; radians += radsIncrement) {
-                        double px = center.x + radius * cos(radians);
-                        double py = center.y + radius * sin(radians);
-                        ivec2 plot(static_cast<int>(round(px)), static_cast<int>(round(py)));
-                        if (sample(plot) == 255) {
-                            util::ip::in_place::floodfill(map, plot, 255, landValue);
-                        }
-                    }
-                }
-            }
+            Channel8u scratch;
+            util::ip::blur(map, map, blurRadius, util::ip::KERNEL_BLUR, scratch, beforeBlur, afterBlur);
+            
+            return map;
+        }
+        
+        Channel8u generate_map_reference(const params::generation_params &p, int size) {
+            
+            StopWatch timer("generate_map_reference");
+            
+            const uint8_t landValue = 128;
+            Channel8u map = generate_land_reference(p, size, landValue);
+            const double surfaceSolidity = saturate<double>(p.surfaceSolidity);
             
             //
             // Remap to make "land" white, and eveything else black. Then a blur pass
@@ -239,7 +467,7 @@ namespace game { namespace planet_generation {
             shapes = terrain::Shape::fromContours(contours);
             
             if (p.terrain.pruneFloaters) {
-                size_t culled = prune_floater(shapes);
+                size_t culled = prune_floater(shapes, terrainMap, isoLevel, p.transform);
                 if (culled > 0) {
                     CI_LOG_D("Culled " << culled << " islands from generated shapes");
                 }
@@ -249,107 +477,262 @@ namespace game { namespace planet_generation {
         }
         
         Channel8u generate_anchors(const params &p, vector <terrain::AnchorRef> &anchors) {
+            vector<PolyLine2d> contours;
+            vector<TriMeshRef> trimeshes;
+            Channel8u anchorMap = generate_anchors(p, contours, trimeshes);
+            
+            anchors.clear();
+            for (size_t i = 0; i < contours.size(); i++) {
+                anchors.push_back(make_shared<terrain::Anchor>(contours[i], trimeshes[i]));
+            }
+            
+            return anchorMap;
+        }
+        
+        Channel8u generate_anchors(const params &p, vector <PolyLine2d> &contours, vector <TriMeshRef> &trimeshes) {
             Channel8u anchorMap = generate_map(p.anchors, p.size);
             
             const double isoLevel = 0.5;
             const double linearOptimizationThreshold = 0; // zero, because terrain::Shape::fromContours performs its own optimization
-            vector<PolyLine2d> contours = terrain::detail::march(anchorMap, isoLevel, p.transform, linearOptimizationThreshold);
-            anchors = terrain::Anchor::fromContours(contours);
+            contours = terrain::detail::march(anchorMap, isoLevel, p.transform, linearOptimizationThreshold);
+            
+            trimeshes.clear();
+            for (const auto &contour : contours) {
+                trimeshes.push_back(terrain::detail::triangulate(contour));
+            }
             
             return anchorMap;
         }
 
     }
     
-    result generate(const params &params, terrain::WorldRef world) {
-        StopWatch timer("generate");
-        
-        world->setWorldMaterial(params.terrain.material);
-        world->setAnchorMaterial(params.anchors.material);
-        
-        vector <terrain::ShapeRef> nonPartitionedShapes, shapes;
-        vector <terrain::AnchorRef> anchors;
-        Channel8u terrainMap, anchorMap;
-        
-        if (params.terrain.enabled) {
-            terrainMap = detail::generate_shapes(params, nonPartitionedShapes);
-            if (params.terrain.partitionSize > 0) {
-                shapes = terrain::World::partition(nonPartitionedShapes, params.terrain.partitionSize);
-                CI_LOG_D("Partition size of " << params.terrain.partitionSize << " resulted in " << shapes.size() << " partitioned pieces" );
-            } else {
-                shapes = nonPartitionedShapes;
-            }
-        }
-        
-        if (params.anchors.enabled) {
-            anchorMap = detail::generate_anchors(params, anchors);
-        }
-        
-        world->build(shapes, anchors);
-        
-        result r;
-        r.world = world;
-        r.terrainMap = terrainMap;
-        r.anchorMap = anchorMap;
+    namespace {
         
-        //
-        // generate attachments
-        //
-
-        if (!params.attachments.empty()) {
+        /**
+         Run planet generation into `world. If `record is non-null, it's filled with what's needed to later rebuild
+         the same world with build_cached_planet.
+         */
+        result generate_planet(const params &params, terrain::WorldRef world, detail::cached_planet *record) {
+            StopWatch timer("generate");
+            result r;
             
-            const dvec2 origin = params.origin();
-            terrain::AttachmentRef attachment;
-
-            Rand rng;
-            const double placementNudge = 1e-2;
-            const double minPlacementRadius = params.anchors.enabled ? params.anchorOuterRadius() : 0;
-            const double minPlacementRadiusSquared = minPlacementRadius * minPlacementRadius;
+            world->setWorldMaterial(params.terrain.material);
+            world->setAnchorMaterial(params.anchors.material);
             
-            for(const auto &ap : params.attachments) {
-                vector <terrain::AttachmentRef> attachments;
-                const double step = 1/ ap.density;
-                const double wiggle = step * 0.5;
-                for(const terrain::ShapeRef &shape : nonPartitionedShapes) {
-                    walk_shape_perimeter(shape, step, wiggle, rng, ap.includeHoleContours, [&](dvec2 position, dvec2 normal, bool isOuterContour)->bool {
+            vector <terrain::ShapeRef> nonPartitionedShapes, shapes;
+            vector <terrain::AnchorRef> anchors;
+            vector <PolyLine2d> anchorContours;
+            vector <TriMeshRef> anchorTrimeshes;
+            Channel8u terrainMap, anchorMap;
+            
+            //
+            // terrain and anchors don't depend on each other, so generate them concurrently. Only the terrain task
+            // makes drawables (shapes); the anchors are made after, so drawable ids don't depend on scheduling.
+            //
+            
+            util::ThreadPool::shared().parallelFor(2, [&](size_t task) {
+                StopWatch phaseTimer;
+                if (task == 0) {
+                    if (params.terrain.enabled) {
+                        terrainMap = detail::generate_shapes(params, nonPartitionedShapes);
+                        r.timings.terrain = phaseTimer.mark();
                         
-                        // early exit scenario - stop walk completely because we're done
+                        if (params.terrain.partitionSize > 0) {
+                            phaseTimer.start();
+                            shapes = terrain::World::partition(nonPartitionedShapes, params.terrain.partitionSize);
+                            r.timings.partition = phaseTimer.mark();
+                            CI_LOG_D("Partition size of " << params.terrain.partitionSize << " resulted in " << shapes.size() << " partitioned pieces" );
+                        } else {
+                            shapes = nonPartitionedShapes;
+                        }
+                    }
+                } else {
+                    if (params.anchors.enabled) {
+                        anchorMap = detail::generate_anchors(params, anchorContours, anchorTrimeshes);
+                        r.timings.anchors = phaseTimer.mark();
+                    }
+                }
+            });
+            
+            for (size_t i = 0; i < anchorContours.size(); i++) {
+                anchors.push_back(make_shared<terrain::Anchor>(anchorContours[i], anchorTrimeshes[i]));
+            }
+            
+            if (record) {
+                for (const auto &shape : shapes) {
+                    detail::cached_planet::shape cs;
+                    cs.outerContour = shape->getOuterContour().model;
+                    for (const auto &hole : shape->getHoleContours()) {
+                        cs.holeContours.push_back(hole.model);
+                    }
+                    record->shapes.push_back(cs);
+                }
+                for (const auto &anchor : anchors) {
+                    record->anchors.push_back({ anchor->getContour(), anchor->getTriMesh() });
+                }
+                record->attachmentsByBatch.resize(params.attachments.size());
+            }
+            
+            StopWatch phaseTimer;
+            world->build(shapes, anchors);
+            r.timings.build = phaseTimer.mark();
+            
+            if (record) {
+                // static shapes are triangulated in world space by build, so their triangulations can be reused
+                const terrain::GroupBaseRef staticGroup = world->getStaticGroup();
+                for (size_t i = 0; i < shapes.size(); i++) {
+                    if (shapes[i]->getGroup() == staticGroup && shapes[i]->hasValidTriMesh()) {
+                        record->shapes[i].trimesh = shapes[i]->getTriMesh();
+                    }
+                }
+            }
+            
+            r.world = world;
+            r.terrainMap = terrainMap;
+            r.anchorMap = anchorMap;
+            
+            //
+            // generate attachments
+            //
+
+            if (!params.attachments.empty()) {
+                phaseTimer.start();
+                
+                // walk the perimeters for each batch in parallel, each with its own random stream
+                vector<vector<attachment_candidate>> candidatesByBatch(params.attachments.size());
+                util::ThreadPool::shared().parallelFor(params.attachments.size(), [&](size_t i) {
+                    Rand rng(attachment_batch_seed(params.terrain.seed, i));
+                    candidatesByBatch[i] = collect_attachment_candidates(params, params.attachments[i], nonPartitionedShapes, rng);
+                });
+                
+                // insertion mutates the world, so it's done serially in batch order
+                terrain::AttachmentRef attachment;
+                for (size_t i = 0; i < params.attachments.size(); i++) {
+                    const auto &ap = params.attachments[i];
+                    vector <terrain::AttachmentRef> attachments;
+                    for (const auto &candidate : candidatesByBatch[i]) {
                         if (ap.maxCount > 0 && attachments.size() >= ap.maxCount) {
-                            return false;
+                            break;
                         }
                         
-                        // check that we're outside the max radius of the anchor geometry - this
-                        // is a cheap test to prevent placing foliage where it will be hidden by anchors
-                        if (distanceSquared(position, origin) < minPlacementRadiusSquared) {
-                            return true;
+                        if (!attachment) {
+                            attachment = make_shared<terrain::Attachment>();
                         }
-
-                        // dice roll, scaled by closeness to desired slope
-                        double d = dot(normalize(position - origin), normal);
-                        d = sqrt(1.0 - saturate<double>(abs(d - ap.normalToUpDotTarget) / ap.normalToUpDotRange));
-                        if (rng.nextFloat() < ap.probability * d) {
-                            dvec2 pos = position - normal * placementNudge;
-                            
-                            if (!attachment) {
-                                attachment = make_shared<terrain::Attachment>();
-                            }
+                        
+                        // now attempt insertion
+                        if (world->addAttachment(attachment, candidate.position, candidate.rotation)) {
+                            attachment->setTag(attachments.size());
+                            attachments.push_back(attachment);
+                            attachment.reset();
                             
-                            // now attempt insertion
-                            if (world->addAttachment(attachment, pos, rotateCW(normal))) {
-                                attachment->setTag(attachments.size());
-                                attachments.push_back(attachment);
-                                attachment.reset();
+                            if (record) {
+                                record->attachmentsByBatch[i].push_back({ candidate.position, candidate.rotation });
                             }
                         }
-                        
-                        return true;
-                    });
+                    }
+                    CI_LOG_D("Generated " << attachments.size() << " attachments");
+                    r.attachmentsByBatchId[ap.batchId] = attachments;
                 }
-                CI_LOG_D("Generated " << attachments.size() << " attachments");
-                r.attachmentsByBatchId[ap.batchId] = attachments;
+                
+                r.timings.attachments = phaseTimer.mark();
             }
-        }
+            
+            r.timings.total = timer.mark();
+            CI_LOG_D("terrain: " << r.timings.terrain << "s partition: " << r.timings.partition << "s anchors: " << r.timings.anchors
+                     << "s build: " << r.timings.build << "s attachments: " << r.timings.attachments << "s total: " << r.timings.total << "s");
 
+            return r;
+        }
+        
+        /**
+         Build `world from a cached generation result
+         */
+        result build_cached_planet(const params &params, terrain::WorldRef world, const detail::cached_planet &cached) {
+            StopWatch timer;
+            result r;
+            r.world = world;
+            r.fromCache = true;
+            
+            world->setWorldMaterial(params.terrain.material);
+            world->setAnchorMaterial(params.anchors.material);
+            
+            vector <terrain::ShapeRef> shapes;
+            shapes.reserve(cached.shapes.size());
+            for (const auto &cs : cached.shapes) {
+                if (cs.trimesh) {
+                    shapes.push_back(make_shared<terrain::Shape>(cs.outerContour, cs.holeContours, cs.trimesh));
+                } else {
+                    shapes.push_back(make_shared<terrain::Shape>(cs.outerContour, cs.holeContours));
+                }
+            }
+            
+            vector <terrain::AnchorRef> anchors;
+            anchors.reserve(cached.anchors.size());
+            for (const auto &ca : cached.anchors) {
+                anchors.push_back(make_shared<terrain::Anchor>(ca.contour, ca.trimesh));
+            }
+            
+            StopWatch phaseTimer;
+            world->build(shapes, anchors);
+            r.timings.build = phaseTimer.mark();
+            
+            // replay the insertions in their original order, which yields the same attachments and tags
+            for (size_t i = 0; i < params.attachments.size() && i < cached.attachmentsByBatch.size(); i++) {
+                vector <terrain::AttachmentRef> attachments;
+                for (const auto &ca : cached.attachmentsByBatch[i]) {
+                    auto attachment = make_shared<terrain::Attachment>();
+                    if (world->addAttachment(attachment, ca.position, ca.rotation)) {
+                        attachment->setTag(attachments.size());
+                        attachments.push_back(attachment);
+                    }
+                }
+                r.attachmentsByBatchId[params.attachments[i].batchId] = attachments;
+            }
+            r.timings.attachments = phaseTimer.mark();
+            r.timings.total = timer.mark();
+            
+            return r;
+        }
+        
+    }
+    
+    result generate(const params &params, terrain::WorldRef world) {
+        return generate_planet(params, world, nullptr);
+    }
+    
+    result generate(const params &params, terrain::WorldRef world, const fs::path &cacheDirectory) {
+        StopWatch timer;
+        const uint64_t key = stable_hash(params);
+        
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.planet", static_cast<unsigned long long>(key));
+        const fs::path path = cacheDirectory / name;
+        
+        detail::cached_planet cached;
+        if (detail::read_cached_planet(path, key, cached)) {
+            const double readTime = timer.mark();
+            result r = build_cached_planet(params, world, cached);
+            r.timings.cache = readTime;
+            r.timings.total += readTime;
+            CI_LOG_D("Loaded planet from cache \"" << path.string() << "\" in " << r.timings.total << " seconds");
+            return r;
+        }
+        
+        result r = generate_planet(params, world, &cached);
+        
+        timer.start();
+        try {
+            fs::create_directories(cacheDirectory);
+        } catch (const std::exception &e) {
+            CI_LOG_E("Unable to create planet cache directory \"" << cacheDirectory.string() << "\": " << e.what());
+        }
+        
+        if (detail::write_cached_planet(path, key, cached)) {
+            CI_LOG_D("Wrote planet to cache \"" << path.string() << "\"");
+        }
+        r.timings.cache = timer.mark();
+        r.timings.total += r.timings.cache;
+        
         return r;
     }
 
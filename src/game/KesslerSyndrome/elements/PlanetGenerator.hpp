@@ -192,6 +192,12 @@ namespace game { namespace planet_generation {
          Generate a map given the provided parameters
          */
         Channel8u generate_map(const params::generation_params &p, int size);
+        
+        /**
+         The original unfused map generator, which floodfills each sampled blob of land as it's found, runs each stage
+         as its own full-image pass and samples ci::Perlin per pixel. Kept to verify generate_map produces identical maps.
+         */
+        Channel8u generate_map_reference(const params::generation_params &p, int size);
 
         /**
          Generate just terrain map from given generation parameters,
@@ -206,20 +212,73 @@ namespace game { namespace planet_generation {
          return terrain map
          */
         Channel8u generate_anchors(const params &p, vector <elements::terrain::AnchorRef> &anchors);
+        
+        /**
+         As above, but leave the anchors as their contours and triangulations. Constructing an Anchor takes a drawable id,
+         so this lets the work run concurrently with terrain generation while the Anchors are made in a fixed order after.
+         */
+        Channel8u generate_anchors(const params &p, vector <PolyLine2d> &contours, vector <TriMeshRef> &trimeshes);
 
     }
     
+    /**
+     Wall clock seconds spent in each phase of generate(). The terrain phases (terrain, then partition) run
+     concurrently with the anchors phase, so total is generally less than the sum of the phases. cache is the time
+     spent reading or writing the planet cache, if one was used.
+     */
+    struct phase_timings {
+        double terrain;
+        double partition;
+        double anchors;
+        double build;
+        double attachments;
+        double cache;
+        double total;
+        
+        phase_timings():
+        terrain(0),
+        partition(0),
+        anchors(0),
+        build(0),
+        attachments(0),
+        cache(0),
+        total(0)
+        {}
+    };
+    
     struct result {
         elements::terrain::WorldRef world;
+        
+        // terrain and anchor maps; empty when the world was built from the planet cache
         Channel8u terrainMap;
         Channel8u anchorMap;
+        
         map<size_t,vector<elements::terrain::AttachmentRef>> attachmentsByBatchId;
+        phase_timings timings;
+        
+        // true if the world was built from the planet cache rather than generated
+        bool fromCache;
+        
+        result():
+        fromCache(false)
+        {}
     };
 
     /**
      Generate a terrin::World with given generation parameters; generates both terrain and anchor geometry.
+     Terrain and anchors are generated concurrently, and each attachment batch walks the terrain perimeter with its
+     own random stream seeded from params.terrain.seed and the batch's index, so for given params the result is
+     the same regardless of thread count.
      */
     result generate(const params &params, elements::terrain::WorldRef world);
+    
+    /**
+     Generate as above, but first look in `cacheDirectory for the output of a previous generation with params of the
+     same stable_hash (see PlanetGeneratorCache.hpp). On a hit, the world is built from the cached contours, triangulations
+     and attachment placements without running generation; on a miss the world is generated and its output written
+     to the cache. Either way the resulting geometry and attachments are the same.
+     */
+    result generate(const params &params, elements::terrain::WorldRef world, const fs::path &cacheDirectory);
 
     /**
      Generate a terrin::World with given generation parameters; generates both terrain and anchor geometry.
@@ -0,0 +1,411 @@
+//
+//  PlanetGeneratorCache.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/22/18.
+//
+
+#include "game/KesslerSyndrome/elements/PlanetGeneratorCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
+#include "elements/Terrain/TerrainDetail_Triangulation.hpp"
+
+namespace game { namespace planet_generation {
+    
+    namespace {
+        
+        // bump whenever the file layout, or the output of planet generation for given params, changes;
+        // stable_hash also adds a build identifier, so a forgotten bump only matters within one build
+        // 2: static shapes and anchors are triangulated by terrain::detail::triangulate's ear clipping
+        // 3: floater pruning keeps the shape containing a pixel of the largest solid region
+        // 4: attachment batch seeds are mixed with splitmix64
+        const uint32_t CacheVersion = 4;
+        const char CacheMagic[4] = { 'K', 'S', 'P', 'C' };
+        
+        // 64-bit FNV-1a
+        class stable_hasher {
+        public:
+            
+            stable_hasher():
+            _hash(14695981039346656037ULL)
+            {}
+            
+            void add(const void *data, size_t count) {
+                const uint8_t *bytes = static_cast<const uint8_t*>(data);
+                for (size_t i = 0; i < count; i++) {
+                    _hash = (_hash ^ bytes[i]) * 1099511628211ULL;
+                }
+            }
+            
+            // integral values are widened to 64 bits so the hash doesn't depend on the width of int or size_t
+            void addInteger(int64_t v) {
+                uint8_t bytes[8];
+                for (int i = 0; i < 8; i++) {
+                    bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (i * 8));
+                }
+                add(bytes, 8);
+            }
+            
+            void addDouble(double v) {
+                int64_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                addInteger(bits);
+            }
+            
+            uint64_t get() const {
+                return _hash;
+            }
+        
+        private:
+            
+            uint64_t _hash;
+        };
+        
+        void add_generation_params(stable_hasher &h, const params::generation_params &p) {
+            h.addInteger(p.seed);
+            h.addInteger(p.noiseOctaves);
+            h.addDouble(p.noiseFrequencyScale);
+            h.addDouble(p.surfaceSolidity);
+            h.addDouble(p.surfaceRoughness);
+            h.addDouble(p.vignetteStart);
+            h.addDouble(p.vignetteEnd);
+        }
+        
+#pragma mark - Writing
+        
+        // cache files are written in native byte order; a file from a machine of other endianness fails the magic/version check
+        
+        template<class T>
+        void write_value(ostream &out, const T &v) {
+            out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+        
+        void write_count(ostream &out, size_t count) {
+            write_value(out, static_cast<uint64_t>(count));
+        }
+        
+        void write_polyline(ostream &out, const PolyLine2d &pl) {
+            const auto &points = pl.getPoints();
+            write_value(out, static_cast<uint8_t>(pl.isClosed()));
+            write_count(out, points.size());
+            out.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(dvec2));
+        }
+        
+        void write_trimesh(ostream &out, const TriMeshRef &trimesh) {
+            if (!trimesh) {
+                write_count(out, 0);
+                return;
+            }
+            
+            const size_t numVertices = trimesh->getNumVertices();
+            write_count(out, numVertices);
+            out.write(reinterpret_cast<const char*>(trimesh->getPositions<2>()), numVertices * sizeof(vec2));
+            
+            const auto &indices = trimesh->getIndices();
+            write_count(out, indices.size());
+            out.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+        }
+        
+#pragma mark - Reading
+        
+        // upper bound on any element count in a cache file, so a corrupt count fails the read rather than exhausting memory
+        const uint64_t MaxCount = 1ULL << 32;
+        
+        // the fewest bytes each counted element occupies in a file; a count of more elements than the rest of the file can hold is corrupt
+        const size_t MinPolylineSize = sizeof(uint8_t) + sizeof(uint64_t);
+        const size_t MinTrimeshSize = sizeof(uint64_t);
+        const size_t MinShapeSize = MinPolylineSize + sizeof(uint64_t) + MinTrimeshSize;
+        const size_t MinAnchorSize = MinPolylineSize + MinTrimeshSize;
+        const size_t MinBatchSize = sizeof(uint64_t);
+        
+        template<class T>
+        bool read_value(istream &in, T &v) {
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+        }
+        
+        // read a count of elements of at least `elementSize bytes each, failing if they can't fit between here and `end
+        bool read_count(istream &in, streamoff end, size_t elementSize, size_t &count) {
+            uint64_t c = 0;
+            if (!read_value(in, c) || c > MaxCount) {
+                return false;
+            }
+            
+            const streamoff position = in.tellg();
+            if (position < 0 || position > end || c > static_cast<uint64_t>(end - position) / elementSize) {
+                return false;
+            }
+            
+            count = static_cast<size_t>(c);
+            return true;
+        }
+        
+        bool read_polyline(istream &in, streamoff end, PolyLine2d &pl) {
+            uint8_t closed = 0;
+            size_t count = 0;
+            if (!read_value(in, closed) || !read_count(in, end, sizeof(dvec2), count)) {
+                return false;
+            }
+            
+            vector<dvec2> points(count);
+            if (!in.read(reinterpret_cast<char*>(points.data()), count * sizeof(dvec2))) {
+                return false;
+            }
+            
+            pl = PolyLine2d(points);
+            pl.setClosed(closed != 0);
+            return true;
+        }
+        
+        bool read_trimesh(istream &in, streamoff end, TriMeshRef &trimesh) {
+            size_t numVertices = 0;
+            if (!read_count(in, end, sizeof(vec2), numVertices)) {
+                return false;
+            }
+            
+            if (numVertices == 0) {
+                trimesh.reset();
+                return true;
+            }
+            
+            vector<vec2> positions(numVertices);
+            if (!in.read(reinterpret_cast<char*>(positions.data()), numVertices * sizeof(vec2))) {
+                return false;
+            }
+            
+            size_t numIndices = 0;
+            if (!read_count(in, end, sizeof(uint32_t), numIndices)) {
+                return false;
+            }
+            
+            vector<uint32_t> indices(numIndices);
+            if (!in.read(reinterpret_cast<char*>(indices.data()), numIndices * sizeof(uint32_t))) {
+                return false;
+            }
+            
+            for (uint32_t index : indices) {
+                if (index >= numVertices) {
+                    return false;
+                }
+            }
+            
+            trimesh = make_shared<TriMesh>(TriMesh::Format().positions(2));
+            trimesh->appendPositions(positions.data(), positions.size());
+            if (!indices.empty()) {
+                trimesh->appendIndices(indices.data(), indices.size());
+            }
+            return true;
+        }
+        
+        /**
+         Add the size and modification time of the running executable, so any rebuild invalidates cached planets
+         even if the change to generation didn't bump CacheVersion. This file's compile time is added too, for
+         platforms where the executable can't be found.
+         */
+        void add_build_identifier(stable_hasher &h) {
+            const string compileTime = __DATE__ " " __TIME__;
+            h.add(compileTime.data(), compileTime.size());
+            
+            string executablePath;
+#if defined(__APPLE__)
+            char buffer[PATH_MAX];
+            uint32_t bufferSize = sizeof(buffer);
+            if (_NSGetExecutablePath(buffer, &bufferSize) == 0) {
+                executablePath = buffer;
+            }
+#endif
+            
+            struct stat info;
+            if (!executablePath.empty() && stat(executablePath.c_str(), &info) == 0) {
+                h.addInteger(static_cast<int64_t>(info.st_size));
+                h.addInteger(static_cast<int64_t>(info.st_mtime));
+            }
+        }
+        
+    }
+    
+    uint64_t stable_hash(const params &p) {
+        stable_hasher h;
+        h.addInteger(CacheVersion);
+        add_build_identifier(h);
+        
+        // the triangulation engine is a process wide setting which changes the cached trimeshes
+        h.addInteger(elements::terrain::detail::get_triangulation_engine());
+        
+        h.addInteger(p.size);
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                h.addDouble(p.transform[col][row]);
+            }
+        }
+        
+        h.addInteger(p.terrain.enabled);
+        if (p.terrain.enabled) {
+            add_generation_params(h, p.terrain);
+            h.addInteger(p.terrain.partitionSize);
+            h.addInteger(p.terrain.pruneFloaters);
+        }
+        
+        h.addInteger(p.anchors.enabled);
+        if (p.anchors.enabled) {
+            add_generation_params(h, p.anchors);
+        }
+        
+        h.addInteger(static_cast<int64_t>(p.attachments.size()));
+        for (const auto &ap : p.attachments) {
+            h.addDouble(ap.normalToUpDotTarget);
+            h.addDouble(ap.normalToUpDotRange);
+            h.addDouble(ap.probability);
+            h.addDouble(ap.density);
+            h.addInteger(static_cast<int64_t>(ap.maxCount));
+            h.addInteger(ap.includeHoleContours);
+            h.addInteger(static_cast<int64_t>(ap.batchId));
+        }
+        
+        return h.get();
+    }
+    
+    fs::path default_cache_directory() {
+        return fs::temp_directory_path() / "KesslerSyndrome" / "PlanetCache";
+    }
+    
+    namespace detail {
+        
+        bool read_cached_planet(const fs::path &path, uint64_t paramsHash, cached_planet &planet) {
+            ifstream in(path.string(), ios::in | ios::binary);
+            if (!in) {
+                return false;
+            }
+            
+            in.seekg(0, ios::end);
+            const streamoff end = in.tellg();
+            in.seekg(0, ios::beg);
+            if (end < 0 || !in) {
+                return false;
+            }
+            
+            char magic[4];
+            uint32_t version = 0;
+            uint64_t fileHash = 0;
+            if (!in.read(magic, 4) || memcmp(magic, CacheMagic, 4) != 0 || !read_value(in, version) || version != CacheVersion || !read_value(in, fileHash) || fileHash != paramsHash) {
+                return false;
+            }
+            
+            // counts are bounded by the file's size, but a corrupt file may still ask for more memory than we have; that's a miss, too
+            try {
+                cached_planet result;
+                size_t count = 0;
+                
+                if (!read_count(in, end, MinShapeSize, count)) {
+                    return false;
+                }
+                result.shapes.resize(count);
+                for (auto &shape : result.shapes) {
+                    size_t holeCount = 0;
+                    if (!read_polyline(in, end, shape.outerContour) || !read_count(in, end, MinPolylineSize, holeCount)) {
+                        return false;
+                    }
+                    shape.holeContours.resize(holeCount);
+                    for (auto &hole : shape.holeContours) {
+                        if (!read_polyline(in, end, hole)) {
+                            return false;
+                        }
+                    }
+                    if (!read_trimesh(in, end, shape.trimesh)) {
+                        return false;
+                    }
+                }
+                
+                if (!read_count(in, end, MinAnchorSize, count)) {
+                    return false;
+                }
+                result.anchors.resize(count);
+                for (auto &anchor : result.anchors) {
+                    if (!read_polyline(in, end, anchor.contour) || !read_trimesh(in, end, anchor.trimesh) || !anchor.trimesh) {
+                        return false;
+                    }
+                }
+                
+                if (!read_count(in, end, MinBatchSize, count)) {
+                    return false;
+                }
+                result.attachmentsByBatch.resize(count);
+                for (auto &batch : result.attachmentsByBatch) {
+                    if (!read_count(in, end, sizeof(cached_planet::attachment), count)) {
+                        return false;
+                    }
+                    batch.resize(count);
+                    if (!in.read(reinterpret_cast<char*>(batch.data()), count * sizeof(cached_planet::attachment))) {
+                        return false;
+                    }
+                }
+                
+                planet = std::move(result);
+                return true;
+            } catch (const std::bad_alloc &) {
+                CI_LOG_E("Planet cache file \"" << path.string() << "\" asked for more memory than is available; ignoring it");
+                return false;
+            } catch (const std::length_error &) {
+                CI_LOG_E("Planet cache file \"" << path.string() << "\" has an impossible element count; ignoring it");
+                return false;
+            }
+        }
+        
+        bool write_cached_planet(const fs::path &path, uint64_t paramsHash, const cached_planet &planet) {
+            const fs::path tempPath = path.string() + ".tmp";
+            {
+                ofstream out(tempPath.string(), ios::out | ios::binary | ios::trunc);
+                if (!out) {
+                    return false;
+                }
+                
+                out.write(CacheMagic, 4);
+                write_value(out, CacheVersion);
+                write_value(out, paramsHash);
+                
+                write_count(out, planet.shapes.size());
+                for (const auto &shape : planet.shapes) {
+                    write_polyline(out, shape.outerContour);
+                    write_count(out, shape.holeContours.size());
+                    for (const auto &hole : shape.holeContours) {
+                        write_polyline(out, hole);
+                    }
+                    write_trimesh(out, shape.trimesh);
+                }
+                
+                write_count(out, planet.anchors.size());
+                for (const auto &anchor : planet.anchors) {
+                    write_polyline(out, anchor.contour);
+                    write_trimesh(out, anchor.trimesh);
+                }
+                
+                write_count(out, planet.attachmentsByBatch.size());
+                for (const auto &batch : planet.attachmentsByBatch) {
+                    write_count(out, batch.size());
+                    out.write(reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(cached_planet::attachment));
+                }
+                
+                if (!out) {
+                    return false;
+                }
+            }
+            
+            try {
+                fs::rename(tempPath, path);
+            } catch (const std::exception &e) {
+                CI_LOG_E("Unable to move planet cache file into place at \"" << path.string() << "\": " << e.what());
+                return false;
+            }
+            
+            return true;
+        }
+        
+    }
+    
+}} // end namespace game::planet_generation
@@ -0,0 +1,77 @@
+//
+//  PlanetGeneratorCache.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/22/18.
+//
+
+#ifndef PlanetGeneratorCache_hpp
+#define PlanetGeneratorCache_hpp
+
+#include "game/KesslerSyndrome/elements/PlanetGenerator.hpp"
+
+namespace game { namespace planet_generation {
+    
+    /**
+     Return a hash of every field of `p which affects the generated geometry and attachment placements. Materials
+     aren't included since they're applied when the world is built, but the current triangulation engine is, as is an
+     identifier of the running build so a rebuilt generator never reads a previous build's planets. The hash is computed
+     from the fields' values in a fixed order, so it's the same on every run of a build and can key an on-disk cache.
+     */
+    uint64_t stable_hash(const params &p);
+    
+    /**
+     Default directory for the planet cache used by Planet::create when the planet node sets useGenerationCache="true"
+     */
+    fs::path default_cache_directory();
+    
+    namespace detail {
+        
+        /**
+         The output of planet generation prior to building the world, as stored in the planet cache.
+         */
+        struct cached_planet {
+            
+            struct shape {
+                PolyLine2d outerContour;
+                vector<PolyLine2d> holeContours;
+                
+                // world space triangulation, or null if the shape wasn't static and must be triangulated when built
+                TriMeshRef trimesh;
+            };
+            
+            struct anchor {
+                PolyLine2d contour;
+                TriMeshRef trimesh;
+            };
+            
+            struct attachment {
+                dvec2 position;
+                dvec2 rotation;
+            };
+            
+            // shapes and anchors as passed to World::build
+            vector<shape> shapes;
+            vector<anchor> anchors;
+            
+            // successfully inserted attachment placements, in insertion order, for each entry in params::attachments
+            vector<vector<attachment>> attachmentsByBatch;
+        };
+        
+        /**
+         Read the cache file at `path into `planet, returning false if the file doesn't exist, is for a different
+         params hash or format version, or is truncated or otherwise unreadable. Never throws for a corrupt file.
+         */
+        bool read_cached_planet(const fs::path &path, uint64_t paramsHash, cached_planet &planet);
+        
+        /**
+         Write `planet to `path; the file is written to a temporary and renamed into place so a
+         partially written file is never read. Returns false on failure.
+         */
+        bool write_cached_planet(const fs::path &path, uint64_t paramsHash, const cached_planet &planet);
+        
+    }
+    
+}} // end namespace game::planet_generation
+
+#endif /* PlanetGeneratorCache_hpp */
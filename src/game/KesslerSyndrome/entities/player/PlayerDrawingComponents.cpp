@@ -25,12 +25,21 @@ namespace game {
      vector<vec2> _vertices;
      */
     
-    void LegTessellator::computeBezier(const core::render_state &state, Perlin &perlin) {
+    void LegTessellator::computeBezier(const core::render_state &state, const core::util::GradientNoise &noise) {
         const LegPhysicsRef leg = _leg.lock();
         const seconds_t cycle = (state.time * leg->_cycleScale) + leg->_cycleOffset;
-        dvec2 cp0Offset(perlin.fBm(cycle + 1), perlin.fBm(cycle + 2));
-        dvec2 cp1Offset(perlin.fBm(cycle + 10), perlin.fBm(cycle + 20));
-        dvec2 endOffset(perlin.fBm(cycle + 30), perlin.fBm(cycle + 40));
+        
+        // sample all six wobble offsets in one call
+        const float offsets[6] = { 1, 2, 10, 20, 30, 40 };
+        float samples[6], wobble[6];
+        for (int i = 0; i < 6; i++) {
+            samples[i] = static_cast<float>(cycle + offsets[i]);
+        }
+        noise.fBm(samples, wobble, 6);
+        
+        dvec2 cp0Offset(wobble[0], wobble[1]);
+        dvec2 cp1Offset(wobble[2], wobble[3]);
+        dvec2 endOffset(wobble[4], wobble[5]);
         
         
         // we're doing a simple bezier curve where the control points are equal. we're using
@@ -132,14 +141,14 @@ namespace game {
     {
     }
     
-    void LegBatchDrawer::draw(const core::render_state &state, Perlin &perlin) {
+    void LegBatchDrawer::draw(const core::render_state &state, const core::util::GradientNoise &noise) {
         //
         // update and tesselate our leg geometry
         //
         
         _vertices.clear();
         for (const auto &lt : _legTessellators) {
-            lt->computeBezier(state, perlin);
+            lt->computeBezier(state, noise);
             lt->tessellate(state, 1.5, 10, _legColor, _vertices);
         }
         
@@ -215,7 +224,7 @@ namespace game {
      LegBatchDrawerRef _legBatchDrawer;
      core::util::svg::GroupRef _svgDoc, _root, _bulb;
      vector<core::util::svg::GroupRef> _eyes;
-     ci::Perlin _perlin;
+     core::util::GradientNoise _noise;
      elements::ParticleSystemRef _thrustParticleSystem;
      elements::ParticleEmitterRef _thrustParticleEmitter;
      elements::ParticleEmitter::emission_id _thrustEmissionId;
@@ -301,7 +310,7 @@ namespace game {
         }
         
         {
-            auto phase = timeState.time * M_PI + _perlin.fBm(timeState.time * 0.1);
+            auto phase = timeState.time * M_PI + _noise.fBm(timeState.time * 0.1);
             auto v = (cos(phase) + 1) * 0.5;
             _bulb->setScale(lrp(v, 0.9, 1.1), lrp(1-v, 0.9, 1.1));
         }
@@ -335,7 +344,7 @@ namespace game {
         PlayerPhysicsComponentRef physics = _physics.lock();
         CI_ASSERT_MSG(physics, "PlayerPhysicsComponentRef should be accessbile");
         
-        _legBatchDrawer->draw(renderState, _perlin);
+        _legBatchDrawer->draw(renderState, _noise);
         
         _svgDoc->setPosition(physics->getPosition());
         _svgDoc->setRotation(v2(cpBodyGetRotation(physics->getBody())));
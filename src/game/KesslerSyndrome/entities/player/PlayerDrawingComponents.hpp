@@ -9,9 +9,8 @@
 #ifndef PlayerDrawingComponents_hpp
 #define PlayerDrawingComponents_hpp
 
-#include <cinder/Perlin.h>
-
 #include "core/Core.hpp"
+#include "core/util/GradientNoise.hpp"
 #include "core/util/Svg.hpp"
 #include "elements/ParticleSystem/ParticleSystem.hpp"
 
@@ -45,7 +44,7 @@ namespace game {
         }
         
         LegPhysicsRef getLeg() const { return _leg.lock(); }
-        void computeBezier(const core::render_state &state, Perlin &perlin);
+        void computeBezier(const core::render_state &state, const core::util::GradientNoise &noise);
         void tessellate(const core::render_state &state, float width, size_t subdivisions, ColorA color, vector<vertex> &triangles);
         
     protected:
@@ -60,7 +59,7 @@ namespace game {
         
         LegBatchDrawer(vector<LegTessellatorRef> legTessellators, ColorA legColor);
         
-        void draw(const core::render_state &state, Perlin &perlin);
+        void draw(const core::render_state &state, const core::util::GradientNoise &noise);
         
         void setLegColor(ColorA color) { _legColor = color; }
         ColorA getLegColor() const { return _legColor; }
@@ -106,7 +105,7 @@ namespace game {
         LegBatchDrawerRef _legBatchDrawer;
         core::util::svg::GroupRef _svgDoc, _root, _bulb;
         vector<core::util::svg::GroupRef> _eyes;
-        ci::Perlin _perlin;
+        core::util::GradientNoise _noise;
         elements::ParticleSystemRef _thrustParticleSystem;
         elements::ParticleEmitterRef _thrustParticleEmitter;
         elements::ParticleEmitter::emission_id _thrustEmissionId;
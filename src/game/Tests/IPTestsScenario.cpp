@@ -6,6 +6,7 @@
 //
 
 #include "game/Tests/IPTestsScenario.hpp"
+#include "core/util/GradientNoise.hpp"
 #include "core/util/ImageProcessing.hpp"
 #include "elements/Components/DevComponents.hpp"
 
@@ -41,6 +42,7 @@ void IPTestsScenario::setup() {
             StopWatch suite("IP Suite");
             _channels = vector<Channel8u> {
                 testBlur(s,s),
+                testGaussianBlur(s,s),
                 testRemap(s,s),
                 testDilate(s,s),
                 testErode(s,s),
@@ -71,6 +73,10 @@ void IPTestsScenario::setup() {
                     reset();
                     return true;
 
+                case app::KeyEvent::KEY_v:
+                    verifyKernels();
+                    return true;
+
                 default:
                     return false;
             }
@@ -216,3 +222,258 @@ Channel8u IPTestsScenario::testBlur(int width, int height) {
     
     return channel;
 }
+
+Channel8u IPTestsScenario::testGaussianBlur(int width, int height) {
+    using namespace core::util;
+    Channel8u channel = Channel8u(width, height);
+    
+    Perlin pn(8,123);
+    double frequency = 8.0 / width;
+    ip::in_place::perlin(channel, pn, frequency);
+    ip::in_place::threshold(channel);
+    
+    StopWatch sw("gaussian blur");
+    channel = ip::blur(channel, 24, ip::GAUSSIAN_BLUR);
+    
+    return channel;
+}
+
+void IPTestsScenario::verifyKernels() {
+    using namespace core::util;
+    
+    app::console() << "------------------------------------" << endl << "VERIFYING IMAGE PROCESSING KERNELS" << endl;
+    
+    Rand rng(_seed);
+    auto randomChannel = [&rng](int width, int height) {
+        Channel8u channel(width, height);
+        ip::in_place::fill(channel, 0);
+        
+        // sparse random values over a black and white field, so dilate/erode have edges to find
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                *channel.getData(ivec2(x, y)) = rng.nextFloat() < 0.2f ? static_cast<uint8_t>(rng.nextInt(256)) : (rng.nextBool() ? 255 : 0);
+            }
+        }
+        
+        return channel;
+    };
+    
+    auto identical = [](const Channel8u &a, const Channel8u &b) {
+        for (int y = 0; y < a.getHeight(); y++) {
+            if (memcmp(a.getData(ivec2(0, y)), b.getData(ivec2(0, y)), a.getWidth()) != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    const ip::SimdLevel supported = ip::get_supported_simd_level();
+    const ip::SimdLevel levels[] = { ip::SIMD_NONE, ip::SIMD_SSE2, ip::SIMD_AVX2 };
+    const char *levelNames[] = { "scalar", "sse2", "avx2" };
+    size_t checks = 0, failures = 0;
+    
+    auto check = [&](bool passed, const string &what) {
+        checks++;
+        if (!passed) {
+            failures++;
+            CI_LOG_E("Mismatch: " << what);
+        }
+    };
+    
+    for (ip::SimdLevel level : levels) {
+        if (level > supported) {
+            continue;
+        }
+        
+        ip::set_simd_level(level);
+        
+        // odd sizes exercise the scalar remainder of each row kernel
+        for (int size : { 1, 7, 31, 33, 100, 257 }) {
+            const Channel8u src = randomChannel(size, size + 3);
+            Channel8u a, b;
+            const string tag = string(levelNames[level]) + " size: " + str(size);
+            
+            for (int radius : { 0, 1, 3, 8, 24 }) {
+                ip::dilate(src, a, radius);
+                ip::reference::dilate(src, b, radius);
+                check(identical(a, b), "dilate " + tag + " radius: " + str(radius));
+                
+                ip::erode(src, a, radius);
+                ip::reference::erode(src, b, radius);
+                check(identical(a, b), "erode " + tag + " radius: " + str(radius));
+            }
+            
+            for (int value : { 0, 1, 128, 254, 255 }) {
+                ip::threshold(src, a, value, 200, 7);
+                ip::reference::threshold(src, b, value, 200, 7);
+                check(identical(a, b), "threshold " + tag + " value: " + str(value));
+                
+                ip::remap(src, a, value, 9, 3);
+                ip::reference::remap(src, b, value, 9, 3);
+                check(identical(a, b), "remap " + tag + " value: " + str(value));
+            }
+            
+            a = src.clone();
+            b = src.clone();
+            const Area rect(size / 4 - 2, size / 3, size - 1, size + 8);
+            ip::in_place::fill(a, rect, 77);
+            ip::reference::fill(b, rect, 77);
+            check(identical(a, b), "fill " + tag);
+            
+            for (int radius : { 1, 3, 8 }) {
+                ip::blur(src, a, radius);
+                ip::reference::blur(src, b, radius);
+                check(identical(a, b), "blur " + tag + " radius: " + str(radius));
+            }
+            
+            a = src.clone();
+            b = src.clone();
+            const ivec2 start(size / 2, size / 2);
+            const uint8_t target = src.getValue(start), fill = target + 1;
+            ip::in_place::floodfill(a, start, target, fill);
+            ip::reference::floodfill(b, b, start, target, fill, false);
+            check(identical(a, b), "floodfill " + tag);
+            
+            {
+                // floodfilling each unfilled white pixel in raster order should find the components in label order
+                const ip::component_labels labels = ip::label_components(src, 255);
+                Channel8u filled = src.clone();
+                vector<size_t> areas(labels.components.size(), 0);
+                uint32_t next = 0;
+                bool matched = true;
+                for (int y = 0; y < src.getHeight(); y++) {
+                    for (int x = 0; x < src.getWidth(); x++) {
+                        const uint32_t label = labels.getLabel(x, y);
+                        if (filled.getValue(ivec2(x, y)) == 255) {
+                            ip::in_place::floodfill(filled, ivec2(x, y), 255, 0);
+                            matched = matched && label == ++next;
+                        }
+                        matched = matched && (label != 0) == (src.getValue(ivec2(x, y)) == 255);
+                        if (label && label <= areas.size()) {
+                            areas[label - 1]++;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < areas.size(); i++) {
+                    matched = matched && areas[i] == labels.components[i].area;
+                }
+                check(matched && next == labels.components.size(), "label_components " + tag);
+            }
+            
+            for (int octaves : { 1, 4, 7 }) {
+                Perlin perlin(octaves, _seed);
+                const GradientNoise noise(octaves, _seed);
+                const double frequency = 0.37;
+                const string noiseTag = tag + " octaves: " + str(octaves);
+                
+                ip::in_place::perlin(a, noise, frequency);
+                ip::in_place::perlin(b, perlin, frequency);
+                check(identical(a, b), "perlin " + noiseTag);
+                
+                a = src.clone();
+                b = src.clone();
+                ip::in_place::perlin_add(a, noise, frequency, 0.5);
+                ip::in_place::perlin_add(b, perlin, frequency, 0.5);
+                check(identical(a, b), "perlin_add " + noiseTag);
+                
+                ip::in_place::perlin_abs_thresh(a, noise, frequency, 12);
+                ip::in_place::perlin_abs_thresh(b, perlin, frequency, 12);
+                check(identical(a, b), "perlin_abs_thresh " + noiseTag);
+                
+                // scattered samples, including negative coordinates, compared as floats
+                vector<float> xs(size), ys(size), values(size);
+                for (int i = 0; i < size; i++) {
+                    xs[i] = rng.nextFloat(-300, 300);
+                    ys[i] = rng.nextFloat(-3, 3);
+                }
+                noise.fBm(xs.data(), ys.data(), values.data(), size);
+                bool matched = true;
+                for (int i = 0; i < size; i++) {
+                    matched = matched && values[i] == perlin.fBm(xs[i], ys[i]);
+                }
+                check(matched, "fBm " + noiseTag);
+            }
+        }
+    }
+    
+    app::console() << "Kernels: " << checks << " checks " << failures << " failures" << endl;
+    
+    //
+    //  Time the optimized kernels against the originals on a planet-sized map
+    //
+    
+    const int size = 2048;
+    const Channel8u src = randomChannel(size, size);
+    Channel8u dst;
+    StopWatch timer;
+    
+    for (int radius : { 4, 12, 24 }) {
+        timer.start();
+        ip::dilate(src, dst, radius);
+        const double fast = timer.mark();
+        
+        timer.start();
+        ip::reference::dilate(src, dst, radius);
+        const double slow = timer.mark();
+        
+        app::console() << "dilate " << size << " radius " << radius << ": " << fast << " seconds, reference: " << slow << " seconds (" << (slow / fast) << "x)" << endl;
+    }
+    
+    Channel8u scratch;
+    for (int radius : { 5, 21 }) {
+        timer.start();
+        ip::blur(src, dst, radius);
+        const double kernelTime = timer.mark();
+        
+        timer.start();
+        ip::blur(src, dst, radius, ip::BOX_BLUR, scratch);
+        const double boxTime = timer.mark();
+        
+        timer.start();
+        ip::blur(src, dst, radius, ip::GAUSSIAN_BLUR, scratch);
+        const double gaussianTime = timer.mark();
+        
+        app::console() << "blur " << size << " radius " << radius << ": kernel " << kernelTime << " box " << boxTime << " gaussian " << gaussianTime << " seconds" << endl;
+    }
+    
+    for (ip::SimdLevel level : levels) {
+        if (level > supported) {
+            continue;
+        }
+        
+        ip::set_simd_level(level);
+        timer.start();
+        ip::threshold(src, dst, 128);
+        ip::remap(src, dst, 255, 255, 0);
+        ip::in_place::fill(dst, 0);
+        app::console() << levelNames[level] << " threshold+remap+fill " << size << ": " << timer.mark() << " seconds" << endl;
+    }
+    
+    timer.start();
+    ip::reference::threshold(src, dst, 128);
+    ip::reference::remap(src, dst, 255, 255, 0);
+    ip::reference::fill(dst, dst.getBounds(), 0);
+    app::console() << "reference threshold+remap+fill " << size << ": " << timer.mark() << " seconds" << endl;
+    
+    {
+        Perlin perlin(4, _seed);
+        const GradientNoise noise(4, _seed);
+        
+        timer.start();
+        ip::in_place::perlin(dst, perlin, 1.0 / 32);
+        app::console() << "ci::Perlin perlin " << size << ": " << timer.mark() << " seconds" << endl;
+        
+        for (ip::SimdLevel level : levels) {
+            if (level > supported) {
+                continue;
+            }
+            
+            ip::set_simd_level(level);
+            timer.start();
+            ip::in_place::perlin(dst, noise, 1.0 / 32);
+            app::console() << levelNames[level] << " GradientNoise perlin " << size << ": " << timer.mark() << " seconds" << endl;
+        }
+    }
+    
+    ip::set_simd_level(supported);
+}
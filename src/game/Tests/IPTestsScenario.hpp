@@ -40,6 +40,10 @@ private:
     Channel8u testPerlinNoise(int width, int height);
     Channel8u testPerlinNoise2(int width, int height);
     Channel8u testBlur(int width, int height);
+    Channel8u testGaussianBlur(int width, int height);
+    
+    // check dilate/erode/threshold/remap/fill/blur/floodfill against ip::reference, label_components against floodfill, and GradientNoise against ci::Perlin, bit-for-bit at every supported simd level, and time them
+    void verifyKernels();
 
 private:
     
@@ -6,6 +6,7 @@
 //
 
 
+#include <thread>
 #include <cinder/Perlin.h>
 
 #include "game/Tests/PerlinWorldTestScenario.hpp"
@@ -16,8 +17,12 @@
 #include "elements/Terrain/Terrain.hpp"
 #include "elements/Terrain/TerrainDetail.hpp"
 #include "elements/Terrain/TerrainDetail_MarchingSquares.hpp"
+#include "elements/Terrain/TerrainDetail_Triangulation.hpp"
 #include "game/KesslerSyndrome/elements/PlanetGenerator.hpp"
+#include "game/KesslerSyndrome/elements/PlanetGeneratorCache.hpp"
 #include "game/KesslerSyndrome/elements/PlanetGreebling.hpp"
+#include "game/Tests/util/Measurement.hpp"
+#include "game/Tests/util/TerrainCutBenchmark.hpp"
 
 using namespace core;
 using namespace elements;
@@ -147,38 +152,7 @@ void PerlinWorldTestScenario::setup() {
     auto viewportController = make_shared<ViewportController>(getMainViewport<Viewport>());
     getStage()->addObject(Object::with("ViewportController", { viewportController }));
 
-    auto params = game::planet_generation::params(512).defaultCenteringTransform(4);
-    
-    params.terrain.seed = _seed;
-    params.terrain.noiseOctaves = 2;
-    params.terrain.noiseFrequencyScale = 2;
-    params.terrain.pruneFloaters = false;
-    params.terrain.partitionSize = 100;
-    params.terrain.surfaceSolidity = _surfaceSolidity;
-    params.terrain.surfaceRoughness = _surfaceRoughness;
-    params.terrain.material = TerrainMaterial;
-    
-    params.anchors.seed = _seed + 1;
-    params.anchors.noiseOctaves = 2;
-    params.anchors.noiseFrequencyScale = 2;
-    params.anchors.surfaceSolidity = _surfaceSolidity;
-    params.anchors.surfaceRoughness = 0;
-    params.anchors.vignetteStart *= 0.5;
-    params.anchors.vignetteEnd *= 0.5;
-    params.anchors.material = AnchorMaterial;
-
-    if ((false)) {
-        auto ap = game::planet_generation::params::perimeter_attachment_params(0);
-        ap.batchId = 0;
-        ap.normalToUpDotTarget = 1;
-        ap.normalToUpDotRange = 1;
-        ap.probability = 0.875;
-        ap.density = 2;
-        ap.includeHoleContours = true;
-        params.attachments.push_back(ap);
-    }
-    
-    auto terrainGen = game::planet_generation::generate(params, getStage()->getSpace());
+    auto terrainGen = game::planet_generation::generate(getPlanetGenerationParams(), getStage()->getSpace());
     _terrain = terrain::TerrainObject::create("Terrain", terrainGen.world, DrawLayers::TERRAIN);
     getStage()->addObject(_terrain);
     
@@ -347,6 +321,46 @@ bool PerlinWorldTestScenario::onKeyDown(const app::KeyEvent &event) {
             }
             return true;
             
+        case 'g':
+            timePlanetGeneration();
+            return true;
+            
+        case 'm':
+            timeMarching();
+            return true;
+            
+        case 'n':
+            timeMapGeneration();
+            return true;
+            
+        case 'p':
+            timePlanetCache();
+            return true;
+            
+        case 'o':
+            timeSimplification();
+            return true;
+            
+        case 't':
+            timeContourTree();
+            return true;
+            
+        case 'e':
+            timeTriangulation();
+            return true;
+            
+        case 'k':
+            timeCollisionShapes();
+            return true;
+            
+        case 'l':
+            timePointQueries();
+            return true;
+            
+        case 'd':
+            verifyThreadCountIndependence();
+            return true;
+            
         case '.':
             _recordCuts = !_recordCuts;
             CI_LOG_D("_recordCuts: " << boolalpha << _recordCuts);
@@ -365,6 +379,684 @@ bool PerlinWorldTestScenario::onKeyDown(const app::KeyEvent &event) {
     return false;
 }
 
+game::planet_generation::params PerlinWorldTestScenario::getPlanetGenerationParams(int size) const {
+    auto params = game::planet_generation::params(size).defaultCenteringTransform(4);
+    
+    params.terrain.seed = _seed;
+    params.terrain.noiseOctaves = 2;
+    params.terrain.noiseFrequencyScale = 2;
+    params.terrain.pruneFloaters = false;
+    params.terrain.partitionSize = 100;
+    params.terrain.surfaceSolidity = _surfaceSolidity;
+    params.terrain.surfaceRoughness = _surfaceRoughness;
+    params.terrain.material = TerrainMaterial;
+    
+    params.anchors.seed = _seed + 1;
+    params.anchors.noiseOctaves = 2;
+    params.anchors.noiseFrequencyScale = 2;
+    params.anchors.surfaceSolidity = _surfaceSolidity;
+    params.anchors.surfaceRoughness = 0;
+    params.anchors.vignetteStart *= 0.5;
+    params.anchors.vignetteEnd *= 0.5;
+    params.anchors.material = AnchorMaterial;
+
+    if ((false)) {
+        auto ap = game::planet_generation::params::perimeter_attachment_params(0);
+        ap.batchId = 0;
+        ap.normalToUpDotTarget = 1;
+        ap.normalToUpDotRange = 1;
+        ap.probability = 0.875;
+        ap.density = 2;
+        ap.includeHoleContours = true;
+        params.attachments.push_back(ap);
+    }
+    
+    return params;
+}
+
+bool PerlinWorldTestScenario::runCutBenchmark(const fs::path &cutsPath, const fs::path &csvPath) const {
+    TerrainCutRecorder recorder(cutsPath);
+    if (recorder.getCuts().empty()) {
+        CI_LOG_E("No recorded cuts to benchmark in \"" << cutsPath.string() << "\"");
+        return false;
+    }
+    
+    const auto params = getPlanetGenerationParams();
+    auto results = TerrainCutBenchmark::run([&params](const SpaceAccessRef &space) -> terrain::WorldRef {
+        return game::planet_generation::generate(params, space).world;
+    }, recorder.getCuts());
+    
+    TerrainCutBenchmark::logSummary(results);
+    
+    fstream out(csvPath.string(), ios::out | ios::trunc);
+    TerrainCutBenchmark::writeCsv(results, out);
+    out.close();
+    
+    CI_LOG_D("Wrote cut benchmark to \"" << csvPath.string() << "\"");
+    return static_cast<bool>(out);
+}
+
+void PerlinWorldTestScenario::timePlanetGeneration() {
+    measurement::banner("PLANET GENERATION");
+    
+    terrain::World::ScopedGraphicsDisabled noGraphics;
+    
+    for (int size : { 512, 1024, 2048, 4096 }) {
+        auto params = getPlanetGenerationParams(size);
+        const double partitionSize = params.terrain.partitionSize;
+        
+        // time once without partitioning, and once with, to isolate the cost of World::partition
+        double times[2];
+        size_t shapeCounts[2];
+        game::planet_generation::phase_timings timings;
+        for (int i = 0; i < 2; i++) {
+            params.terrain.partitionSize = i == 0 ? 0 : partitionSize;
+            
+            auto stage = make_shared<Stage>("Planet Generation Timing");
+            game::planet_generation::result result;
+            times[i] = measurement::seconds([&]() {
+                result = game::planet_generation::generate(params, stage->getSpace());
+            });
+            timings = result.timings;
+            shapeCounts[i] = result.world->getStaticGroup()->getShapes().size();
+            for (const auto &group : result.world->getDynamicGroups()) {
+                shapeCounts[i] += group->getShapes().size();
+            }
+            
+            // world has to go before the stage which owns its space
+            result.world.reset();
+        }
+        
+        app::console() << "Map size " << size << " partitionSize " << partitionSize << ":" << endl;
+        app::console() << "\tunpartitioned: " << times[0] << " seconds (" << shapeCounts[0] << " shapes)" << endl;
+        app::console() << "\tpartitioned: " << times[1] << " seconds (" << shapeCounts[1] << " shapes)" << endl;
+        app::console() << "\tpartitioning cost: " << (times[1] - times[0]) << " seconds" << endl;
+        app::console() << "\tphases (partitioned): terrain: " << timings.terrain << " partition: " << timings.partition
+            << " anchors: " << timings.anchors << " build: " << timings.build << " attachments: " << timings.attachments
+            << " total: " << timings.total << " seconds" << endl;
+    }
+}
+
+void PerlinWorldTestScenario::timeCollisionShapes() {
+    measurement::banner("COLLISION SHAPE");
+    
+    terrain::World::ScopedGraphicsDisabled noGraphics;
+    
+    const int steps = 60;
+    const int queries = 1000;
+    
+    for (int size : { 1024, 2048, 4096 }) {
+        app::console() << "Map size " << size << ":" << endl;
+        
+        for (bool convexDecomposition : { false, true }) {
+            auto params = getPlanetGenerationParams(size);
+            params.terrain.material.convexDecomposition = convexDecomposition;
+            params.anchors.material.convexDecomposition = convexDecomposition;
+            
+            auto stage = make_shared<Stage>("Collision Shape Timing");
+            game::planet_generation::result result;
+            const double generateTime = measurement::seconds([&]() {
+                result = game::planet_generation::generate(params, stage->getSpace());
+            });
+            
+            cpSpace *space = stage->getSpace()->getSpace();
+            size_t shapeCount = 0;
+            cpSpaceEachShape(space, [](cpShape *shape, void *data) {
+                (*static_cast<size_t*>(data))++;
+            }, &shapeCount);
+            
+            const double stepTime = measurement::seconds([&]() {
+                for (int i = 0; i < steps; i++) {
+                    cpSpaceStep(space, 1.0 / 60.0);
+                }
+            }) / steps;
+            
+            // small queries scattered over the planet, as made by Stage::querySegment and friends
+            const cpBB bb = result.world->getStaticGroup()->getBB();
+            Rand rng(_seed);
+            size_t hits = 0;
+            const double queryTime = measurement::seconds([&]() {
+                for (int i = 0; i < queries; i++) {
+                    const dvec2 p(rng.nextFloat(bb.l, bb.r), rng.nextFloat(bb.b, bb.t));
+                    cpSpaceBBQuery(space, cpBBNewForCircle(cpv(p), 10), CP_SHAPE_FILTER_ALL, [](cpShape *shape, void *data) {
+                        (*static_cast<size_t*>(data))++;
+                    }, &hits);
+                }
+            }) / queries;
+            
+            app::console() << "\t" << (convexDecomposition ? "convex decomposition" : "triangles") << ": " << shapeCount << " collision shapes, generate: " << generateTime
+                << " seconds, step: " << stepTime << " seconds, bb query: " << queryTime << " seconds (" << hits << " hits)" << endl;
+            
+            // world has to go before the stage which owns its space
+            result.world.reset();
+        }
+    }
+}
+
+void PerlinWorldTestScenario::timeMapGeneration() {
+    measurement::banner("MAP GENERATION");
+    
+    for (int size : { 1024, 2048, 4096 }) {
+        const auto params = getPlanetGenerationParams(size);
+        
+        Channel8u reference, fused;
+        const double referenceTime = measurement::seconds([&]() {
+            reference = game::planet_generation::detail::generate_map_reference(params.terrain, size);
+        });
+        const double fusedTime = measurement::seconds([&]() {
+            fused = game::planet_generation::detail::generate_map(params.terrain, size);
+        });
+        
+        bool identical = true;
+        for (int y = 0; identical && y < size; y++) {
+            identical = memcmp(reference.getData(ivec2(0, y)), fused.getData(ivec2(0, y)), size) == 0;
+        }
+        
+        app::console() << "Map size " << size << ":" << endl;
+        app::console() << "\treference: " << referenceTime << " seconds" << endl;
+        measurement::compare("fused", fusedTime, referenceTime, identical);
+    }
+}
+
+void PerlinWorldTestScenario::timePlanetCache() {
+    measurement::banner("PLANET CACHE");
+    
+    terrain::World::ScopedGraphicsDisabled noGraphics;
+    
+    // use a scratch directory so the first generation of each size is always a miss
+    const fs::path cacheDirectory = fs::temp_directory_path() / "KesslerSyndrome" / "PlanetCacheTiming";
+    fs::remove_all(cacheDirectory);
+    
+    struct summary {
+        size_t shapes, triangles;
+        vector<dvec2> attachmentPositions;
+        
+        bool operator==(const summary &other) const {
+            return shapes == other.shapes && triangles == other.triangles && attachmentPositions == other.attachmentPositions;
+        }
+    };
+    
+    auto summarize = [](const game::planet_generation::result &result) {
+        summary s = { 0, 0 };
+        auto addShapes = [&s](const terrain::GroupBaseRef &group) {
+            for (const auto &shape : group->getShapes()) {
+                s.shapes++;
+                s.triangles += shape->getTriMesh()->getNumTriangles();
+            }
+        };
+        
+        addShapes(result.world->getStaticGroup());
+        for (const auto &group : result.world->getDynamicGroups()) {
+            addShapes(group);
+        }
+        
+        for (const auto &batch : result.attachmentsByBatchId) {
+            for (const auto &attachment : batch.second) {
+                s.attachmentPositions.push_back(attachment->getWorldPosition());
+            }
+        }
+        
+        return s;
+    };
+    
+    for (int size : { 512, 1024, 2048, 4096 }) {
+        const auto params = getPlanetGenerationParams(size);
+        
+        double times[2];
+        summary summaries[2];
+        bool fromCache[2];
+        for (int i = 0; i < 2; i++) {
+            auto stage = make_shared<Stage>("Planet Cache Timing");
+            auto world = make_shared<terrain::World>(stage->getSpace(), params.terrain.material, params.anchors.material);
+            
+            game::planet_generation::result result;
+            times[i] = measurement::seconds([&]() {
+                result = game::planet_generation::generate(params, world, cacheDirectory);
+            });
+            summaries[i] = summarize(result);
+            fromCache[i] = result.fromCache;
+            
+            // world has to go before the stage which owns its space
+            result.world.reset();
+            world.reset();
+        }
+        
+        app::console() << "Map size " << size << " (" << summaries[0].shapes << " shapes, " << summaries[0].attachmentPositions.size() << " attachments):" << endl;
+        app::console() << "\tcold: " << times[0] << " seconds (from cache: " << boolalpha << fromCache[0] << ")" << endl;
+        measurement::compare(string("warm (from cache: ") + (fromCache[1] ? "true" : "false") + ")", times[1], times[0], summaries[0] == summaries[1]);
+    }
+    
+    fs::remove_all(cacheDirectory);
+}
+
+void PerlinWorldTestScenario::timeSimplification() {
+    measurement::banner("CONTOUR SIMPLIFICATION");
+    
+    using namespace core::util;
+    
+    const ip::SimdLevel supported = ip::get_supported_simd_level();
+    const ip::SimdLevel levels[] = { ip::SIMD_NONE, ip::SIMD_SSE2, ip::SIMD_AVX2 };
+    const char *levelNames[] = { "scalar", "sse2", "avx2" };
+    const double threshold = 0.125;
+    
+    Rand rng(_seed);
+    for (size_t count : { 10000, 100000, 1000000 }) {
+        
+        // a lumpy circle with a little jitter, closed by repeating the first vertex as marched contours are
+        vector<dvec2> contour;
+        contour.reserve(count + 1);
+        const double radius = count / 50.0;
+        for (size_t i = 0; i < count; i++) {
+            const double t = 2 * M_PI * i / count;
+            const double r = radius * (1 + 0.3 * sin(7 * t) + 0.1 * sin(31 * t));
+            contour.push_back(dvec2(r * cos(t) + rng.nextFloat(-0.05, 0.05), r * sin(t) + rng.nextFloat(-0.05, 0.05)));
+        }
+        contour.push_back(contour.front());
+        
+        vector<dvec2> reference, simplified;
+        const double referenceTime = measurement::seconds([&]() {
+            core::util::reference::simplify(contour, reference, threshold);
+        });
+        
+        app::console() << "Contour of " << count << " vertices:" << endl;
+        app::console() << "\treference: " << referenceTime << " seconds (" << reference.size() << " vertices)" << endl;
+        
+        for (ip::SimdLevel level : levels) {
+            if (level > supported) {
+                continue;
+            }
+            
+            ip::set_simd_level(level);
+            const double simplifyTime = measurement::seconds([&]() {
+                simplify(contour, simplified, threshold);
+            });
+            
+            measurement::compare(levelNames[level], simplifyTime, referenceTime, simplified == reference);
+        }
+        
+        const double visvalingamTime = measurement::seconds([&]() {
+            simplify_visvalingam(contour, simplified, threshold * threshold);
+        });
+        app::console() << "\tvisvalingam-whyatt: " << visvalingamTime << " seconds (" << simplified.size() << " vertices)" << endl;
+    }
+    
+    ip::set_simd_level(supported);
+}
+
+void PerlinWorldTestScenario::timeMarching() {
+    measurement::banner("MARCHING SQUARES");
+    
+    const size_t hardwareThreads = max<size_t>(thread::hardware_concurrency(), 1);
+    
+    for (int size : { 1024, 2048, 4096 }) {
+        const auto params = getPlanetGenerationParams(size);
+        const Channel8u map = game::planet_generation::detail::generate_map(params.terrain, size);
+        
+        auto identical = [](const vector<PolyLine2d> &a, const vector<PolyLine2d> &b) {
+            bool identical = a.size() == b.size();
+            for (size_t i = 0; identical && i < a.size(); i++) {
+                identical = a[i].getPoints() == b[i].getPoints();
+            }
+            return identical;
+        };
+        
+        // the original std::map stitching is the reference everything else has to match
+        vector<PolyLine2d> reference;
+        const double mapTime = measurement::seconds([&]() {
+            terrain::detail::MapPerimeterGenerator mapGenerator(terrain::detail::PerimeterGenerator::CLOCKWISE);
+            marching_squares::march(terrain::detail::Channel8uVoxelStoreAdapter(map), mapGenerator, 0.5);
+            mapGenerator.generate(reference, params.transform);
+        });
+        
+        vector<PolyLine2d> serial;
+        const double serialTime = measurement::seconds([&]() {
+            terrain::detail::march_serial(map, 0.5, params.transform, serial);
+        });
+        
+        app::console() << "Map size " << size << " (" << reference.size() << " perimeters):" << endl;
+        app::console() << "\tserial, std::map stitching: " << mapTime << " seconds" << endl;
+        measurement::compare("serial, sorted stitching", serialTime, mapTime, identical(serial, reference));
+        
+        for (size_t threads = 1; threads <= hardwareThreads; threads *= 2) {
+            core::util::ThreadPool pool(threads);
+            vector<PolyLine2d> tiled;
+            const double tiledTime = measurement::seconds([&]() {
+                terrain::detail::march_tiled(map, 0.5, params.transform, tiled, 256, pool);
+            });
+            
+            measurement::compare("tiled, " + str(threads) + " threads", tiledTime, mapTime, identical(tiled, reference));
+        }
+    }
+}
+
+void PerlinWorldTestScenario::timeContourTree() {
+    measurement::banner("CONTOUR TREE");
+    
+    std::function<bool(const vector<terrain::detail::contour_tree_node_ref>&, const vector<terrain::detail::contour_tree_node_ref>&)> identical =
+    [&identical](const vector<terrain::detail::contour_tree_node_ref> &a, const vector<terrain::detail::contour_tree_node_ref> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i]->contour.getPoints() != b[i]->contour.getPoints() || !identical(a[i]->children, b[i]->children)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    for (int size : { 512, 1024, 2048, 4096 }) {
+        const auto params = getPlanetGenerationParams(size);
+        const Channel8u map = game::planet_generation::detail::generate_map(params.terrain, size);
+        
+        vector<PolyLine2d> soup;
+        terrain::detail::march_serial(map, 0.5, params.transform, soup);
+        
+        vector<terrain::detail::contour_tree_node_ref> reference, tree;
+        const double referenceTime = measurement::seconds([&]() {
+            reference = terrain::detail::reference::build_contour_tree(soup);
+        });
+        const double treeTime = measurement::seconds([&]() {
+            tree = terrain::detail::build_contour_tree(soup);
+        });
+        
+        app::console() << "Map size " << size << " (" << soup.size() << " contours):" << endl;
+        app::console() << "\treference: " << referenceTime << " seconds" << endl;
+        measurement::compare("sweep", treeTime, referenceTime, identical(tree, reference));
+    }
+}
+
+void PerlinWorldTestScenario::timeTriangulation() {
+    measurement::banner("TRIANGULATION");
+    
+    using namespace terrain::detail;
+    
+    struct polygon {
+        PolyLine2d contour;
+        vector<PolyLine2d> holes;
+    };
+    
+    auto measure = [](const string &name, const vector<polygon> &polygons) {
+        const TriangulationEngine engines[] = { TRIANGULATION_LIBTESS, TRIANGULATION_EAR_CLIPPING };
+        const char *engineNames[] = { "libtess", "ear clipping" };
+        
+        size_t vertices = 0;
+        for (const auto &p : polygons) {
+            vertices += p.contour.size();
+            for (const auto &hole : p.holes) {
+                vertices += hole.size();
+            }
+        }
+        
+        app::console() << name << " (" << polygons.size() << " polygons, " << vertices << " vertices):" << endl;
+        
+        double libtessTime = 0;
+        triangulation result;
+        for (TriangulationEngine engine : engines) {
+            size_t triangles = 0;
+            double area = 0;
+            
+            const double time = measurement::seconds([&]() {
+                for (const auto &p : polygons) {
+                    triangulate(p.contour, p.holes, result, engine);
+                    triangles += result.getNumTriangles();
+                    for (size_t i = 0; i + 2 < result.indices.size(); i += 3) {
+                        const vec2 a = result.vertices[result.indices[i]], b = result.vertices[result.indices[i + 1]], c = result.vertices[result.indices[i + 2]];
+                        area += 0.5 * abs(cross(vec3(b - a, 0), vec3(c - a, 0)).z);
+                    }
+                }
+            });
+            
+            if (engine == TRIANGULATION_LIBTESS) {
+                libtessTime = time;
+            }
+            
+            app::console() << "\t" << engineNames[engine] << ": " << time << " seconds (" << (libtessTime / time) << "x) triangles: " << triangles << " area: " << area << endl;
+        }
+    };
+    
+    // the current terrain's shapes; after cutting, these are mostly cut fragments
+    vector<polygon> fragments;
+    auto addShapes = [&fragments](const set<terrain::ShapeRef> &shapes) {
+        for (const auto &shape : shapes) {
+            polygon p = { shape->getOuterContour().model, {} };
+            for (const auto &hole : shape->getHoleContours()) {
+                p.holes.push_back(hole.model);
+            }
+            fragments.push_back(p);
+        }
+    };
+    
+    const auto world = _terrain->getWorld();
+    addShapes(world->getStaticGroup()->getShapes());
+    for (const auto &group : world->getDynamicGroups()) {
+        addShapes(group->getShapes());
+    }
+    measure("Current terrain shapes", fragments);
+    
+    // planet scale contours, paired with their holes as build_from_contour_tree pairs them
+    for (int size : { 1024, 2048, 4096 }) {
+        const auto params = getPlanetGenerationParams(size);
+        const Channel8u map = game::planet_generation::detail::generate_map(params.terrain, size);
+        
+        vector<PolyLine2d> soup;
+        march_serial(map, 0.5, params.transform, soup);
+        
+        vector<polygon> polygons;
+        std::function<void(const contour_tree_node_ref&)> addPolygons = [&](const contour_tree_node_ref &node) {
+            polygon p = { node->contour, {} };
+            for (const auto &child : node->children) {
+                p.holes.push_back(child->contour);
+                for (const auto &grandchild : child->children) {
+                    addPolygons(grandchild);
+                }
+            }
+            polygons.push_back(p);
+        };
+        
+        for (const auto &root : build_contour_tree(soup)) {
+            addPolygons(root);
+        }
+        
+        measure("Map size " + str(size), polygons);
+    }
+}
+
+void PerlinWorldTestScenario::timePointQueries() {
+    measurement::banner("POINT QUERY");
+    
+    // the test Shape::isLocalPointInside made of every triangle before triangle_grid
+    auto linearContains = [](const TriMesh &trimesh, dvec2 p) {
+        const float epsilon = 1e-4;
+        for (size_t i = 0, N = trimesh.getNumTriangles(); i < N; i++) {
+            vec2 a, b, c;
+            trimesh.getTriangleVertices(i, &a, &b, &c);
+            
+            float alpha = ((b.y - c.y)*(p.x - c.x) + (c.x - b.x)*(p.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
+            float beta = ((c.y - a.y)*(p.x - c.x) + (a.x - c.x)*(p.y - c.y)) / ((b.y - c.y)*(a.x - c.x) + (c.x - b.x)*(a.y - c.y));
+            float gamma = 1.0f - alpha - beta;
+            
+            if (alpha > -epsilon && beta > -epsilon && gamma > -epsilon) {
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    const int queriesPerShape = 1000;
+    Rand rng(_seed);
+    
+    size_t shapes = 0, triangles = 0, queries = 0, inside = 0, mismatches = 0;
+    double buildTime = 0, linearTime = 0, gridTime = 0;
+    vector<dvec2> points;
+    
+    for (const auto &shape : _terrain->getWorld()->getStaticGroup()->getShapes()) {
+        const TriMeshRef &trimesh = shape->getTriMesh();
+        if (!trimesh || trimesh->getNumTriangles() == 0) {
+            continue;
+        }
+        
+        // points over the triangles' bounds and a little beyond
+        dvec2 minP(numeric_limits<double>::max()), maxP(-numeric_limits<double>::max());
+        for (size_t i = 0, N = trimesh->getNumTriangles(); i < N; i++) {
+            vec2 v[3];
+            trimesh->getTriangleVertices(i, &v[0], &v[1], &v[2]);
+            for (const auto &p : v) {
+                minP = min(minP, dvec2(p));
+                maxP = max(maxP, dvec2(p));
+            }
+        }
+        const dvec2 margin = (maxP - minP) * 0.1;
+        minP -= margin;
+        maxP += margin;
+        
+        points.clear();
+        for (int i = 0; i < queriesPerShape; i++) {
+            points.emplace_back(rng.nextFloat(minP.x, maxP.x), rng.nextFloat(minP.y, maxP.y));
+        }
+        
+        shared_ptr<terrain::detail::triangle_grid> grid;
+        buildTime += measurement::seconds([&]() {
+            grid = make_shared<terrain::detail::triangle_grid>(*trimesh);
+        });
+        
+        vector<bool> linearResults, gridResults;
+        linearTime += measurement::seconds([&]() {
+            for (const auto &p : points) {
+                linearResults.push_back(linearContains(*trimesh, p));
+            }
+        });
+        gridTime += measurement::seconds([&]() {
+            for (const auto &p : points) {
+                gridResults.push_back(grid->contains(p));
+            }
+        });
+        
+        for (size_t i = 0; i < points.size(); i++) {
+            inside += linearResults[i] ? 1 : 0;
+            mismatches += linearResults[i] != gridResults[i] ? 1 : 0;
+        }
+        
+        shapes++;
+        triangles += trimesh->getNumTriangles();
+        queries += points.size();
+    }
+    
+    app::console() << shapes << " shapes, " << triangles << " triangles, " << queries << " queries (" << inside << " inside):" << endl;
+    app::console() << "\tlinear: " << linearTime << " seconds" << endl;
+    app::console() << "\ttriangle_grid build: " << buildTime << " seconds" << endl;
+    measurement::compare("triangle_grid", gridTime, linearTime, mismatches == 0);
+}
+
+void PerlinWorldTestScenario::verifyThreadCountIndependence() {
+    app::console() << "------------------------------------" << endl << "VERIFYING THREAD COUNT INDEPENDENCE" << endl;
+    
+    terrain::World::ScopedGraphicsDisabled noGraphics;
+    
+    // flatten everything generation produces which should not depend on thread count; drawable ids are
+    // recorded relative to the first id handed out, since the counter is shared by every world ever made
+    const auto summarize = [](const game::planet_generation::result &result) {
+        vector<double> summary;
+        
+        const set<terrain::ShapeRef> staticShapes = result.world->getStaticGroup()->getShapes();
+        vector<terrain::ShapeRef> shapes(staticShapes.begin(), staticShapes.end());
+        for (const auto &group : result.world->getDynamicGroups()) {
+            const set<terrain::ShapeRef> groupShapes = group->getShapes();
+            shapes.insert(shapes.end(), groupShapes.begin(), groupShapes.end());
+        }
+        sort(shapes.begin(), shapes.end(), [](const terrain::ShapeRef &a, const terrain::ShapeRef &b) {
+            return a->getId() < b->getId();
+        });
+        
+        const auto &anchors = result.world->getAnchors();
+        size_t firstId = numeric_limits<size_t>::max();
+        for (const auto &shape : shapes) {
+            firstId = min(firstId, shape->getId());
+        }
+        for (const auto &anchor : anchors) {
+            firstId = min(firstId, anchor->getId());
+        }
+        
+        const auto addContour = [&summary](const PolyLine2d &contour) {
+            summary.push_back(contour.size());
+            for (const auto &p : contour.getPoints()) {
+                summary.push_back(p.x);
+                summary.push_back(p.y);
+            }
+        };
+        
+        summary.push_back(shapes.size());
+        for (const auto &shape : shapes) {
+            summary.push_back(shape->getId() - firstId);
+            addContour(shape->getOuterContour().model);
+            summary.push_back(shape->getHoleContours().size());
+            for (const auto &hole : shape->getHoleContours()) {
+                addContour(hole.model);
+            }
+            summary.push_back(shape->getTriMesh() ? shape->getTriMesh()->getNumTriangles() : 0);
+        }
+        
+        summary.push_back(anchors.size());
+        for (const auto &anchor : anchors) {
+            summary.push_back(anchor->getId() - firstId);
+            addContour(anchor->getContour());
+            summary.push_back(anchor->getTriMesh() ? anchor->getTriMesh()->getNumTriangles() : 0);
+        }
+        
+        for (const auto &batch : result.attachmentsByBatchId) {
+            summary.push_back(batch.first);
+            summary.push_back(batch.second.size());
+            for (const auto &attachment : batch.second) {
+                const dvec2 position = attachment->getWorldPosition();
+                const dvec2 rotation = attachment->getWorldRotation();
+                summary.push_back(position.x);
+                summary.push_back(position.y);
+                summary.push_back(rotation.x);
+                summary.push_back(rotation.y);
+                summary.push_back(attachment->getTag());
+            }
+        }
+        
+        return summary;
+    };
+    
+    const size_t hardwareThreads = max<size_t>(std::thread::hardware_concurrency(), 2);
+    
+    bool allIdentical = true;
+    for (int size : { 512, 1024, 2048 }) {
+        auto params = getPlanetGenerationParams(size);
+        
+        // attachments are off in the interactive params, but their per-batch random streams need checking too
+        auto ap = game::planet_generation::params::perimeter_attachment_params(0);
+        ap.batchId = 0;
+        ap.probability = 0.875;
+        ap.density = 2;
+        ap.includeHoleContours = true;
+        params.attachments.push_back(ap);
+        
+        vector<double> summaries[2];
+        const size_t threadCounts[2] = { 1, hardwareThreads };
+        for (int i = 0; i < 2; i++) {
+            core::util::ThreadPool pool(threadCounts[i]);
+            core::util::ThreadPool::ScopedSharedOverride sharedPool(pool);
+            
+            auto stage = make_shared<Stage>("Thread Count Independence");
+            auto result = game::planet_generation::generate(params, stage->getSpace());
+            summaries[i] = summarize(result);
+            
+            // world has to go before the stage which owns its space
+            result.attachmentsByBatchId.clear();
+            result.world.reset();
+        }
+        
+        const bool identical = summaries[0] == summaries[1];
+        allIdentical = allIdentical && identical;
+        app::console() << "Map size " << size << ": 1 thread vs " << hardwareThreads << " threads identical: " << boolalpha << identical << endl;
+    }
+    
+    CI_ASSERT_MSG(allIdentical, "planet generation output depends on thread count");
+}
+
 void PerlinWorldTestScenario::reset() {
     cleanup();
     setup();
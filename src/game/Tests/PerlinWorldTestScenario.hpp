@@ -13,6 +13,7 @@
 #include "core/Core.hpp"
 #include "elements/Terrain/Terrain.hpp"
 #include "game/Tests/util/TerrainCutRecorder.hpp"
+#include "game/KesslerSyndrome/elements/PlanetGenerator.hpp"
 
 class PerlinWorldTestScenario : public core::Scenario {
 public:
@@ -33,6 +34,13 @@ public:
 
     void reset();
 
+    /**
+     Replay the cuts recorded in `cutsPath (as saved by the cut recorder) against a world built as setup() builds its
+     terrain, with graphics disabled, writing per-cut timings to `csvPath. This uses neither the scenario's stage nor
+     a GL context, so it can run before (or instead of) setup(); TestsApp runs it for --terrain-cut-benchmark.
+     */
+    bool runCutBenchmark(const fs::path &cutsPath, const fs::path &csvPath) const;
+
 private:
 
     struct segment {
@@ -49,6 +57,39 @@ private:
     vector <segment> testMarch(Channel8u &iso) const;
     void onCutPerformed(dvec2 a, dvec2 b, double radius);
 
+    game::planet_generation::params getPlanetGenerationParams(int size = 512) const;
+
+
+    // time planet generation with and without partitioning for map sizes 512 through 4096
+    void timePlanetGeneration();
+
+    // time generating planets of sizes 512 through 4096 with an empty planet cache and then again from the cache, verifying identical worlds
+    void timePlanetCache();
+
+    // generate planets of sizes 1024 through 4096 with triangle and with convex decomposition collision shapes, reporting shape counts, step and bb query times
+    void timeCollisionShapes();
+
+    // time the fused generate_map against the original stage-per-pass generate_map_reference for map sizes 1024 through 4096, verifying identical output
+    void timeMapGeneration();
+
+    // time simplify against the original recursive reference::simplify at each simd level for contours of 10k through 1M vertices, verifying identical output, and time simplify_visvalingam
+    void timeSimplification();
+
+    // time std::map perimeter stitching against march_serial and march_tiled (across thread counts) for map sizes 1024 through 4096, verifying identical output
+    void timeMarching();
+
+    // time build_contour_tree against the original pairwise reference::build_contour_tree on marched perlin maps of sizes 512 through 4096, verifying identical trees
+    void timeContourTree();
+
+    // time triangulate with libtess and with ear clipping on the current terrain's shapes and on the shapes of marched perlin maps of sizes 1024 through 4096
+    void timeTriangulation();
+
+    // time the linear per-triangle point test Shape::isLocalPointInside used against terrain::detail::triangle_grid on the current terrain's shapes, verifying identical results
+    void timePointQueries();
+
+    // generate planets of sizes 512 through 2048 with attachments on a 1 thread pool and on a hardware_concurrency thread pool, verifying identical shapes, anchors and attachments
+    void verifyThreadCountIndependence();
+
 private:
 
     float _surfaceSolidity, _surfaceRoughness;
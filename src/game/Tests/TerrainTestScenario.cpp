@@ -9,8 +9,10 @@
 #include <cinder/Rand.h>
 
 #include "game/Tests/TerrainTestScenario.hpp"
+#include "game/Tests/util/Measurement.hpp"
 #include "core/util/SpatialIndex.hpp"
 #include "elements/Components/DevComponents.hpp"
+#include "elements/Terrain/TerrainDetail.hpp"
 
 using namespace core;
 using namespace elements;
@@ -140,9 +142,15 @@ namespace {
 
 /*
  terrain::TerrainObjectRef _terrain;
+ elements::ViewportControllerRef _viewportController;
+ bool _verifyDrawBatching;
+ bool _contactGroupsFailed;
  */
 
-TerrainTestScenario::TerrainTestScenario() {
+TerrainTestScenario::TerrainTestScenario():
+_verifyDrawBatching(false),
+_contactGroupsFailed(false)
+{
 }
 
 TerrainTestScenario::~TerrainTestScenario() {
@@ -200,6 +208,25 @@ void TerrainTestScenario::setup() {
                 case app::KeyEvent::KEY_r:
                     this->reset();
                     return true;
+                    // track 'c' for toggling clipping engine, to compare World::cut timings
+                case app::KeyEvent::KEY_c: {
+                    const bool useBoost = terrain::World::getClippingEngine() != terrain::BOOST_GEOMETRY_CLIPPING;
+                    terrain::World::setClippingEngine(useBoost ? terrain::BOOST_GEOMETRY_CLIPPING : terrain::FIXED_POINT_CLIPPING);
+                    CI_LOG_D("Clipping engine: " << (useBoost ? "boost_geometry" : "fixed_point"));
+                    return true;
+                }
+                    // track 'd' for toggling batched drawing; the batching is verified on the next frame
+                case app::KeyEvent::KEY_d: {
+                    auto &drawDispatcher = _terrain->getWorld()->getDrawDispatcher();
+                    drawDispatcher.setBatched(!drawDispatcher.isBatched());
+                    _verifyDrawBatching = drawDispatcher.isBatched();
+                    CI_LOG_D("Batched drawing: " << boolalpha << drawDispatcher.isBatched());
+                    return true;
+                }
+                    // track 'b' for timing batched vs sequential cuts
+                case app::KeyEvent::KEY_b:
+                    this->timeBatchedCuts();
+                    return true;
                 default:
                     return false;
             }
@@ -211,18 +238,32 @@ void TerrainTestScenario::setup() {
 void TerrainTestScenario::cleanup() {
     _terrain.reset();
     setStage(nullptr);
+    _contactGroupsFailed = false;
 }
 
 void TerrainTestScenario::clear(const render_state &state) {
-    gl::clear(Color(0.2, 0.225, 0.25));
+    if (_contactGroupsFailed) {
+        gl::clear(Color(0.5, 0.1, 0.1));
+    } else {
+        gl::clear(Color(0.2, 0.225, 0.25));
+    }
 }
 
 void TerrainTestScenario::drawScreen(const render_state &state) {
+    if (_verifyDrawBatching) {
+        verifyDrawBatching(state);
+        _verifyDrawBatching = false;
+    }
+
     // draw fpf/sps
     float fps = App::get()->getAverageFps();
     float sps = App::get()->getAverageSps();
     string info = strings::format("%.1f %.1f", fps, sps);
     gl::drawString(info, vec2(10, 10), Color(1, 1, 1));
+
+    if (_contactGroupsFailed) {
+        gl::drawString("verifyContactGroups FAILED - see console", vec2(10, 30), Color(1, 0.25, 0.25));
+    }
 }
 
 void TerrainTestScenario::reset() {
@@ -549,6 +590,10 @@ terrain::WorldRef TerrainTestScenario::testFail() {
     // we know the last cut causes weirdness so cut all but the last
     for (int i = 0; i < cuts.size() - 1; i++) {
         world->cut(cuts[i].a, cuts[i].b, cuts[i].radius);
+        if (!verifyContactGroups(world)) {
+            _contactGroupsFailed = true;
+            CI_ASSERT_MSG(false, "find_contact_groups disagrees with the flood fill");
+        }
     }
 
     cut lastCut = cuts[cuts.size() - 1];
@@ -648,3 +693,150 @@ void TerrainTestScenario::timeSpatialIndex() {
     app::console() << "------------------------------------" << endl << "PERFORMING PERF MEASUREMENTS" << endl;
     performTimingRun(450);
 }
+
+void TerrainTestScenario::timeBatchedCuts() {
+
+    Rand rng;
+
+    auto ring = [](dvec2 center, double radius, int subdivisions) -> PolyLine2d {
+        PolyLine2d polyLine;
+        for (int i = 0; i < subdivisions; i++) {
+            double r = static_cast<double>(i) / static_cast<double>(subdivisions) * M_PI * 2;
+            polyLine.push_back(center + dvec2(cos(r), sin(r)) * radius);
+        }
+        polyLine.setClosed();
+        return polyLine;
+    };
+
+    auto totalArea = [](const terrain::WorldRef &world) -> double {
+        double area = 0;
+        for (const auto &shape : world->getStaticGroup()->getShapes()) {
+            area += boost::geometry::area(terrain::detail::shape_to_dpolygon2(shape));
+        }
+        for (const auto &dynamicGroup : world->getDynamicGroups()) {
+            for (const auto &shape : dynamicGroup->getShapes()) {
+                area += boost::geometry::area(terrain::detail::shape_to_dpolygon2(shape));
+            }
+        }
+        return area;
+    };
+
+    const terrain::material terrainMaterial(1, 0.5, COLLISION_SHAPE_RADIUS, ShapeFilters::TERRAIN, CollisionType::TERRAIN, MIN_SURFACE_AREA, TERRAIN_COLOR);
+    const terrain::material anchorMaterial(1, 1, COLLISION_SHAPE_RADIUS, ShapeFilters::ANCHOR, CollisionType::ANCHOR, MIN_SURFACE_AREA, ANCHOR_COLOR);
+
+    // each world gets its own stage, so the worlds don't see each other's shapes in their space queries
+    auto makeWorld = [&](const StageRef &stage) -> terrain::WorldRef {
+        auto shapes = terrain::Shape::fromContours({ ring(dvec2(0, 0), 500, 600), ring(dvec2(0, 0), 400, 600) });
+        vector<terrain::AnchorRef> anchors = {
+                terrain::Anchor::fromContour(rect(vec2(0, -450), vec2(10, 10)))
+        };
+
+        auto world = make_shared<terrain::World>(stage->getSpace(), terrainMaterial, anchorMaterial);
+        world->build(terrain::World::partition(shapes, 130), anchors);
+        return world;
+    };
+
+    // a cluster of overlapping blasts around a point on the ring, like a cluster munition would produce
+    auto makeCuts = [&](int count) -> vector<dpolygon2> {
+        vector<dpolygon2> cuts;
+        const double angle = rng.nextFloat(0, 2 * M_PI);
+        const dvec2 center = dvec2(cos(angle), sin(angle)) * 450.0;
+        for (int i = 0; i < count; i++) {
+            const dvec2 offset(rng.nextFloat(-60, 60), rng.nextFloat(-60, 60));
+            cuts.push_back(terrain::detail::polyline2d_to_dpolygon2(ring(center + offset, rng.nextFloat(8, 24), 24)));
+        }
+        return cuts;
+    };
+
+    measurement::banner("BATCHED CUT");
+
+    for (int count : { 4, 16, 64 }) {
+        const auto cuts = makeCuts(count);
+
+        auto sequentialStage = make_shared<Stage>("Sequential Cut Stage");
+        auto sequentialWorld = makeWorld(sequentialStage);
+        const double sequentialTime = measurement::seconds([&]() {
+            for (const auto &cut : cuts) {
+                sequentialWorld->cut(cut);
+            }
+        });
+
+        auto batchedStage = make_shared<Stage>("Batched Cut Stage");
+        auto batchedWorld = makeWorld(batchedStage);
+        const double batchedTime = measurement::seconds([&]() {
+            batchedWorld->cut(cuts);
+        });
+
+        app::console() << "For " << count << " cuts:" << endl;
+        app::console() << "\tsequential: " << sequentialTime << " seconds, remaining area: " << totalArea(sequentialWorld) << endl;
+        app::console() << "\tbatched: " << batchedTime << " seconds, remaining area: " << totalArea(batchedWorld) << endl;
+        app::console() << "\tratio batched/sequential: " << (batchedTime / sequentialTime) << endl;
+        app::console() << endl;
+    }
+}
+
+bool TerrainTestScenario::verifyDrawBatching(const render_state &state) {
+    auto &drawDispatcher = _terrain->getWorld()->getDrawDispatcher();
+
+    // what the unbatched path would submit: one draw call per visible drawable with triangles
+    size_t unbatchedDrawCalls = 0, expectedVertices = 0;
+    for (const auto &drawable : drawDispatcher.getVisibleSorted()) {
+        if (drawable->shouldDraw(state) && drawable->getTriMesh()) {
+            unbatchedDrawCalls++;
+            expectedVertices += drawable->getTriMesh()->getNumIndices();
+        }
+    }
+
+    terrain::detail::counting_draw_batch_backend backend;
+    const int frames = 4;
+    for (int i = 0; i < frames; i++) {
+        drawDispatcher.drawBatched(state, backend);
+    }
+
+    const bool match = backend.drawCalls == (expectedVertices > 0 ? frames : 0) && backend.verticesDrawn == expectedVertices * frames;
+    app::console() << "verifyDrawBatching visible drawables: " << drawDispatcher.visibleCount()
+                   << " unbatched draw calls/frame: " << unbatchedDrawCalls
+                   << " batched draw calls over " << frames << " frames: " << backend.drawCalls
+                   << " vertices/frame: " << expectedVertices
+                   << " buffer allocations: " << backend.allocations << " (capacity " << backend.capacity << ")"
+                   << " match: " << (match ? "YES" : "NO") << endl;
+
+    return match;
+}
+
+bool TerrainTestScenario::verifyContactGroups(const terrain::WorldRef &world) {
+
+    // gather every shape in the world; they all have groups so no parentage map is needed
+    vector<terrain::ShapeRef> shapes;
+    const auto staticShapes = world->getStaticGroup()->getShapes();
+    shapes.insert(shapes.end(), staticShapes.begin(), staticShapes.end());
+    for (const auto &dynamicGroup : world->getDynamicGroups()) {
+        const auto dynamicShapes = dynamicGroup->getShapes();
+        shapes.insert(shapes.end(), dynamicShapes.begin(), dynamicShapes.end());
+    }
+
+    const map<terrain::ShapeRef, terrain::GroupBaseRef> parentage;
+
+    StopWatch floodFillTimer;
+    vector<set<terrain::ShapeRef>> floodFillGroups;
+    set<terrain::ShapeRef> remaining(shapes.begin(), shapes.end());
+    while (!remaining.empty()) {
+        auto group = terrain::detail::find_contact_group(*remaining.begin(), remaining, parentage);
+        for (const auto &shape : group) {
+            remaining.erase(shape);
+        }
+        floodFillGroups.push_back(group);
+    }
+    const double floodFillTime = floodFillTimer.mark();
+
+    StopWatch unionFindTimer;
+    const auto unionFindGroups = terrain::detail::find_contact_groups(shapes, parentage);
+    const double unionFindTime = unionFindTimer.mark();
+
+    const bool match = floodFillGroups == unionFindGroups;
+    app::console() << "verifyContactGroups shapes: " << shapes.size() << " groups: " << unionFindGroups.size()
+                   << " match: " << (match ? "YES" : "NO")
+                   << " floodFill: " << floodFillTime << "s unionFind: " << unionFindTime << "s" << endl;
+
+    return match;
+}
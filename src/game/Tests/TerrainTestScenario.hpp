@@ -54,10 +54,21 @@ private:
 
     void timeSpatialIndex();
 
+    // compare a batch of cuts applied sequentially via World::cut against the batched World::cut
+    void timeBatchedCuts();
+
+    // compare find_contact_groups against the flood fill it replaced, over every shape in `world
+    bool verifyContactGroups(const elements::terrain::WorldRef &world);
+
+    // pack the terrain's visible drawables into a counting backend and check what would be submitted to the GPU
+    bool verifyDrawBatching(const core::render_state &state);
+
 private:
 
     elements::terrain::TerrainObjectRef _terrain;
     elements::ViewportControllerRef _viewportController;
+    bool _verifyDrawBatching;
+    bool _contactGroupsFailed;
 };
 
 #endif /* IslandTestScenario_hpp */
@@ -37,6 +37,25 @@ public:
     void setup() override {
         App::setup();
         
+        //
+        // --terrain-cut-benchmark <cuts.txt> [<out.csv>] replays recorded cuts without loading a scenario, then quits
+        //
+        
+        const auto &args = getCommandLineArgs();
+        const auto benchmarkArg = find(args.begin(), args.end(), "--terrain-cut-benchmark");
+        if (benchmarkArg != args.end()) {
+            if (benchmarkArg + 1 == args.end()) {
+                CI_LOG_E("Usage: --terrain-cut-benchmark <cuts.txt> [<out.csv>]");
+            } else {
+                const fs::path cutsPath = *(benchmarkArg + 1);
+                const fs::path csvPath = benchmarkArg + 2 != args.end() ? fs::path(*(benchmarkArg + 2)) : getAppPath() / "cut_benchmark.csv";
+                PerlinWorldTestScenario().runCutBenchmark(cutsPath, csvPath);
+            }
+            
+            quit();
+            return;
+        }
+        
         _scenarioFactories = {
             SCENARIO_FACTORY(GamepadTestScenario),
             SCENARIO_FACTORY(MultiViewportTestScenario),
@@ -0,0 +1,44 @@
+//
+//  Measurement.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/24/18.
+//
+
+#ifndef Measurement_hpp
+#define Measurement_hpp
+
+#include "core/Core.hpp"
+
+/**
+ Helpers shared by the test scenarios' timing handlers, which each time a fast path against the reference implementation
+ it replaced. A fast path whose output differs from its reference fails an assert rather than just printing so.
+ */
+namespace measurement {
+    
+    // print the banner which starts a handler's output, e.g. "PERFORMING MARCHING SQUARES MEASUREMENTS" for title "MARCHING SQUARES"
+    inline void banner(const string &title) {
+        app::console() << "------------------------------------" << endl << "PERFORMING " << title << " MEASUREMENTS" << endl;
+    }
+    
+    // run fn once, returning the wall clock seconds it took
+    template<class F>
+    double seconds(const F &fn) {
+        core::StopWatch timer;
+        fn();
+        return timer.mark();
+    }
+    
+    /**
+     Print `label's time, its speedup over `referenceSeconds and whether its output was identical to the reference's,
+     then assert that it was. Returns `identical.
+     */
+    inline bool compare(const string &label, double seconds, double referenceSeconds, bool identical) {
+        app::console() << "\t" << label << ": " << seconds << " seconds (" << (referenceSeconds / seconds) << "x) identical: " << boolalpha << identical << endl;
+        CI_ASSERT_MSG(identical, (label + " output differs from its reference").c_str());
+        return identical;
+    }
+    
+}
+
+#endif /* Measurement_hpp */
@@ -0,0 +1,83 @@
+//
+//  TerrainCutBenchmark.cpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/14/18.
+//
+
+#include "game/Tests/util/TerrainCutBenchmark.hpp"
+
+using namespace core;
+using namespace elements;
+
+vector<TerrainCutBenchmark::result> TerrainCutBenchmark::run(const world_factory &factory, const vector<TerrainCutRecorder::cut> &cuts) {
+    vector<result> results;
+    terrain::World::ScopedGraphicsDisabled noGraphics;
+    
+    {
+        // the stage only provides a cpSpace for the world; it's never added to a scenario, so it's never stepped or drawn
+        auto stage = make_shared<Stage>("TerrainCutBenchmark");
+        auto world = factory(stage->getSpace());
+        
+        if (world) {
+            for (const auto &c : cuts) {
+                world->cut(c.a, c.b, c.width);
+                
+                result r;
+                r.cut = c;
+                r.profile = world->getLastCutProfile();
+                r.staticShapes = world->getStaticGroup()->getShapes().size();
+                r.dynamicGroups = world->getDynamicGroups().size();
+                results.push_back(r);
+            }
+        } else {
+            CI_LOG_E("world_factory didn't produce a world");
+        }
+        
+        // world has to go before the stage which owns its space
+        world.reset();
+    }
+    
+    return results;
+}
+
+void TerrainCutBenchmark::writeCsv(const vector<result> &results, ostream &out) {
+    out << "index,ax,ay,bx,by,width,polygons,shapesCut,shapesCreated,staticShapes,dynamicGroups,"
+        << "bbQuery,subtract,triangulate,grouping,collisionShapes,attachments,total" << endl;
+    
+    for (size_t i = 0, N = results.size(); i < N; i++) {
+        const result &r = results[i];
+        const terrain::cut_profile &p = r.profile;
+        out << i << ","
+            << r.cut.a.x << "," << r.cut.a.y << "," << r.cut.b.x << "," << r.cut.b.y << "," << r.cut.width << ","
+            << p.polygons << "," << p.shapesCut << "," << p.shapesCreated << ","
+            << r.staticShapes << "," << r.dynamicGroups << ","
+            << p.bbQuery << "," << p.subtract << "," << p.triangulate << "," << p.grouping << ","
+            << p.collisionShapes << "," << p.attachments << "," << p.total << endl;
+    }
+}
+
+void TerrainCutBenchmark::logSummary(const vector<result> &results) {
+    terrain::cut_profile sum;
+    for (const auto &r : results) {
+        sum.shapesCut += r.profile.shapesCut;
+        sum.shapesCreated += r.profile.shapesCreated;
+        sum.bbQuery += r.profile.bbQuery;
+        sum.subtract += r.profile.subtract;
+        sum.triangulate += r.profile.triangulate;
+        sum.grouping += r.profile.grouping;
+        sum.collisionShapes += r.profile.collisionShapes;
+        sum.attachments += r.profile.attachments;
+        sum.total += r.profile.total;
+    }
+    
+    app::console() << "TerrainCutBenchmark - " << results.size() << " cuts, " << sum.shapesCut << " shapes cut, "
+                   << sum.shapesCreated << " shapes created" << endl;
+    app::console() << "\tbbQuery: " << sum.bbQuery << " seconds" << endl;
+    app::console() << "\tsubtract: " << sum.subtract << " seconds" << endl;
+    app::console() << "\ttriangulate: " << sum.triangulate << " seconds" << endl;
+    app::console() << "\tgrouping: " << sum.grouping << " seconds" << endl;
+    app::console() << "\tcollisionShapes: " << sum.collisionShapes << " seconds" << endl;
+    app::console() << "\tattachments: " << sum.attachments << " seconds" << endl;
+    app::console() << "\ttotal: " << sum.total << " seconds" << endl;
+}
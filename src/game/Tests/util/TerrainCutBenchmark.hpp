@@ -0,0 +1,46 @@
+//
+//  TerrainCutBenchmark.hpp
+//  Kessler Syndrome
+//
+//  Created by Shamyl Zakariya on 8/14/18.
+//
+
+#ifndef TerrainCutBenchmark_hpp
+#define TerrainCutBenchmark_hpp
+
+#include "core/Core.hpp"
+#include "elements/Terrain/Terrain.hpp"
+#include "game/Tests/util/TerrainCutRecorder.hpp"
+
+/**
+ TerrainCutBenchmark replays a sequence of recorded cuts against a terrain::World built with graphics disabled,
+ on a stage which is never added to a scenario, so it needs no GL context. It reports the per-phase timings of
+ each cut as CSV, so terrain performance can be compared across changes.
+ */
+class TerrainCutBenchmark {
+public:
+    
+    // builds the world to cut; called with graphics disabled
+    typedef std::function<elements::terrain::WorldRef(const core::SpaceAccessRef &space)> world_factory;
+    
+    struct result {
+        TerrainCutRecorder::cut cut;
+        elements::terrain::cut_profile profile;
+        size_t staticShapes;
+        size_t dynamicGroups;
+    };
+
+public:
+    
+    // build a world using `factory and replay `cuts against it, returning the profile of each cut
+    static vector<result> run(const world_factory &factory, const vector<TerrainCutRecorder::cut> &cuts);
+    
+    // write one CSV row per result, with a header row
+    static void writeCsv(const vector<result> &results, ostream &out);
+    
+    // log the total time spent in each phase across all results
+    static void logSummary(const vector<result> &results);
+    
+};
+
+#endif /* TerrainCutBenchmark_hpp */